@@ -0,0 +1,183 @@
+// 统计两套接口中每个任务的堆内存分配次数
+// 替换全局operator new计数，先预热让队列和内存池达到稳定状态，再统计提交和获取结果期间的分配次数
+// 用法: alloc_bench [tasks] [rounds] [threads] [legacy|final|all]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "threadpool_final.h"
+
+std::atomic<size_t> g_allocs(0);
+
+void runLegacyAllocBench(int tasks, int rounds, int threads);
+
+// 替换全部形式的operator new/delete(数组、对齐、nothrow)，分配与释放成对，都计入统计
+static void* countedAlloc(size_t size) noexcept {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+static void* countedAlloc(size_t size, std::align_val_t align) noexcept {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    // aligned_alloc要求大小是对齐值的整数倍
+    return std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a);
+}
+
+void* operator new(size_t size) {
+    if (void* p = countedAlloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    if (void* p = countedAlloc(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, align);
+}
+
+// 释放不内联：operator delete内联进调用者后，GCC会把free与operator new误判为不匹配
+[[gnu::noinline]] static void countedFree(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(p);
+}
+
+const char* allocModeName(QueueMode mode) {
+    switch (mode) {
+    case QueueMode::Queue_Global: return "global";
+    case QueueMode::Queue_WorkStealing: return "workstealing";
+    case QueueMode::Queue_LockFree: return "lockfree";
+    }
+    return "unknown";
+}
+
+// 提交一轮任务并等待全部完成
+static long runRound(ThreadPool& pool, std::vector<std::future<int>>& futures, int tasks) {
+    long sum = 0;
+    for (int i = 0; i < tasks; i++) {
+        futures.emplace_back(pool.submitTask([](int a, int b) { return a + b; }, i, 1));
+    }
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    futures.clear();
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    const int tasks = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int rounds = argc > 2 ? std::atoi(argv[2]) : 100;
+    const int threads = argc > 3 ? std::atoi(argv[3]) : 4;
+    const std::string api = argc > 4 ? argv[4] : "all";
+
+    if (api == "all" || api == "legacy") {
+        runLegacyAllocBench(tasks, rounds, threads);
+    }
+    if (api != "all" && api != "final") {
+        return 0;
+    }
+
+    for (QueueMode mode : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        ThreadPool pool;
+        pool.setQueueMode(mode);
+        pool.setTaskQueThreshold(tasks);
+        pool.start(threads);
+
+        std::vector<std::future<int>> futures;
+        futures.reserve(tasks);
+
+        // 预热  线程缓存需要几轮才能填满
+        for (int r = 0; r < 10; r++) {
+            runRound(pool, futures, tasks);
+        }
+
+        size_t before = g_allocs.load();
+        long sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            sum += runRound(pool, futures, tasks);
+        }
+        size_t allocs = g_allocs.load() - before;
+        long total = long(tasks) * rounds;
+
+        std::printf("api=final mode=%s tasks=%ld allocs=%zu allocs_per_task=%.4f checksum=%ld\n",
+                    allocModeName(mode), total, allocs, double(allocs) / total, sum);
+    }
+    return 0;
+}
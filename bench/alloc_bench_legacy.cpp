@@ -0,0 +1,67 @@
+// alloc_bench中threadpool.h的Task/Result接口部分  两套接口的ThreadPool同名，放在单独的源文件中
+
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+#include "threadpool.h"
+
+extern std::atomic<size_t> g_allocs;
+const char* allocModeName(QueueMode mode);
+
+namespace {
+
+class AddTask : public Task {
+public:
+    AddTask(int a, int b) : a_(a), b_(b) {}
+
+    Any run() {
+        return a_ + b_;
+    }
+
+private:
+    int a_;
+    int b_;
+};
+
+// 提交一轮任务并等待全部完成
+long runRound(ThreadPool& pool, std::vector<Result>& results, int tasks) {
+    long sum = 0;
+    for (int i = 0; i < tasks; i++) {
+        results.emplace_back(pool.submitTask(makeTask<AddTask>(i, 1)));
+    }
+    for (auto& res : results) {
+        sum += res.get().cast_<int>();
+    }
+    results.clear();
+    return sum;
+}
+
+}  // namespace
+
+void runLegacyAllocBench(int tasks, int rounds, int threads) {
+    for (QueueMode mode : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        ThreadPool pool;
+        pool.setQueueMode(mode);
+        pool.setTaskQueThreshold(tasks);
+        pool.start(threads);
+
+        std::vector<Result> results;
+        results.reserve(tasks);
+
+        for (int r = 0; r < 10; r++) {
+            runRound(pool, results, tasks);
+        }
+
+        size_t before = g_allocs.load();
+        long sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            sum += runRound(pool, results, tasks);
+        }
+        size_t allocs = g_allocs.load() - before;
+        long total = long(tasks) * rounds;
+
+        std::printf("api=legacy mode=%s tasks=%ld allocs=%zu allocs_per_task=%.4f checksum=%ld\n",
+                    allocModeName(mode), total, allocs, double(allocs) / total, sum);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "threadpool_base.h"
+
+// threadpool_bench的公共部分  每个测试结果输出一行空格分隔的key=value，便于脚本解析和比较
+
+// 命令行参数
+struct BenchOptions {
+    std::vector<size_t> threads;  // 依次测试的线程数量
+    std::vector<QueueMode> queues;  // 依次测试的任务队列调度方式
+    std::string api = "all";  // legacy / final / all
+    std::string scenario = "all";  // 只运行指定的场景
+    size_t tasks = 100000;  // 吞吐量类场景的任务数量
+    size_t samples = 10000;  // 延迟场景的采样数量
+    size_t fanout = 64;  // 扇出场景每轮的子任务数量
+    size_t producers = 8;  // 多生产者场景的提交线程数量
+    size_t bursts = 5;  // 突发场景的突发次数
+    size_t burstGapMs = 200;  // 突发之间的空闲时间
+    size_t keepAliveMs = 100;  // 突发场景中多余线程的空闲回收时间
+    size_t queueCapacity = 65536;  // 任务队列容量上限
+    long spinBudget = -1;  // 线程休眠之前空转检查任务的次数，小于0时使用线程池的默认值
+    AffinityPolicy affinity = AffinityPolicy::Affinity_None;  // 线程的CPU绑定策略
+    std::vector<int> affinityCpus;  // Affinity_Explicit的CPU列表
+};
+
+// 一组测试条件
+struct BenchCase {
+    const char* api;
+    QueueMode queue;
+    size_t threads;
+};
+
+inline const char* queueName(QueueMode mode) {
+    switch (mode) {
+    case QueueMode::Queue_Global: return "global";
+    case QueueMode::Queue_WorkStealing: return "workstealing";
+    case QueueMode::Queue_LockFree: return "lockfree";
+    }
+    return "unknown";
+}
+
+inline uint64_t benchNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 输出一行结果的公共前缀，调用者继续追加场景自己的字段并换行
+inline void printCase(const BenchCase& c, const char* scenario) {
+    std::printf("api=%s queue=%s threads=%zu scenario=%s", c.api, queueName(c.queue), c.threads, scenario);
+}
+
+// 输出吞吐量字段
+inline void printThroughput(size_t tasks, uint64_t ns) {
+    double seconds = ns / 1e9;
+    std::printf(" tasks=%zu seconds=%.6f tasks_per_sec=%.0f", tasks, seconds, seconds > 0 ? tasks / seconds : 0.0);
+}
+
+// 输出延迟分位数(微秒)，samples会被排序
+inline void printPercentiles(std::vector<uint64_t>& samples, const char* prefix) {
+    if (samples.empty()) {
+        return ;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        size_t i = std::min(samples.size() - 1, size_t(p * samples.size()));
+        return samples[i] / 1e3;
+    };
+    std::printf(" %s_p50_us=%.2f %s_p90_us=%.2f %s_p99_us=%.2f %s_max_us=%.2f",
+                prefix, at(0.5), prefix, at(0.9), prefix, at(0.99), prefix, samples.back() / 1e3);
+}
+
+// 各套接口的入口，分别在bench_legacy.cpp和bench_final.cpp中实现
+void runLegacyBench(const BenchOptions& opts, const BenchCase& c);
+void runFinalBench(const BenchOptions& opts, const BenchCase& c);
+
+#endif
@@ -0,0 +1,24 @@
+// threadpool_final.h中future接口的测试适配
+
+#include <utility>
+
+#include "threadpool_final.h"
+#include "bench_scenarios.h"
+
+struct FinalApi {
+    using Pool = ThreadPool;
+    using Handle = std::future<int>;
+
+    template <typename Func>
+    static std::future<int> submit(ThreadPool& pool, Func&& func) {
+        return pool.submitTask(std::forward<Func>(func));
+    }
+
+    static int get(std::future<int>& f) {
+        return f.get();
+    }
+};
+
+void runFinalBench(const BenchOptions& opts, const BenchCase& c) {
+    BenchScenarios<FinalApi>{opts, c}.run();
+}
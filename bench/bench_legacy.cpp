@@ -0,0 +1,38 @@
+// threadpool.h中Task/Result接口的测试适配
+
+#include <utility>
+
+#include "threadpool.h"
+#include "bench_scenarios.h"
+
+// 将返回int的可调用对象包装成Task
+template <typename Func>
+class LambdaTask : public Task {
+public:
+    explicit LambdaTask(Func func) : func_(std::move(func)) {}
+
+    Any run() {
+        return func_();
+    }
+
+private:
+    Func func_;
+};
+
+struct LegacyApi {
+    using Pool = ThreadPool;
+    using Handle = Result;
+
+    template <typename Func>
+    static Result submit(ThreadPool& pool, Func&& func) {
+        return pool.submitTask(makeTask<LambdaTask<std::decay_t<Func>>>(std::forward<Func>(func)));
+    }
+
+    static int get(Result& res) {
+        return res.get().cast_<int>();
+    }
+};
+
+void runLegacyBench(const BenchOptions& opts, const BenchCase& c) {
+    BenchScenarios<LegacyApi>{opts, c}.run();
+}
@@ -0,0 +1,312 @@
+#ifndef BENCH_SCENARIOS_H
+#define BENCH_SCENARIOS_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "task_graph.h"
+
+// 各个测试场景  以接口适配类Api为模板参数，两套线程池接口共用同一份场景代码
+// Api需要提供:
+//   Pool                          线程池类型
+//   Handle                        提交任务返回的结果类型
+//   Handle submit(Pool&, F&&)     提交一个返回int的无参任务
+//   int get(Handle&)              等待并取出结果
+
+template <typename Api>
+struct BenchScenarios {
+    using Pool = typename Api::Pool;
+    using Handle = typename Api::Handle;
+
+    const BenchOptions& opts_;
+    const BenchCase& case_;
+
+    // 按测试条件创建并启动线程池
+    std::unique_ptr<Pool> makePool() {
+        auto pool = std::make_unique<Pool>();
+        pool->setQueueMode(case_.queue);
+        pool->setTaskQueThreshold(opts_.queueCapacity);
+        if (opts_.spinBudget >= 0) {
+            pool->setSpinBudget(opts_.spinBudget);
+        }
+        pool->setAffinity(opts_.affinity, opts_.affinityCpus);
+        pool->start(case_.threads);
+        return pool;
+    }
+
+    bool enabled(const char* name) const {
+        return opts_.scenario == "all" || opts_.scenario == name;
+    }
+
+    void run() {
+        if (enabled("throughput")) throughput();
+        if (enabled("latency")) latency();
+        if (enabled("fanout")) fanout();
+        if (enabled("nested")) nested();
+        if (enabled("bursty")) bursty();
+        if (enabled("producers")) producers();
+        if (enabled("graph")) graph();
+    }
+
+    // 空任务吞吐量  一个线程提交全部任务后再逐个等待结果
+    void throughput() {
+        auto pool = makePool();
+        std::vector<Handle> handles;
+        handles.reserve(opts_.tasks);
+
+        uint64_t begin = benchNowNs();
+        for (size_t i = 0; i < opts_.tasks; i++) {
+            handles.push_back(Api::submit(*pool, []() { return 0; }));
+        }
+        for (auto& h : handles) {
+            Api::get(h);
+        }
+        uint64_t end = benchNowNs();
+
+        printCase(case_, "throughput");
+        printThroughput(opts_.tasks, end - begin);
+        std::printf("\n");
+    }
+
+    // 提交到开始执行的延迟  每次等上一个任务完成再提交，线程池在两次提交之间回到空闲状态
+    void latency() {
+        auto pool = makePool();
+        std::vector<uint64_t> samples(opts_.samples);
+        uint64_t* out = samples.data();
+
+        for (size_t i = 0; i < opts_.samples; i++) {
+            uint64_t submitted = benchNowNs();
+            Handle h = Api::submit(*pool, [out, i, submitted]() {
+                out[i] = benchNowNs() - submitted;
+                return 0;
+            });
+            Api::get(h);
+        }
+
+        printCase(case_, "latency");
+        std::printf(" samples=%zu", opts_.samples);
+        printPercentiles(samples, "start");
+        std::printf("\n");
+    }
+
+    // 扇出/扇入  每轮提交fanout个子任务，最后完成的子任务再提交一个汇合任务，由汇合任务通知提交者
+    void fanout() {
+        // 线程池最后析构，等正在执行的汇合任务结束后才释放它访问的计数
+        std::atomic<size_t> remaining(0);
+        std::atomic_int done(0);
+        auto pool = makePool();
+        size_t width = std::max<size_t>(opts_.fanout, 1);
+        size_t rounds = std::max<size_t>(opts_.tasks / width, 1);
+        std::vector<uint64_t> samples;
+        samples.reserve(rounds);
+        Pool* p = pool.get();
+
+        uint64_t begin = benchNowNs();
+        for (size_t r = 0; r < rounds; r++) {
+            uint64_t roundBegin = benchNowNs();
+            remaining = width;
+            done = 0;
+            for (size_t i = 0; i < width; i++) {
+                Api::submit(*p, [p, &remaining, &done]() {
+                    if (remaining.fetch_sub(1) == 1) {
+                        Api::submit(*p, [&done]() {
+                            done = 1;
+                            done.notify_one();
+                            return 0;
+                        });
+                    }
+                    return 0;
+                });
+            }
+            done.wait(0);
+            samples.push_back(benchNowNs() - roundBegin);
+        }
+        uint64_t end = benchNowNs();
+
+        printCase(case_, "fanout");
+        printThroughput(rounds * (width + 1), end - begin);
+        std::printf(" width=%zu rounds=%zu", width, rounds);
+        printPercentiles(samples, "round");
+        std::printf("\n");
+    }
+
+    // 嵌套提交  每个任务在线程池内部再提交两个子任务，形成一棵完全二叉树
+    void nested() {
+        // 节点总数不超过任务队列容量，避免任务队列已满导致提交失败
+        size_t limit = std::max<size_t>(std::min(opts_.tasks, opts_.queueCapacity), 1);
+        int depth = 0;
+        while ((size_t(4) << depth) - 1 <= limit) {
+            depth++;
+        }
+        size_t total = (size_t(2) << depth) - 1;
+
+        struct Tree {
+            Pool* pool_;
+            std::atomic<size_t> done_{0};
+            size_t total_;
+
+            void spawn(int depth) {
+                Api::submit(*pool_, [this, depth]() {
+                    if (depth > 0) {
+                        spawn(depth - 1);
+                        spawn(depth - 1);
+                    }
+                    if (done_.fetch_add(1) + 1 == total_) {
+                        done_.notify_one();
+                    }
+                    return 0;
+                });
+            }
+        };
+        Tree tree;
+        auto pool = makePool();
+        tree.pool_ = pool.get();
+        tree.total_ = total;
+
+        uint64_t begin = benchNowNs();
+        tree.spawn(depth);
+        for (size_t n = tree.done_.load(); n != total; n = tree.done_.load()) {
+            tree.done_.wait(n);
+        }
+        uint64_t end = benchNowNs();
+
+        printCase(case_, "nested");
+        printThroughput(total, end - begin);
+        std::printf(" depth=%d\n", depth);
+    }
+
+    // 突发负载  Cached模式下交替出现大量阻塞任务和空闲期，空闲期长于空闲回收时间时可以观察到线程的扩充和回收
+    void bursty() {
+        size_t threshold = std::max<size_t>(case_.threads * 4, 4);
+        auto pool = std::make_unique<Pool>();
+        pool->setMode(PoolMode::Mode_Cached);
+        pool->setQueueMode(case_.queue);
+        pool->setTaskQueThreshold(opts_.queueCapacity);
+        if (opts_.spinBudget >= 0) {
+            pool->setSpinBudget(opts_.spinBudget);
+        }
+        pool->setAffinity(opts_.affinity, opts_.affinityCpus);
+        pool->setThreadSizeThreshold(threshold);
+        pool->setKeepAliveTime(std::chrono::milliseconds(opts_.keepAliveMs));
+        pool->start(case_.threads);
+        size_t burst = threshold * 2;
+        size_t peak = pool->threadSize();
+        std::vector<Handle> handles;
+        handles.reserve(burst);
+        std::vector<uint64_t> samples;
+
+        uint64_t begin = benchNowNs();
+        for (size_t b = 0; b < opts_.bursts; b++) {
+            uint64_t burstBegin = benchNowNs();
+            for (size_t i = 0; i < burst; i++) {
+                handles.push_back(Api::submit(*pool, []() {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    return 0;
+                }));
+            }
+            peak = std::max(peak, pool->threadSize());
+            for (auto& h : handles) {
+                Api::get(h);
+            }
+            handles.clear();
+            samples.push_back(benchNowNs() - burstBegin);
+            peak = std::max(peak, pool->threadSize());
+            std::this_thread::sleep_for(std::chrono::milliseconds(opts_.burstGapMs));
+        }
+        uint64_t end = benchNowNs();
+        PoolStats stats = pool->stats();
+
+        printCase(case_, "bursty");
+        printThroughput(burst * opts_.bursts, end - begin);
+        std::printf(" bursts=%zu burst_size=%zu peak_threads=%zu end_threads=%zu spawned=%llu retired=%llu",
+                    opts_.bursts, burst, peak, stats.threadSize_,
+                    (unsigned long long)stats.threadsSpawned_, (unsigned long long)stats.threadsRetired_);
+        printPercentiles(samples, "burst");
+        std::printf("\n");
+    }
+
+    // 多生产者少消费者  producers个外部线程同时提交空任务
+    void producers() {
+        auto pool = makePool();
+        size_t count = std::max<size_t>(opts_.producers, 1);
+        size_t perProducer = std::max<size_t>(opts_.tasks / count, 1);
+        std::atomic_bool go(false);
+        std::vector<std::thread> threads;
+
+        for (size_t p = 0; p < count; p++) {
+            threads.emplace_back([&]() {
+                std::vector<Handle> handles;
+                handles.reserve(perProducer);
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < perProducer; i++) {
+                    handles.push_back(Api::submit(*pool, []() { return 0; }));
+                }
+                for (auto& h : handles) {
+                    Api::get(h);
+                }
+            });
+        }
+
+        uint64_t begin = benchNowNs();
+        go.store(true, std::memory_order_release);
+        for (auto& t : threads) {
+            t.join();
+        }
+        uint64_t end = benchNowNs();
+        PoolStats stats = pool->stats();
+
+        printCase(case_, "producers");
+        printThroughput(perProducer * count, end - begin);
+        std::printf(" producers=%zu queue_high_water=%zu submit_timeouts=%llu", count, stats.queueHighWater_,
+                    (unsigned long long)stats.submitTimeouts_);
+        // 等待时间取自线程池的对数直方图，是所在桶的上界
+        const LatencyHistogram& wait = stats.total_.queueWait_;
+        std::printf(" wait_p50_us=%.2f wait_p99_us=%.2f", wait.percentile(0.5) / 1e3, wait.percentile(0.99) / 1e3);
+        std::printf("\n");
+    }
+
+    // 任务依赖图  fanout个节点一层，相邻两层之间全连接，同一个图反复执行，每轮的耗时为一个样本
+    void graph() {
+        size_t width = std::max<size_t>(opts_.fanout, 1);
+        size_t layers = 8;
+        size_t rounds = std::max<size_t>(opts_.tasks / (width * layers), 1);
+        std::atomic<size_t> executed(0);
+        TaskGraph g;
+        std::vector<TaskGraph::NodeId> prev, cur;
+        for (size_t l = 0; l < layers; l++) {
+            cur.clear();
+            for (size_t i = 0; i < width; i++) {
+                TaskGraph::NodeId id = g.addNode([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+                for (TaskGraph::NodeId p : prev) {
+                    g.addEdge(p, id);
+                }
+                cur.push_back(id);
+            }
+            prev.swap(cur);
+        }
+        auto pool = makePool();
+        std::vector<uint64_t> samples;
+        samples.reserve(rounds);
+
+        uint64_t begin = benchNowNs();
+        for (size_t r = 0; r < rounds; r++) {
+            uint64_t roundBegin = benchNowNs();
+            g.run(*pool);
+            samples.push_back(benchNowNs() - roundBegin);
+        }
+        uint64_t end = benchNowNs();
+
+        printCase(case_, "graph");
+        printThroughput(executed.load(), end - begin);
+        std::printf(" width=%zu layers=%zu rounds=%zu", width, layers, rounds);
+        printPercentiles(samples, "round");
+        std::printf("\n");
+    }
+};
+
+#endif
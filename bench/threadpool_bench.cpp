@@ -0,0 +1,136 @@
+// 线程池性能测试  对两套接口、三种任务队列调度方式和不同线程数量依次运行各个场景
+// 用法: threadpool_bench [--threads 1,2,4] [--queue global,workstealing,lockfree] [--api legacy|final|all]
+//                        [--scenario throughput|latency|fanout|nested|bursty|producers|graph|all]
+//                        [--tasks N] [--samples N] [--fanout N] [--producers N]
+//                        [--bursts N] [--burst-gap-ms N] [--keep-alive-ms N] [--queue-capacity N] [--spin N]
+//                        [--affinity none|compact|scatter|0,2,4]
+// 每个结果输出一行key=value，默认的线程数量为2的幂直到可用CPU数量(受taskset和cgroup配额限制)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "bench.h"
+
+static std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> parts;
+    size_t begin = 0;
+    while (begin <= s.size()) {
+        size_t end = s.find(',', begin);
+        if (end == std::string::npos) {
+            end = s.size();
+        }
+        if (end > begin) {
+            parts.push_back(s.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    return parts;
+}
+
+static bool parseQueue(const std::string& name, QueueMode& mode) {
+    for (QueueMode m : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        if (name == queueName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usage(const char* prog) {
+    std::fprintf(stderr,
+        "usage: %s [--threads 1,2,4] [--queue global,workstealing,lockfree] [--api legacy|final|all]\n"
+        "          [--scenario throughput|latency|fanout|nested|bursty|producers|graph|all]\n"
+        "          [--tasks N] [--samples N] [--fanout N] [--producers N]\n"
+        "          [--bursts N] [--burst-gap-ms N] [--keep-alive-ms N] [--queue-capacity N] [--spin N]\n"
+        "          [--affinity none|compact|scatter|0,2,4]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") {
+            for (const auto& s : split(value)) {
+                opts.threads.push_back(std::strtoul(s.c_str(), nullptr, 10));
+            }
+        } else if (arg == "--queue") {
+            for (const auto& s : split(value)) {
+                QueueMode mode;
+                if (!parseQueue(s, mode)) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                opts.queues.push_back(mode);
+            }
+        } else if (arg == "--api") {
+            opts.api = value;
+        } else if (arg == "--scenario") {
+            opts.scenario = value;
+        } else if (arg == "--tasks") {
+            opts.tasks = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--samples") {
+            opts.samples = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--fanout") {
+            opts.fanout = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--producers") {
+            opts.producers = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--bursts") {
+            opts.bursts = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--burst-gap-ms") {
+            opts.burstGapMs = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--keep-alive-ms") {
+            opts.keepAliveMs = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--queue-capacity") {
+            opts.queueCapacity = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--spin") {
+            opts.spinBudget = std::strtol(value.c_str(), nullptr, 10);
+        } else if (arg == "--affinity") {
+            if (value == "none") {
+                opts.affinity = AffinityPolicy::Affinity_None;
+            } else if (value == "compact") {
+                opts.affinity = AffinityPolicy::Affinity_Compact;
+            } else if (value == "scatter") {
+                opts.affinity = AffinityPolicy::Affinity_Scatter;
+            } else {
+                opts.affinity = AffinityPolicy::Affinity_Explicit;
+                opts.affinityCpus = CpuTopology::parseCpuList(value);
+            }
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opts.threads.empty()) {
+        size_t hw = ThreadPoolBase::defaultThreadSize();
+        for (size_t n = 1; n < hw; n *= 2) {
+            opts.threads.push_back(n);
+        }
+        opts.threads.push_back(hw);
+    }
+    if (opts.queues.empty()) {
+        opts.queues = { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree };
+    }
+
+    for (size_t threads : opts.threads) {
+        for (QueueMode queue : opts.queues) {
+            if (opts.api == "all" || opts.api == "legacy") {
+                runLegacyBench(opts, BenchCase{ "legacy", queue, threads });
+            }
+            if (opts.api == "all" || opts.api == "final") {
+                runFinalBench(opts, BenchCase{ "final", queue, threads });
+            }
+            std::fflush(stdout);
+        }
+    }
+    return 0;
+}
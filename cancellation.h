@@ -0,0 +1,99 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+#include "pool_allocator.h"
+
+// 协作式取消  提交任务时传入CancellationToken，对应的CancellationSource取消后：
+// 还在队列中的任务被取出时直接丢弃，不执行(只检查一个标记，不需要在队列中查找)；
+// 执行中的任务用isCancelled()轮询，或调用throwIfCancelled()提前结束；
+// future接口的get()抛出TaskCancelled，Task/Result接口的cancelled()为true
+// 同一个来源的令牌可以交给任意多个任务，一次cancel()取消整组任务；
+// 子来源在父来源取消时也视为已取消，可以按层级(连接、请求)成组取消
+
+
+// 任务在开始前被取消，或执行中调用了throwIfCancelled()
+class TaskCancelled : public std::runtime_error {
+public:
+    TaskCancelled() : std::runtime_error("task cancelled") {}
+};
+
+
+class CancellationSource;
+
+// 取消令牌  只能查询，复制的代价为一次引用计数；默认构造的令牌永远不会被取消
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    // 自身或任一上级来源是否已经取消
+    bool isCancelled() const {
+        for (const State* s = state_.get(); s != nullptr; s = s->parent_.get()) {
+            if (s->cancelled_.load(std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 已经取消时抛出TaskCancelled
+    void throwIfCancelled() const {
+        if (isCancelled()) {
+            throw TaskCancelled();
+        }
+    }
+
+    // 是否关联了来源(默认构造的令牌没有)
+    bool canBeCancelled() const {
+        return state_ != nullptr;
+    }
+
+private:
+    struct State {
+        std::atomic_bool cancelled_{false};
+        std::shared_ptr<State> parent_;  // 上级来源
+    };
+
+    std::shared_ptr<State> state_;
+
+    friend class CancellationSource;
+};
+
+
+// 取消来源  持有者调用cancel()取消由它发出的所有令牌
+class CancellationSource {
+public:
+    CancellationSource()
+        : state_(std::allocate_shared<State>(PoolAllocator<State>())) {
+    }
+
+    // 子来源  parent取消时子来源的令牌也视为已取消，子来源取消不影响parent
+    explicit CancellationSource(const CancellationToken& parent)
+        : CancellationSource() {
+        state_->parent_ = parent.state_;
+    }
+
+    CancellationToken token() const {
+        CancellationToken token;
+        token.state_ = state_;
+        return token;
+    }
+
+    void cancel() {
+        state_->cancelled_.store(true, std::memory_order_release);
+    }
+
+    bool isCancelled() const {
+        return token().isCancelled();
+    }
+
+private:
+    using State = CancellationToken::State;
+
+    std::shared_ptr<State> state_;
+};
+
+#endif
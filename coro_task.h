@@ -0,0 +1,297 @@
+#ifndef CORO_TASK_H
+#define CORO_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <semaphore>
+#include <type_traits>
+#include <utility>
+
+#include "threadpool_base.h"
+#include "pool_allocator.h"
+
+// 协程支持  CoTask<T>是惰性启动的协程，被co_await时才开始执行，完成后直接恢复等待它的协程(对称转移)
+// 协程中co_await pool.schedule()切换到线程池的工作线程，之后的代码和CoTask的延续都在线程池中执行，
+// 等待期间不占用任何线程
+// 协程帧默认从BlockPool分配；协程的前两个参数为std::allocator_arg和分配器时改用该分配器
+//   CoTask<int> f(std::allocator_arg_t, MyAlloc alloc, int x);
+
+namespace coro_detail {
+
+// 协程帧的分配  帧之后依次存放释放函数和分配器，释放时不需要知道分配器的类型
+struct FrameAllocation {
+    using DeallocFunc = void (*)(void* frame, size_t size);
+
+    static void* operator new(size_t size) {
+        return allocate(size, PoolAllocator<char>());
+    }
+
+    template <typename Alloc, typename... Args>
+    static void* operator new(size_t size, std::allocator_arg_t, const Alloc& alloc, const Args&...) {
+        return allocate(size, alloc);
+    }
+
+    // 成员函数协程的第一个参数为对象本身
+    template <typename Self, typename Alloc, typename... Args>
+    static void* operator new(size_t size, const Self&, std::allocator_arg_t, const Alloc& alloc, const Args&...) {
+        return allocate(size, alloc);
+    }
+
+    static void operator delete(void* frame, size_t size) {
+        DeallocFunc dealloc = *reinterpret_cast<DeallocFunc*>(static_cast<char*>(frame) + funcOffset(size));
+        dealloc(frame, size);
+    }
+
+private:
+    static size_t alignUp(size_t n, size_t align) {
+        return (n + align - 1) / align * align;
+    }
+
+    static size_t funcOffset(size_t size) {
+        return alignUp(size, alignof(DeallocFunc));
+    }
+
+    template <typename ByteAlloc>
+    static size_t allocOffset(size_t size) {
+        return alignUp(funcOffset(size) + sizeof(DeallocFunc), alignof(ByteAlloc));
+    }
+
+    template <typename Alloc>
+    static void* allocate(size_t size, const Alloc& alloc) {
+        using ByteAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<char>;
+        ByteAlloc a(alloc);
+        size_t total = allocOffset<ByteAlloc>(size) + sizeof(ByteAlloc);
+        char* p = std::allocator_traits<ByteAlloc>::allocate(a, total);
+        *reinterpret_cast<DeallocFunc*>(p + funcOffset(size)) = &deallocate<ByteAlloc>;
+        ::new (p + allocOffset<ByteAlloc>(size)) ByteAlloc(std::move(a));
+        return p;
+    }
+
+    template <typename ByteAlloc>
+    static void deallocate(void* frame, size_t size) {
+        char* p = static_cast<char*>(frame);
+        ByteAlloc* stored = reinterpret_cast<ByteAlloc*>(p + allocOffset<ByteAlloc>(size));
+        ByteAlloc a(std::move(*stored));
+        stored->~ByteAlloc();
+        std::allocator_traits<ByteAlloc>::deallocate(a, p, allocOffset<ByteAlloc>(size) + sizeof(ByteAlloc));
+    }
+};
+
+// CoTask的promise公共部分  完成时转移到等待者，没有等待者时停在final_suspend，由CoTask释放
+struct PromiseBase : FrameAllocation {
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr error_;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            std::coroutine_handle<> next = h.promise().continuation_;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        error_ = std::current_exception();
+    }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value_;
+
+    template <typename U>
+    void return_value(U&& value) {
+        value_.emplace(std::forward<U>(value));
+    }
+
+    T result() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return std::move(*value_);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    void return_void() {}
+
+    void result() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+};
+
+}  // namespace coro_detail
+
+
+// 惰性启动的协程任务  只能移动，析构时释放协程帧；co_await得到返回值，协程抛出的异常在co_await处重新抛出
+template <typename T = void>
+class CoTask {
+public:
+    struct promise_type : coro_detail::Promise<T> {
+        CoTask get_return_object() {
+            return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    CoTask() = default;
+    ~CoTask() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    CoTask(CoTask&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    CoTask& operator=(CoTask&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    bool await_ready() const noexcept {
+        return !handle_ || handle_.done();
+    }
+
+    // 记录等待者后直接转移到本协程执行
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation_ = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {
+        return handle_.promise().result();
+    }
+
+private:
+    explicit CoTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+
+namespace coro_detail {
+
+// syncWait的包装协程  CoTask完成后在final_suspend中通知等待的线程，协程帧由syncWait释放
+struct SyncWaiter {
+    struct promise_type : FrameAllocation {
+        std::binary_semaphore* done_ = nullptr;
+
+        SyncWaiter get_return_object() {
+            return SyncWaiter{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        auto final_suspend() noexcept {
+            struct Notify {
+                bool await_ready() noexcept {
+                    return false;
+                }
+                // 协程已经挂起，release之后等待的线程可以立即释放协程帧
+                void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    h.promise().done_->release();
+                }
+                void await_resume() noexcept {}
+            };
+            return Notify{};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// 等待task完成，把返回值或异常存入value和error
+template <typename T, typename Value>
+SyncWaiter waitFor(CoTask<T>& task, Value& value, std::exception_ptr& error) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+        } else {
+            value.emplace(co_await task);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+}
+
+// spawn的包装协程  开始时即执行，结束后自行释放协程帧
+struct Detached {
+    struct promise_type : FrameAllocation {
+        Detached get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+inline Detached spawnOn(ThreadPoolBase& pool, CoTask<void> task) {
+    co_await pool.schedule();
+    co_await task;
+}
+
+}  // namespace coro_detail
+
+
+// 在当前线程启动task并阻塞等待其完成，返回结果或重新抛出异常  用于从普通代码进入协程
+// 会占住调用线程，不要在工作线程中对需要本线程池才能完成的task调用
+template <typename T>
+T syncWait(CoTask<T> task) {
+    std::binary_semaphore done(0);
+    std::conditional_t<std::is_void_v<T>, bool, std::optional<T>> value{};
+    std::exception_ptr error;
+    coro_detail::SyncWaiter waiter = coro_detail::waitFor(task, value, error);
+    waiter.handle_.promise().done_ = &done;
+    waiter.handle_.resume();
+    done.acquire();
+    waiter.handle_.destroy();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>) {
+        return std::move(*value);
+    }
+}
+
+// 在线程池中启动task，不等待其完成  task抛出未处理的异常时调用std::terminate(与std::thread一致)
+inline void spawn(ThreadPoolBase& pool, CoTask<void> task) {
+    coro_detail::spawnOn(pool, std::move(task));
+}
+
+#endif
@@ -0,0 +1,386 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// 线程的CPU绑定策略
+enum class AffinityPolicy {
+    Affinity_None,  // 不绑定，由系统调度
+    Affinity_Compact,  // 依次占满同一NUMA节点、同一末级缓存内的CPU，线程之间共享缓存
+    Affinity_Scatter,  // 轮流分布到不同的末级缓存和物理核上，每个线程独占尽可能多的缓存和核
+    Affinity_Explicit,  // 按给定的CPU列表依次绑定
+};
+
+
+// 一个可用CPU的拓扑位置  id在整个系统内唯一，读取失败的字段为-1
+struct CpuInfo {
+    int cpu_;  // 逻辑CPU编号
+    int core_;  // 物理核
+    int llc_;  // 末级缓存
+    int node_;  // NUMA节点
+};
+
+
+// 当前进程可用CPU的拓扑  可用CPU取自sched_getaffinity(受taskset和cpuset限制)，位置信息取自/sys
+// 非Linux系统上退化为hardware_concurrency个没有位置信息的CPU
+class CpuTopology {
+public:
+    // 读取当前进程的CPU拓扑
+    static CpuTopology detect() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            CpuTopology topo;
+            unsigned n = std::max(std::thread::hardware_concurrency(), 1u);
+            for (unsigned cpu = 0; cpu < n; cpu++) {
+                topo.cpus_.push_back(CpuInfo{ int(cpu), -1, -1, -1 });
+            }
+            return topo;
+        }
+        return load(cpus);
+    }
+
+    // 按给定的可用CPU读取拓扑  root为/sys和/proc所在的根目录，测试时指向准备好的目录
+    static CpuTopology load(const std::vector<int>& cpus, const std::string& root = "") {
+        CpuTopology topo;
+        topo.root_ = root;
+        std::map<int, int> nodes = readNodes(root);
+        for (int cpu : cpus) {
+            topo.cpus_.push_back(readCpu(root, cpu, nodes));
+        }
+        return topo;
+    }
+
+    const std::vector<CpuInfo>& cpus() const {
+        return cpus_;
+    }
+
+    // 查找逻辑CPU的拓扑位置，不在可用集合中时返回没有位置信息的CpuInfo
+    CpuInfo find(int cpu) const {
+        for (const CpuInfo& info : cpus_) {
+            if (info.cpu_ == cpu) {
+                return info;
+            }
+        }
+        return CpuInfo{ cpu, -1, -1, -1 };
+    }
+
+    // 默认线程数量  可用CPU数量，并且不超过cgroup的CPU配额
+    size_t defaultThreadSize() const {
+        size_t n = cpus_.size();
+        double quota = cpuQuota(root_);
+        if (quota > 0) {
+            n = std::min(n, size_t(std::ceil(quota)));
+        }
+        return std::max<size_t>(n, 1);
+    }
+
+    // 按策略为count个线程分配CPU，返回每个线程绑定的逻辑CPU，线程多于CPU时循环使用
+    // Affinity_None或没有可用CPU时返回空
+    std::vector<int> place(AffinityPolicy policy, size_t count, const std::vector<int>& explicitCpus = {}) const {
+        std::vector<int> order;
+        switch (policy) {
+        case AffinityPolicy::Affinity_None:
+            return {};
+        case AffinityPolicy::Affinity_Explicit:
+            order = explicitCpus;
+            break;
+        case AffinityPolicy::Affinity_Compact:
+            order = compactOrder();
+            break;
+        case AffinityPolicy::Affinity_Scatter:
+            order = scatterOrder();
+            break;
+        }
+        std::vector<int> placed;
+        for (size_t i = 0; i < count && !order.empty(); i++) {
+            placed.push_back(order[i % order.size()]);
+        }
+        return placed;
+    }
+
+    // cgroup限制的CPU核数(quota/period)，没有限制或读取失败时返回0
+    // 优先读取cgroup v2的cpu.max，并逐级检查上层cgroup取最小值；没有v2时读取v1的cfs配额
+    // root为/proc和cgroup挂载点所在的根目录
+    static double cpuQuota(const std::string& root = "") {
+        double quota = 0;
+        std::string v2Root, v2Path, v1Root, v1Path;
+        findCgroup(root, v2Root, v2Path, v1Root, v1Path);
+
+        if (!v2Root.empty()) {
+            for (std::string path = v2Path; ; path = parentPath(path)) {
+                std::string max, period;
+                std::ifstream in(v2Root + path + "/cpu.max");
+                if (in >> max >> period && max != "max") {
+                    double q = std::stod(max) / std::max(std::stod(period), 1.0);
+                    quota = quota > 0 ? std::min(quota, q) : q;
+                }
+                if (path.empty() || path == "/") {
+                    break;
+                }
+            }
+        }
+        if (quota == 0 && !v1Root.empty()) {
+            long long q = readNumber(v1Root + v1Path + "/cpu.cfs_quota_us");
+            long long period = readNumber(v1Root + v1Path + "/cpu.cfs_period_us");
+            if (q > 0 && period > 0) {
+                quota = double(q) / double(period);
+            }
+        }
+        return quota;
+    }
+
+    // 将当前线程绑定到指定的逻辑CPU，失败(如CPU不在cpuset中)时返回false
+    static bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    // 解析"0-3,8,10-11"格式的CPU列表
+    static std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++) {
+                    cpus.push_back(cpu);
+                }
+            } catch (...) {
+            }
+        }
+        return cpus;
+    }
+
+private:
+    std::vector<CpuInfo> cpus_;
+    std::string root_;  // 读取拓扑的根目录，计算cgroup配额时使用同一个目录
+
+    // 按NUMA节点、末级缓存、物理核排列，同一物理核的超线程相邻
+    std::vector<int> compactOrder() const {
+        std::vector<CpuInfo> sorted = cpus_;
+        std::stable_sort(sorted.begin(), sorted.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.node_, a.llc_, a.core_, a.cpu_) < std::tie(b.node_, b.llc_, b.core_, b.cpu_);
+        });
+        std::vector<int> order;
+        for (const CpuInfo& info : sorted) {
+            order.push_back(info.cpu_);
+        }
+        return order;
+    }
+
+    // 轮流从每个末级缓存中取一个CPU，每个缓存内先取不同的物理核，再取超线程
+    std::vector<int> scatterOrder() const {
+        std::map<std::pair<int, int>, std::vector<CpuInfo>> groups;
+        for (const CpuInfo& info : cpus_) {
+            groups[{ info.node_, info.llc_ }].push_back(info);
+        }
+        std::vector<std::vector<int>> lists;
+        for (auto& group : groups) {
+            std::vector<CpuInfo>& cpus = group.second;
+            // 按在同一物理核中的序号排序，序号相同时按物理核
+            std::map<int, int> seen;
+            std::vector<std::pair<int, CpuInfo>> ranked;
+            for (const CpuInfo& info : cpus) {
+                ranked.push_back({ seen[info.core_]++, info });
+            }
+            std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+                return std::tie(a.first, a.second.core_) < std::tie(b.first, b.second.core_);
+            });
+            lists.emplace_back();
+            for (const auto& r : ranked) {
+                lists.back().push_back(r.second.cpu_);
+            }
+        }
+        std::vector<int> order;
+        for (size_t i = 0; order.size() < cpus_.size(); i++) {
+            for (const auto& list : lists) {
+                if (i < list.size()) {
+                    order.push_back(list[i]);
+                }
+            }
+        }
+        return order;
+    }
+
+    static long long readNumber(const std::string& path) {
+        std::ifstream in(path);
+        long long value = -1;
+        if (!(in >> value)) {
+            return -1;
+        }
+        return value;
+    }
+
+    static std::string readLine(const std::string& path) {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    // 读取每个逻辑CPU所属的NUMA节点  节点的CPU列表只读取一次，不为每个CPU重复读取
+    static std::map<int, int> readNodes(const std::string& root) {
+        std::map<int, int> nodes;
+        std::string dir = root + "/sys/devices/system/node";
+        for (int node : parseCpuList(readLine(dir + "/online"))) {
+            for (int cpu : parseCpuList(readLine(dir + "/node" + std::to_string(node) + "/cpulist"))) {
+                nodes.emplace(cpu, node);
+            }
+        }
+        return nodes;
+    }
+
+    // 读取逻辑CPU的物理核和末级缓存，NUMA节点取自readNodes的结果
+    static CpuInfo readCpu(const std::string& root, int cpu, const std::map<int, int>& nodes) {
+        std::string dir = root + "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        CpuInfo info{ cpu, -1, -1, -1 };
+
+        // core_id只在同一封装内唯一
+        long long package = readNumber(dir + "/topology/physical_package_id");
+        long long core = readNumber(dir + "/topology/core_id");
+        if (core >= 0) {
+            info.core_ = int(std::max(package, 0LL) * 65536 + core);
+        }
+
+        // 级别最高的缓存为末级缓存，以共享它的最小CPU编号作为id
+        int level = 0;
+        for (int index = 0; ; index++) {
+            std::string cache = dir + "/cache/index" + std::to_string(index);
+            long long l = readNumber(cache + "/level");
+            if (l < 0) {
+                break;
+            }
+            std::vector<int> shared = parseCpuList(readLine(cache + "/shared_cpu_list"));
+            if (l > level && !shared.empty()) {
+                level = int(l);
+                info.llc_ = *std::min_element(shared.begin(), shared.end());
+            }
+        }
+
+        auto it = nodes.find(cpu);
+        if (it != nodes.end()) {
+            info.node_ = it->second;
+        }
+        return info;
+    }
+
+    // 从/proc/self/cgroup和/proc/self/mountinfo找出当前进程的cgroup目录
+    // v2为挂载点加"0::"行的路径；v1为cpu控制器的挂载点加对应行的路径
+    static void findCgroup(const std::string& root, std::string& v2Root, std::string& v2Path,
+                           std::string& v1Root, std::string& v1Path) {
+        std::ifstream cgroup(root + "/proc/self/cgroup");
+        std::string line;
+        while (std::getline(cgroup, line)) {
+            size_t first = line.find(':');
+            size_t second = line.find(':', first + 1);
+            if (first == std::string::npos || second == std::string::npos) {
+                continue;
+            }
+            std::string controllers = line.substr(first + 1, second - first - 1);
+            std::string path = line.substr(second + 1);
+            if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+                v2Path = path;
+            } else if (hasController(controllers, "cpu")) {
+                v1Path = path;
+            }
+        }
+
+        std::ifstream mounts(root + "/proc/self/mountinfo");
+        while (std::getline(mounts, line)) {
+            // 格式: id parent major:minor root mountpoint options ... - fstype source superoptions
+            std::stringstream ss(line);
+            std::string field, mountPoint;
+            std::vector<std::string> fields;
+            while (ss >> field) {
+                fields.push_back(field);
+            }
+            auto sep = std::find(fields.begin(), fields.end(), "-");
+            if (fields.size() < 5 || sep == fields.end() || sep + 3 > fields.end()) {
+                continue;
+            }
+            mountPoint = fields[4];
+            const std::string& type = *(sep + 1);
+            if (type == "cgroup2" && v2Root.empty()) {
+                v2Root = root + mountPoint;
+                v2Path = relativePath(v2Path, fields[3]);
+            } else if (type == "cgroup" && v1Root.empty() && hasController(*(sep + 3), "cpu")) {
+                v1Root = root + mountPoint;
+                v1Path = relativePath(v1Path, fields[3]);
+            }
+        }
+
+        // 没有对应的cgroup行时不读取该版本
+        if (v2Path.empty()) {
+            v2Root.clear();
+        }
+        if (v1Path.empty()) {
+            v1Root.clear();
+        }
+    }
+
+    // 挂载的不是cgroup层级的根目录时(如容器内)，去掉路径中挂载根目录的部分
+    static std::string relativePath(const std::string& path, const std::string& mountRoot) {
+        if (path.empty() || mountRoot == "/" || path.compare(0, mountRoot.size(), mountRoot) != 0) {
+            return path;
+        }
+        std::string rest = path.substr(mountRoot.size());
+        return rest.empty() ? "/" : rest;
+    }
+
+    // 逗号分隔的列表中是否有指定的控制器
+    static bool hasController(const std::string& list, const std::string& name) {
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (item == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static std::string parentPath(const std::string& path) {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos || slash == 0 ? "/" : path.substr(0, slash);
+    }
+};
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef FAIR_EXECUTOR_H
+#define FAIR_EXECUTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "threadpool_base.h"
+#include "ring_deque.h"
+#include "pool_stats.h"
+#include "pool_allocator.h"
+
+// 按权重公平共享线程池的子执行器  多个租户共用同一组工作线程，不额外创建线程
+// 每个子执行器有自己的任务队列、权重和可选的并发上限；提交任务时放入子执行器的队列，
+// 同时向线程池提交一个调度作业，作业执行时按权重选出下一个子执行器并执行它的一个任务(不一定是提交者的)，
+// 某个租户大量提交时线程池队列中只多了调度作业，其他租户的任务仍按权重得到执行机会
+// 调度按虚拟时间(stride scheduling)：每个子执行器的虚拟时间按任务的执行时间÷权重增长，
+// 总是选择虚拟时间最小、且未达到并发上限的子执行器；空闲后重新提交的子执行器不会积攒之前的份额
+// 选择时对有任务的子执行器线性扫描，适合数量不多的租户
+//   FairExecutor fair(pool);
+//   SubExecutor& a = fair.addExecutor(3);     // 权重3
+//   SubExecutor& b = fair.addExecutor(1, 2);  // 权重1，最多同时执行2个任务
+//   a.post([] { ... });
+//   auto f = b.submitTask([](int x) { return x; }, 1);
+
+class FairExecutor;
+
+// 子执行器的运行统计
+struct SubExecutorStats {
+    unsigned weight_ = 0;  // 权重
+    size_t maxConcurrency_ = 0;  // 并发上限，0为不限
+    size_t queued_ = 0;  // 队列中的任务数量
+    size_t running_ = 0;  // 正在执行的任务数量
+    size_t queueHighWater_ = 0;  // 队列中任务数量的历史最大值
+    WorkerStats tasks_;  // 执行的任务数量、等待时间和执行时间
+};
+
+
+// 子执行器  由FairExecutor创建和持有，地址在FairExecutor析构之前保持不变
+class SubExecutor {
+public:
+    SubExecutor(const SubExecutor&) = delete;
+    SubExecutor& operator=(const SubExecutor&) = delete;
+
+    // 提交不需要返回值的任务  任务抛出的异常不会被捕获(与直接提交给线程池的作业相同)
+    template <typename Func>
+    void post(Func&& func);
+
+    // 提交任务，返回future  func的返回值或异常存入future
+    template <typename Func, typename... Args>
+    auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))>;
+
+    // 调整权重和并发上限(maxConcurrency为0时不限)
+    void setWeight(unsigned weight);
+    void setMaxConcurrency(size_t maxConcurrency);
+
+    SubExecutorStats stats() const;
+
+private:
+    struct Item {
+        TaskFunc func_;
+        uint64_t enqueueTime_ = 0;
+    };
+
+    SubExecutor(FairExecutor& owner, unsigned weight, size_t maxConcurrency)
+        : owner_(owner),
+          weight_(std::max(weight, 1u)),
+          maxConcurrency_(maxConcurrency),
+          running_(0),
+          active_(false),
+          vtime_(0),
+          avgExecNs_(INITIAL_EXEC_NS),
+          queueHighWater_(0) {
+    }
+
+    static constexpr int64_t INITIAL_EXEC_NS = 1000;  // 执行时间的初始估计
+    static constexpr int64_t VTIME_SCALE = 1024;  // 虚拟时间的放大倍数，保留小权重时的精度
+
+    // 以下成员由owner_.mutex_保护，counters_除外
+    FairExecutor& owner_;
+    RingDeque<Item> queue_;
+    unsigned weight_;
+    size_t maxConcurrency_;
+    size_t running_;
+    bool active_;  // 是否在owner_的候选列表中(队列不为空)
+    int64_t vtime_;  // 虚拟时间
+    int64_t avgExecNs_;  // 最近任务执行时间的滑动平均，选中时按它预先计入虚拟时间
+    size_t queueHighWater_;
+    WorkerCounters counters_{true};  // 任务在多个工作线程上执行，计数共用
+
+    bool eligible() const {
+        return maxConcurrency_ == 0 || running_ < maxConcurrency_;
+    }
+
+    int64_t charge(int64_t ns) const {
+        return ns * VTIME_SCALE / int64_t(weight_);
+    }
+
+    friend class FairExecutor;
+};
+
+
+class FairExecutor {
+public:
+    explicit FairExecutor(ThreadPoolBase& pool)
+        : pool_(pool),
+          deferred_(0),
+          vclock_(0) {
+    }
+
+    // 等待所有已提交的任务执行完，期间帮忙执行线程池中的任务；需在线程池关闭之前析构
+    ~FairExecutor() {
+        pool_.helpUntil(pending_);
+    }
+
+    FairExecutor(const FairExecutor&) = delete;
+    FairExecutor& operator=(const FairExecutor&) = delete;
+
+    // 添加子执行器  weight为权重(至少为1)，maxConcurrency为同时执行的任务数量上限(0为不限)
+    SubExecutor& addExecutor(unsigned weight = 1, size_t maxConcurrency = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        executors_.emplace_back(new SubExecutor(*this, weight, maxConcurrency));
+        return *executors_.back();
+    }
+
+    // 所有子执行器的运行统计，顺序与添加顺序相同
+    std::vector<SubExecutorStats> stats() const {
+        std::vector<SubExecutorStats> all;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& e : executors_) {
+            all.push_back(statsLocked(*e));
+        }
+        return all;
+    }
+
+private:
+    ThreadPoolBase& pool_;
+    mutable std::mutex mutex_;  // 保护所有子执行器的队列和调度状态
+    std::vector<std::unique_ptr<SubExecutor>> executors_;
+    std::vector<SubExecutor*> candidates_;  // 队列不为空的子执行器
+    CompletionCounter pending_;  // 尚未完成的任务数量(即尚未完成的调度作业数量)
+    size_t deferred_;  // 没有可执行的子执行器(都达到并发上限)而推迟的调度作业数量
+    int64_t vclock_;  // 最近选中的子执行器的虚拟时间，重新变为非空的子执行器从这里开始
+
+    friend class SubExecutor;
+
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 放入子执行器的队列并提交一个调度作业，线程池队列已满时在当前线程调度
+    void enqueue(SubExecutor& e, TaskFunc func) {
+        pending_.add();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            e.queue_.push_back(SubExecutor::Item{ std::move(func), nowNs() });
+            e.queueHighWater_ = std::max(e.queueHighWater_, e.queue_.size());
+            if (!e.active_) {
+                e.active_ = true;
+                e.vtime_ = std::max(e.vtime_, vclock_);
+                candidates_.push_back(&e);
+            }
+        }
+        postDispatch();
+    }
+
+    // 向线程池提交一个调度作业，线程池队列已满时在当前线程调度
+    void postDispatch() {
+        ThreadPoolBase::Job job = [this]() { dispatch(); };
+        if (!pool_.tryPost(job)) {
+            job();
+        }
+    }
+
+    // 选出虚拟时间最小、未达到并发上限的子执行器，没有时返回nullptr
+    SubExecutor* pickLocked() {
+        SubExecutor* best = nullptr;
+        for (SubExecutor* e : candidates_) {
+            if (e->eligible() && (best == nullptr || e->vtime_ < best->vtime_)) {
+                best = e;
+            }
+        }
+        return best;
+    }
+
+    // 调度作业  每个作业执行一个任务；任务完成后还有被推迟的作业时，由当前线程接着调度
+    // 任务抛出的异常在记录完成之后重新抛出，被推迟的作业改为另行提交
+    void dispatch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            SubExecutor* e = pickLocked();
+            if (e == nullptr) {
+                // 有任务的子执行器都达到了并发上限，等它们的任务完成后再调度
+                deferred_++;
+                return ;
+            }
+
+            SubExecutor::Item item = std::move(e->queue_.front());
+            e->queue_.pop_front();
+            if (e->queue_.empty()) {
+                e->active_ = false;
+                candidates_.erase(std::find(candidates_.begin(), candidates_.end(), e));
+            }
+            e->running_++;
+            int64_t estimate = e->avgExecNs_;
+            e->vtime_ += e->charge(estimate);
+            vclock_ = std::max(vclock_, e->vtime_ - e->charge(estimate));
+            lock.unlock();
+
+            uint64_t start = nowNs();
+            std::exception_ptr error;
+            try {
+                item.func_();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            uint64_t execNs = nowNs() - start;
+            e->counters_.recordTask(start > item.enqueueTime_ ? start - item.enqueueTime_ : 0, execNs);
+            e->counters_.addBusy(execNs);
+
+            lock.lock();
+            e->running_--;
+            e->vtime_ += e->charge(int64_t(execNs) - estimate);
+            e->avgExecNs_ += (int64_t(execNs) - e->avgExecNs_) / 8;
+            bool more = deferred_ > 0;
+            if (more) {
+                deferred_--;
+            }
+            lock.unlock();
+
+            // 被推迟的作业也计入pending_，还有作业时计数不会归零；否则计数归零之后FairExecutor随时可能被释放
+            if (error) {
+                if (more) {
+                    postDispatch();
+                }
+                pending_.done();
+                std::rethrow_exception(error);
+            }
+            pending_.done();
+            if (!more) {
+                return ;
+            }
+            lock.lock();
+        }
+    }
+
+    SubExecutorStats statsLocked(const SubExecutor& e) const {
+        SubExecutorStats stats;
+        stats.weight_ = e.weight_;
+        stats.maxConcurrency_ = e.maxConcurrency_;
+        stats.queued_ = e.queue_.size();
+        stats.running_ = e.running_;
+        stats.queueHighWater_ = e.queueHighWater_;
+        stats.tasks_ = e.counters_.snapshot();
+        return stats;
+    }
+};
+
+
+template <typename Func>
+void SubExecutor::post(Func&& func) {
+    owner_.enqueue(*this, TaskFunc(std::forward<Func>(func)));
+}
+
+template <typename Func, typename... Args>
+auto SubExecutor::submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+    using RType = decltype(func(args...));
+    std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+    std::future<RType> result = promise.get_future();
+    owner_.enqueue(*this, [promise = std::move(promise),
+                           func = std::forward<Func>(func),
+                           args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        try {
+            if constexpr (std::is_void_v<RType>) {
+                std::apply(func, args);
+                promise.set_value();
+            } else {
+                promise.set_value(std::apply(func, args));
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    });
+    return result;
+}
+
+inline void SubExecutor::setWeight(unsigned weight) {
+    std::lock_guard<std::mutex> lock(owner_.mutex_);
+    weight_ = std::max(weight, 1u);
+}
+
+inline void SubExecutor::setMaxConcurrency(size_t maxConcurrency) {
+    {
+        std::lock_guard<std::mutex> lock(owner_.mutex_);
+        maxConcurrency_ = maxConcurrency;
+        if (owner_.deferred_ == 0) {
+            return ;
+        }
+        // 上限提高后被推迟的调度作业可能可以执行了
+        owner_.deferred_--;
+    }
+    owner_.postDispatch();
+}
+
+inline SubExecutorStats SubExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(owner_.mutex_);
+    return owner_.statsLocked(*this);
+}
+
+#endif
@@ -0,0 +1,813 @@
+#ifndef IO_REACTOR_H
+#define IO_REACTOR_H
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define THREADPOOL_HAS_IO_URING 1
+#endif
+
+#include "threadpool_base.h"
+#include "pool_allocator.h"
+
+// I/O反应器(只支持Linux)  任务等待fd就绪或读写完成时不再阻塞在系统调用中占住工作线程，
+// Cached模式下也不会因此不断扩充线程；完成后回调作为线程池的任务执行，或在工作线程中恢复等待的协程
+// 一个轮询线程阻塞在epoll_wait中等待就绪事件，它不执行任务，只把完成的操作交给线程池(队列已满时在轮询线程执行)
+// 读写操作在io_uring可用时提交给io_uring(直接调用系统调用，不依赖liburing)，由内核完成，不需要先等待就绪；
+// 否则等待fd就绪后在工作线程中执行read/write，普通文件不支持epoll，直接在工作线程中执行
+// 结果：等待就绪为epoll事件(EPOLLIN等)，读写为字节数，失败为-errno，被取消为-ECANCELED
+//   IoReactor io(pool);
+//   io.read(fd, buf, sizeof(buf), -1, [](ssize_t n) { ... });
+//   CoTask<void> echo(IoReactor& io, int fd) {
+//       char buf[256];
+//       ssize_t n = co_await io.asyncRead(fd, buf, sizeof(buf));
+//       co_await io.asyncWrite(fd, buf, n);
+//   }
+
+enum class IoBackend {
+    Backend_Auto,  // io_uring可用时使用io_uring，否则使用epoll
+    Backend_Epoll,  // 只用epoll，读写在fd就绪后由工作线程执行
+    Backend_Uring,  // 读写提交给io_uring，不可用时退回epoll
+};
+
+namespace io_detail {
+
+// 一次I/O操作  同一时刻只在一个链表中(等待就绪、等待提交或已提交给io_uring)
+struct IoOp {
+    enum Kind { Op_Readable, Op_Writable, Op_Read, Op_Write };
+
+    Kind kind_ = Op_Readable;
+    int fd_ = -1;
+    iovec iov_{};
+    int64_t offset_ = -1;  // 小于0时从文件的当前位置读写
+    ssize_t result_ = 0;
+    bool cancelRequested_ = false;  // 已提交给io_uring，提交队列已满而暂缓提交取消请求
+    IoOp* prev_ = nullptr;
+    IoOp* next_ = nullptr;
+
+    // 以结果完成操作，在线程池中执行；之后不再访问op，op可能已被释放
+    virtual void complete(ssize_t result) = 0;
+
+    bool reading() const {
+        return kind_ == Op_Readable || kind_ == Op_Read;
+    }
+
+protected:
+    ~IoOp() = default;
+};
+
+// 以回调完成的操作  从内存块池分配，调用回调之前释放
+template <typename Func>
+struct CallbackOp final : IoOp {
+    Func func_;
+
+    explicit CallbackOp(Func func) : func_(std::move(func)) {}
+
+    void complete(ssize_t result) override {
+        Func func = std::move(func_);
+        this->~CallbackOp();
+        BlockPool::deallocate(this, sizeof(CallbackOp));
+        func(result);
+    }
+};
+
+// 侵入式双向链表
+struct OpList {
+    IoOp* head_ = nullptr;
+    IoOp* tail_ = nullptr;
+
+    bool empty() const {
+        return head_ == nullptr;
+    }
+
+    void push(IoOp* op) {
+        op->prev_ = tail_;
+        op->next_ = nullptr;
+        (tail_ != nullptr ? tail_->next_ : head_) = op;
+        tail_ = op;
+    }
+
+    void remove(IoOp* op) {
+        (op->prev_ != nullptr ? op->prev_->next_ : head_) = op->next_;
+        (op->next_ != nullptr ? op->next_->prev_ : tail_) = op->prev_;
+        op->prev_ = nullptr;
+        op->next_ = nullptr;
+    }
+
+    // 把other的节点接到末尾
+    void splice(OpList& other) {
+        if (other.empty()) {
+            return ;
+        }
+        if (empty()) {
+            head_ = other.head_;
+        } else {
+            tail_->next_ = other.head_;
+            other.head_->prev_ = tail_;
+        }
+        tail_ = other.tail_;
+        other.head_ = nullptr;
+        other.tail_ = nullptr;
+    }
+};
+
+}  // namespace io_detail
+
+
+class IoReactor {
+public:
+    static constexpr unsigned DEFAULT_ENTRIES = 256;  // io_uring提交队列的长度
+
+    // 创建epoll和轮询线程，backend为Backend_Auto或Backend_Uring时尝试创建io_uring
+    // 创建epoll或eventfd失败时抛出std::system_error
+    explicit IoReactor(ThreadPoolBase& pool, IoBackend backend = IoBackend::Backend_Auto,
+                       unsigned entries = DEFAULT_ENTRIES)
+        : pool_(pool),
+          backend_(IoBackend::Backend_Epoll),
+          epollFd_(-1),
+          wakeFd_(-1),
+          stopping_(false) {
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ < 0) {
+            throw std::system_error(errno, std::system_category(), "epoll_create1");
+        }
+        wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (wakeFd_ < 0) {
+            int err = errno;
+            ::close(epollFd_);
+            throw std::system_error(err, std::system_category(), "eventfd");
+        }
+        watch(wakeFd_);
+#ifdef THREADPOOL_HAS_IO_URING
+        if (backend != IoBackend::Backend_Epoll && ring_.setup(entries)) {
+            backend_ = IoBackend::Backend_Uring;
+            watch(ring_.fd_);
+        }
+#else
+        (void)backend;
+        (void)entries;
+#endif
+        poller_ = std::thread(&IoReactor::pollLoop, this);
+    }
+
+    // 取消所有未完成的操作(回调得到-ECANCELED)，等待已提交给内核的读写结束；需在线程池关闭之前析构
+    ~IoReactor() {
+        stopping_ = true;
+        wake();
+        poller_.join();
+
+        // 等待交给工作线程执行的读写完成，期间帮忙执行线程池中的任务
+        pool_.helpUntil(outstanding_);
+#ifdef THREADPOOL_HAS_IO_URING
+        ring_.close();
+#endif
+        ::close(wakeFd_);
+        ::close(epollFd_);
+    }
+
+    IoReactor(const IoReactor&) = delete;
+    IoReactor& operator=(const IoReactor&) = delete;
+
+    // 实际使用的后端(Backend_Epoll或Backend_Uring)
+    IoBackend backend() const {
+        return backend_;
+    }
+
+    // fd可读(或出错、对端关闭)时以epoll事件调用func(ssize_t)  一次性，需要继续等待时重新调用
+    template <typename Func>
+    void onReadable(int fd, Func&& func) {
+        start(makeOp(io_detail::IoOp::Op_Readable, fd, nullptr, 0, -1, std::forward<Func>(func)));
+    }
+
+    template <typename Func>
+    void onWritable(int fd, Func&& func) {
+        start(makeOp(io_detail::IoOp::Op_Writable, fd, nullptr, 0, -1, std::forward<Func>(func)));
+    }
+
+    // 读取最多len字节，完成时以读到的字节数(0为文件结束)调用func(ssize_t)  offset小于0时从当前位置读取
+    // buf在完成之前必须保持有效
+    template <typename Func>
+    void read(int fd, void* buf, size_t len, int64_t offset, Func&& func) {
+        start(makeOp(io_detail::IoOp::Op_Read, fd, buf, len, offset, std::forward<Func>(func)));
+    }
+
+    template <typename Func>
+    void write(int fd, const void* buf, size_t len, int64_t offset, Func&& func) {
+        start(makeOp(io_detail::IoOp::Op_Write, fd, const_cast<void*>(buf), len, offset, std::forward<Func>(func)));
+    }
+
+    // co_await的操作  完成后在工作线程中恢复协程，co_await的结果与回调的参数相同
+    class Awaiter final : private io_detail::IoOp {
+    public:
+        Awaiter(IoReactor& reactor, Kind kind, int fd, void* buf, size_t len, int64_t offset)
+            : reactor_(reactor) {
+            reactor.init(this, kind, fd, buf, len, offset);
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        // 操作可能在start返回之前就在其他线程完成并恢复协程，之后不再访问成员
+        void await_suspend(std::coroutine_handle<> h) {
+            handle_ = h;
+            reactor_.start(this);
+        }
+
+        ssize_t await_resume() const noexcept {
+            return result_;
+        }
+
+    private:
+        IoReactor& reactor_;
+        std::coroutine_handle<> handle_;
+
+        void complete(ssize_t result) override {
+            result_ = result;
+            handle_.resume();
+        }
+    };
+
+    Awaiter readable(int fd) {
+        return Awaiter(*this, io_detail::IoOp::Op_Readable, fd, nullptr, 0, -1);
+    }
+
+    Awaiter writable(int fd) {
+        return Awaiter(*this, io_detail::IoOp::Op_Writable, fd, nullptr, 0, -1);
+    }
+
+    Awaiter asyncRead(int fd, void* buf, size_t len, int64_t offset = -1) {
+        return Awaiter(*this, io_detail::IoOp::Op_Read, fd, buf, len, offset);
+    }
+
+    Awaiter asyncWrite(int fd, const void* buf, size_t len, int64_t offset = -1) {
+        return Awaiter(*this, io_detail::IoOp::Op_Write, fd, const_cast<void*>(buf), len, offset);
+    }
+
+    // 取消fd上所有未完成的操作(得到-ECANCELED)并从epoll中删除；关闭有过等待的fd之前调用，
+    // 否则epoll中的登记可能随dup出的fd留下，之后复用同一个fd号时收不到事件
+    void cancel(int fd) {
+        io_detail::OpList cancelled;
+        {
+            std::lock_guard<std::mutex> lock(fdMutex_);
+            auto it = fds_.find(fd);
+            if (it != fds_.end()) {
+                cancelled.splice(it->second.readers_);
+                cancelled.splice(it->second.writers_);
+                if (it->second.registered_) {
+                    epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+                }
+                fds_.erase(it);
+            }
+        }
+#ifdef THREADPOOL_HAS_IO_URING
+        if (backend_ == IoBackend::Backend_Uring) {
+            std::lock_guard<std::mutex> lock(ring_.mutex_);
+            for (io_detail::IoOp* op = ring_.inflight_.head_; op != nullptr; op = op->next_) {
+                if (op->fd_ == fd) {
+                    ring_.pushCancel(op);
+                }
+            }
+            for (io_detail::IoOp* op = ring_.backlog_.head_; op != nullptr; ) {
+                io_detail::IoOp* next = op->next_;
+                if (op->fd_ == fd) {
+                    ring_.backlog_.remove(op);
+                    cancelled.push(op);
+                }
+                op = next;
+            }
+            ring_.enter();
+        }
+#endif
+        finishAll(cancelled, -ECANCELED);
+    }
+
+    // 尚未完成的操作数量
+    size_t pending() const {
+        return outstanding_.count();
+    }
+
+private:
+    // fd的等待者  EPOLLONESHOT登记，每次事件后按剩余的等待者重新登记
+    struct FdEntry {
+        io_detail::OpList readers_;
+        io_detail::OpList writers_;
+        bool registered_ = false;  // 已加入epoll(可能因fd关闭被内核删除)
+    };
+
+#ifdef THREADPOOL_HAS_IO_URING
+    // io_uring的提交队列和完成队列  提交者持有mutex_，完成队列只由轮询线程读取
+    struct Ring {
+        int fd_ = -1;
+        void* rings_ = nullptr;
+        size_t ringsSize_ = 0;
+        io_uring_sqe* sqes_ = nullptr;
+        size_t sqesSize_ = 0;
+        unsigned* sqHead_ = nullptr;
+        unsigned* sqTail_ = nullptr;
+        unsigned* sqArray_ = nullptr;
+        unsigned sqMask_ = 0;
+        unsigned sqEntries_ = 0;
+        unsigned* cqHead_ = nullptr;
+        unsigned* cqTail_ = nullptr;
+        io_uring_cqe* cqes_ = nullptr;
+        unsigned cqMask_ = 0;
+        unsigned cqEntries_ = 0;
+
+        std::mutex mutex_;  // 保护提交队列、inflight_和backlog_
+        io_detail::OpList inflight_;  // 已提交给内核的操作
+        size_t inflightSize_ = 0;
+        io_detail::OpList backlog_;  // 完成队列可能放不下而暂缓提交的操作
+        size_t cancelBacklog_ = 0;  // inflight_中暂缓提交取消请求的操作数量
+        size_t cancelsInflight_ = 0;  // 已提交、完成事件尚未取出的取消请求数量
+
+        // 内核不支持(或被seccomp禁止)时返回false
+        bool setup(unsigned entries) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            int fd = int(syscall(__NR_io_uring_setup, entries, &params));
+            if (fd < 0) {
+                return false;
+            }
+            // 需要5.4的单次映射和5.5的完成事件不丢失
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+                ::close(fd);
+                return false;
+            }
+            size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            ringsSize_ = std::max(sqSize, cqSize);
+            rings_ = mmap(nullptr, ringsSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (rings_ == MAP_FAILED) {
+                rings_ = nullptr;
+                ::close(fd);
+                return false;
+            }
+            sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) {
+                munmap(rings_, ringsSize_);
+                rings_ = nullptr;
+                ::close(fd);
+                return false;
+            }
+            char* base = static_cast<char*>(rings_);
+            fd_ = fd;
+            sqes_ = static_cast<io_uring_sqe*>(sqes);
+            sqHead_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+            sqTail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+            sqArray_ = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+            sqMask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+            sqEntries_ = params.sq_entries;
+            cqHead_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+            cqTail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+            cqMask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+            cqEntries_ = params.cq_entries;
+            return true;
+        }
+
+        void close() {
+            if (fd_ < 0) {
+                return ;
+            }
+            munmap(sqes_, sqesSize_);
+            munmap(rings_, ringsSize_);
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+        // 提交队列中的空位，调用者持有mutex_
+        unsigned sqSpace() const {
+            return sqEntries_ - (*sqTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire));
+        }
+
+        io_uring_sqe& nextSqe() {
+            unsigned tail = *sqTail_;
+            unsigned index = tail & sqMask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqArray_[index] = index;
+            return sqe;
+        }
+
+        void commitSqe() {
+            std::atomic_ref<unsigned>(*sqTail_).store(*sqTail_ + 1, std::memory_order_release);
+        }
+
+        // 放入读写操作，调用者持有mutex_；完成队列一半留给读写操作、一半留给取消请求，超出时暂缓
+        void push(io_detail::IoOp* op) {
+            if (inflightSize_ >= cqEntries_ / 2 || sqSpace() == 0) {
+                backlog_.push(op);
+                return ;
+            }
+            io_uring_sqe& sqe = nextSqe();
+            sqe.opcode = op->kind_ == io_detail::IoOp::Op_Read ? IORING_OP_READV : IORING_OP_WRITEV;
+            sqe.fd = op->fd_;
+            sqe.addr = reinterpret_cast<uint64_t>(&op->iov_);
+            sqe.len = 1;
+            sqe.off = op->offset_ < 0 ? uint64_t(-1) : uint64_t(op->offset_);
+            sqe.user_data = reinterpret_cast<uint64_t>(op);
+            commitSqe();
+            inflight_.push(op);
+            inflightSize_++;
+        }
+
+        // 请求取消已提交的操作，被取消的操作以-ECANCELED完成；取消请求自己的完成事件(user_data为0)只用于计数
+        // 提交队列或完成队列中留给取消请求的一半已满时标记在操作上，处理完成事件后由pushCancels重新提交
+        void pushCancel(io_detail::IoOp* op) {
+            if (sqSpace() == 0) {
+                enter();
+            }
+            if (sqSpace() == 0 || cancelsInflight_ >= cqEntries_ / 2) {
+                if (!op->cancelRequested_) {
+                    op->cancelRequested_ = true;
+                    cancelBacklog_++;
+                }
+                return ;
+            }
+            if (op->cancelRequested_) {
+                op->cancelRequested_ = false;
+                cancelBacklog_--;
+            }
+            io_uring_sqe& sqe = nextSqe();
+            sqe.opcode = IORING_OP_ASYNC_CANCEL;
+            sqe.fd = -1;
+            sqe.addr = reinterpret_cast<uint64_t>(op);
+            sqe.user_data = 0;
+            commitSqe();
+            cancelsInflight_++;
+        }
+
+        // 把提交队列中的操作交给内核，调用者持有mutex_；内核暂时不能接收(EAGAIN/EBUSY)时留在队列中，处理完成事件后再提交
+        void enter() {
+            for (;;) {
+                unsigned pending = *sqTail_ - std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+                if (pending == 0) {
+                    return ;
+                }
+                if (syscall(__NR_io_uring_enter, fd_, pending, 0, 0, nullptr, 0) < 0 && errno != EINTR) {
+                    return ;
+                }
+            }
+        }
+
+        // 重新提交暂缓的取消请求，调用者持有mutex_
+        void pushCancels() {
+            for (io_detail::IoOp* op = inflight_.head_; op != nullptr && cancelBacklog_ > 0; op = op->next_) {
+                if (op->cancelRequested_) {
+                    pushCancel(op);
+                    if (op->cancelRequested_) {
+                        return ;
+                    }
+                }
+            }
+        }
+
+        // 把暂缓的操作放入提交队列，调用者持有mutex_
+        void pushBacklog() {
+            while (!backlog_.empty() && inflightSize_ < cqEntries_ / 2 && sqSpace() > 0) {
+                io_detail::IoOp* op = backlog_.head_;
+                backlog_.remove(op);
+                push(op);
+            }
+        }
+    };
+
+    Ring ring_;
+#endif
+
+    ThreadPoolBase& pool_;
+    IoBackend backend_;
+    int epollFd_;
+    int wakeFd_;  // 唤醒轮询线程(析构时)
+    std::mutex fdMutex_;  // 保护fds_
+    std::unordered_map<int, FdEntry> fds_;
+    CompletionCounter outstanding_;  // 尚未完成的操作数量
+    std::atomic_bool stopping_;
+    std::thread poller_;
+
+    void watch(int fd) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeFd_, &one, sizeof(one));
+        (void)n;
+    }
+
+    void init(io_detail::IoOp* op, io_detail::IoOp::Kind kind, int fd, void* buf, size_t len, int64_t offset) {
+        op->kind_ = kind;
+        op->fd_ = fd;
+        op->iov_.iov_base = buf;
+        op->iov_.iov_len = len;
+        op->offset_ = offset;
+    }
+
+    template <typename Func>
+    io_detail::IoOp* makeOp(io_detail::IoOp::Kind kind, int fd, void* buf, size_t len, int64_t offset, Func&& func) {
+        using Op = io_detail::CallbackOp<std::decay_t<Func>>;
+        void* p = BlockPool::allocate(sizeof(Op));
+        Op* op = new (p) Op(std::forward<Func>(func));
+        init(op, kind, fd, buf, len, offset);
+        return op;
+    }
+
+    void start(io_detail::IoOp* op) {
+        outstanding_.add();
+        bool io = op->kind_ == io_detail::IoOp::Op_Read || op->kind_ == io_detail::IoOp::Op_Write;
+#ifdef THREADPOOL_HAS_IO_URING
+        if (io && backend_ == IoBackend::Backend_Uring) {
+            {
+                std::lock_guard<std::mutex> lock(ring_.mutex_);
+                if (!stopping_) {
+                    ring_.push(op);
+                    ring_.enter();
+                    return ;
+                }
+            }
+            finish(op, -ECANCELED);
+            return ;
+        }
+#endif
+        (void)io;
+        waitReady(op);
+    }
+
+    // 登记为fd的等待者  普通文件不支持epoll(EPERM)，视为总是就绪
+    void waitReady(io_detail::IoOp* op) {
+        int err;
+        {
+            std::lock_guard<std::mutex> lock(fdMutex_);
+            if (stopping_) {
+                err = ECANCELED;
+            } else {
+                FdEntry& entry = fds_[op->fd_];
+                io_detail::OpList& list = op->reading() ? entry.readers_ : entry.writers_;
+                list.push(op);
+                err = arm(op->fd_, entry);
+                if (err == 0) {
+                    return ;
+                }
+                list.remove(op);
+                if (!entry.registered_ && entry.readers_.empty() && entry.writers_.empty()) {
+                    fds_.erase(op->fd_);
+                }
+            }
+        }
+        if (err == EPERM) {
+            ready(op, EPOLLIN | EPOLLOUT);
+        } else {
+            finish(op, -err);
+        }
+    }
+
+    // 按等待者重新登记fd，调用者持有fdMutex_；成功返回0，否则返回errno
+    int arm(int fd, FdEntry& entry) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLONESHOT;
+        if (!entry.readers_.empty()) {
+            ev.events |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (!entry.writers_.empty()) {
+            ev.events |= EPOLLOUT;
+        }
+        ev.data.fd = fd;
+        if (entry.registered_) {
+            if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) == 0) {
+                return 0;
+            }
+            // fd关闭后内核已经删除了登记，现在是复用的fd号
+            if (errno != ENOENT) {
+                return errno;
+            }
+            entry.registered_ = false;
+        }
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) == 0) {
+            entry.registered_ = true;
+            return 0;
+        }
+        return errno;
+    }
+
+    // 轮询线程：就绪事件交给等待者，io_uring的完成事件交给提交者；析构时取消所有操作，等内核中的操作结束后退出
+    void pollLoop() {
+        epoll_event events[64];
+        bool cancelled = false;
+        for (;;) {
+            if (stopping_) {
+                if (!cancelled) {
+                    cancelAll();
+                    cancelled = true;
+                }
+                if (idle()) {
+                    break;
+                }
+            }
+            int n = epoll_wait(epollFd_, events, 64, -1);
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd_) {
+                    uint64_t value;
+                    ssize_t r = ::read(wakeFd_, &value, sizeof(value));
+                    (void)r;
+                }
+#ifdef THREADPOOL_HAS_IO_URING
+                else if (fd == ring_.fd_) {
+                    reap();
+                }
+#endif
+                else {
+                    dispatch(fd, events[i].events);
+                }
+            }
+        }
+    }
+
+    // 把fd的就绪事件交给对应的等待者，还有等待者时重新登记
+    void dispatch(int fd, uint32_t events) {
+        io_detail::OpList fired;
+        io_detail::OpList failed;
+        int err = 0;
+        {
+            std::lock_guard<std::mutex> lock(fdMutex_);
+            auto it = fds_.find(fd);
+            if (it == fds_.end()) {
+                return ;
+            }
+            FdEntry& entry = it->second;
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+                fired.splice(entry.readers_);
+            }
+            if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+                fired.splice(entry.writers_);
+            }
+            if (!entry.readers_.empty() || !entry.writers_.empty()) {
+                err = arm(fd, entry);
+                if (err != 0) {
+                    failed.splice(entry.readers_);
+                    failed.splice(entry.writers_);
+                }
+            }
+        }
+        for (io_detail::IoOp* op = fired.head_; op != nullptr; ) {
+            io_detail::IoOp* next = op->next_;
+            ready(op, events);
+            op = next;
+        }
+        finishAll(failed, -err);
+    }
+
+    // fd已就绪  等待就绪的操作直接完成，读写操作交给工作线程执行
+    void ready(io_detail::IoOp* op, uint32_t events) {
+        if (op->kind_ == io_detail::IoOp::Op_Readable || op->kind_ == io_detail::IoOp::Op_Writable) {
+            finish(op, ssize_t(events));
+            return ;
+        }
+        ThreadPoolBase::Job job = [this, op]() { perform(op); };
+        if (!pool_.tryPost(job)) {
+            job();
+        }
+    }
+
+    // 在工作线程中执行读写  就绪事件被其他读者用掉(非阻塞fd返回EAGAIN)时重新等待
+    void perform(io_detail::IoOp* op) {
+        ssize_t n;
+        do {
+            if (op->kind_ == io_detail::IoOp::Op_Read) {
+                n = op->offset_ < 0 ? ::readv(op->fd_, &op->iov_, 1) : ::preadv(op->fd_, &op->iov_, 1, op->offset_);
+            } else {
+                n = op->offset_ < 0 ? ::writev(op->fd_, &op->iov_, 1) : ::pwritev(op->fd_, &op->iov_, 1, op->offset_);
+            }
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            waitReady(op);
+            return ;
+        }
+        ssize_t result = n < 0 ? -errno : n;
+        // 计数减为0后反应器可能已被析构，之后只访问op
+        outstanding_.done();
+        op->complete(result);
+    }
+
+    // 把完成的操作交给线程池
+    void finish(io_detail::IoOp* op, ssize_t result) {
+        op->result_ = result;
+        ThreadPoolBase::Job job = [op]() { op->complete(op->result_); };
+        if (!pool_.tryPost(job)) {
+            job();
+        }
+        outstanding_.done();
+    }
+
+    void finishAll(io_detail::OpList& list, ssize_t result) {
+        for (io_detail::IoOp* op = list.head_; op != nullptr; ) {
+            io_detail::IoOp* next = op->next_;
+            finish(op, result);
+            op = next;
+        }
+    }
+
+    // 析构时取消所有操作，之后开始的操作直接以-ECANCELED完成
+    void cancelAll() {
+        io_detail::OpList cancelled;
+        {
+            std::lock_guard<std::mutex> lock(fdMutex_);
+            for (auto& [fd, entry] : fds_) {
+                cancelled.splice(entry.readers_);
+                cancelled.splice(entry.writers_);
+            }
+            fds_.clear();
+        }
+#ifdef THREADPOOL_HAS_IO_URING
+        if (backend_ == IoBackend::Backend_Uring) {
+            std::lock_guard<std::mutex> lock(ring_.mutex_);
+            for (io_detail::IoOp* op = ring_.inflight_.head_; op != nullptr; op = op->next_) {
+                ring_.pushCancel(op);
+            }
+            cancelled.splice(ring_.backlog_);
+            ring_.enter();
+        }
+#endif
+        finishAll(cancelled, -ECANCELED);
+    }
+
+    // 内核中没有未结束的操作
+    bool idle() {
+#ifdef THREADPOOL_HAS_IO_URING
+        if (backend_ == IoBackend::Backend_Uring) {
+            std::lock_guard<std::mutex> lock(ring_.mutex_);
+            return ring_.inflightSize_ == 0 && ring_.backlog_.empty();
+        }
+#endif
+        return true;
+    }
+
+#ifdef THREADPOOL_HAS_IO_URING
+    // 取出io_uring的完成事件，完成对应的操作并提交暂缓的取消请求和操作
+    void reap() {
+        io_detail::OpList completed;
+        {
+            std::lock_guard<std::mutex> lock(ring_.mutex_);
+            unsigned head = *ring_.cqHead_;
+            unsigned tail = std::atomic_ref<unsigned>(*ring_.cqTail_).load(std::memory_order_acquire);
+            for (; head != tail; head++) {
+                const io_uring_cqe& cqe = ring_.cqes_[head & ring_.cqMask_];
+                auto* op = reinterpret_cast<io_detail::IoOp*>(cqe.user_data);
+                if (op == nullptr) {
+                    ring_.cancelsInflight_--;
+                    continue;
+                }
+                op->result_ = cqe.res;
+                ring_.inflight_.remove(op);
+                ring_.inflightSize_--;
+                if (op->cancelRequested_) {
+                    op->cancelRequested_ = false;
+                    ring_.cancelBacklog_--;
+                }
+                completed.push(op);
+            }
+            std::atomic_ref<unsigned>(*ring_.cqHead_).store(head, std::memory_order_release);
+            ring_.pushCancels();
+            ring_.pushBacklog();
+            ring_.enter();
+        }
+        for (io_detail::IoOp* op = completed.head_; op != nullptr; ) {
+            io_detail::IoOp* next = op->next_;
+            finish(op, op->result_);
+            op = next;
+        }
+    }
+#endif
+};
+
+#endif  // __linux__
+
+#endif
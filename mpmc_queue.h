@@ -0,0 +1,97 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+// 有界无锁多生产者多消费者环形队列
+// 每个槽位带一个序号，生产者和消费者通过CAS抢占位置后只操作自己的槽位，全程不加锁
+// 队列满或空时立即返回false，由调用者决定是否等待
+template <typename T>
+class MPMCQueue {
+public:
+    MPMCQueue(size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1),
+          cells_(new Cell[capacity_]),
+          head_(0),
+          tail_(0) {
+        for (size_t i = 0; i < capacity_; i++) {
+            cells_[i].sequence_.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MPMCQueue() = default;
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // 压入元素，队列满时返回false且item保持不变
+    bool push(T& item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos % capacity_];
+            size_t seq = cell.sequence_.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data_ = std::move(item);
+                    cell.sequence_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos) {
+                // 槽位中的元素还没有被取走，队列已满
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 取出元素，队列空时返回false
+    bool pop(T& item) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos % capacity_];
+            size_t seq = cell.sequence_.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data_);
+                    cell.data_ = T();
+                    cell.sequence_.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos + 1) {
+                // 槽位还没有被写入，队列为空
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 队列容量
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    // 近似的元素数量
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    // 槽位独占缓存行，相邻槽位的生产者和消费者不会伪共享
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence_;
+        T data_;
+    };
+
+    const size_t capacity_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> head_;  // 消费位置
+    alignas(64) std::atomic<size_t> tail_;  // 生产位置
+};
+
+#endif
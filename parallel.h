@@ -0,0 +1,218 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include <iterator>
+
+#include "threadpool_base.h"
+
+// 基于线程池的数据并行算法 parallel_for / parallel_reduce / parallel_scan
+// 区间按粒度递归二分，右半部分作为任务交给线程池，左半部分由当前线程继续切分，
+// 空闲线程窃取到的子区间还会继续切分，迭代开销不均匀时负载也能自动均衡；
+// 调用线程不会阻塞等待，而是一起执行线程池中的任务，直到所有子区间完成
+// grain为0时自动选择粒度(约为每个线程8个子区间)
+
+// 扫描方式
+enum class ScanType {
+    Scan_Inclusive,  // 第i个输出包含第i个输入
+    Scan_Exclusive,  // 第i个输出不包含第i个输入，第一个输出为init
+};
+
+
+namespace parallel_detail {
+
+// 一次并行调用的共享状态，保存在调用线程的栈上，调用线程等待所有子区间完成后才返回
+struct Context {
+    CompletionCounter pending;  // 尚未完成的子区间数量
+    std::atomic_bool failed{false};  // 有子区间抛出异常后，其余子区间不再执行
+    std::exception_ptr error;
+    std::mutex mutex;  // 保护error
+
+    void setError(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = e;
+        }
+        failed = true;
+    }
+};
+
+// 每个块的结果独占一个缓存行，各线程并发写入相邻的块时互不干扰(T为bool时std::vector<T>按位存储，并发写入是数据竞争)
+template <typename T>
+struct alignas(64) Padded {
+    T value_;
+};
+
+inline size_t autoGrain(ThreadPoolBase& pool, size_t n) {
+    size_t pieces = std::max<size_t>(pool.threadSize(), 1) * 8;
+    return std::max<size_t>(n / pieces, 1);
+}
+
+template <typename Body>
+void runRange(ThreadPoolBase& pool, Context& ctx, const Body& body, size_t grain, size_t first, size_t last);
+
+// 将[first, last)交给线程池，队列已满时直接在当前线程执行
+template <typename Body>
+void spawnRange(ThreadPoolBase& pool, Context& ctx, const Body& body, size_t grain, size_t first, size_t last) {
+    ctx.pending.add();
+    ThreadPoolBase::Job job = [&pool, &ctx, &body, grain, first, last]() {
+        runRange(pool, ctx, body, grain, first, last);
+        ctx.pending.done();
+    };
+    if (!pool.tryPost(job)) {
+        job();
+    }
+}
+
+template <typename Body>
+void runRange(ThreadPoolBase& pool, Context& ctx, const Body& body, size_t grain, size_t first, size_t last) {
+    while (last - first > grain) {
+        size_t mid = first + (last - first) / 2;
+        spawnRange(pool, ctx, body, grain, mid, last);
+        last = mid;
+    }
+    if (ctx.failed.load(std::memory_order_relaxed)) {
+        return ;
+    }
+    try {
+        body(first, last);
+    } catch (...) {
+        ctx.setError(std::current_exception());
+    }
+}
+
+// 调用线程执行线程池中的任务直到所有子区间完成
+inline void wait(ThreadPoolBase& pool, Context& ctx) {
+    pool.helpUntil(ctx.pending);
+    if (ctx.error) {
+        std::rethrow_exception(ctx.error);
+    }
+}
+
+// 对[first, last)按粒度递归切分执行body(b, e)
+template <typename Body>
+void forRange(ThreadPoolBase& pool, size_t first, size_t last, const Body& body, size_t grain) {
+    if (first >= last) {
+        return ;
+    }
+    if (grain == 0) {
+        grain = autoGrain(pool, last - first);
+    }
+    Context ctx;
+    runRange(pool, ctx, body, grain, first, last);
+    wait(pool, ctx);
+}
+
+}  // namespace parallel_detail
+
+
+// 并行执行func  func可以是func(i)对每个下标调用，也可以是func(b, e)处理一个子区间
+template <typename Func>
+void parallel_for(ThreadPoolBase& pool, size_t first, size_t last, Func&& func, size_t grain = 0) {
+    if constexpr (std::is_invocable_v<Func&, size_t, size_t>) {
+        parallel_detail::forRange(pool, first, last, func, grain);
+    } else {
+        auto body = [&func](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                func(i);
+            }
+        };
+        parallel_detail::forRange(pool, first, last, body, grain);
+    }
+}
+
+
+// 并行归约  func(b, e, init)返回子区间[b, e)以init为初值的归约结果，combine(a, b)合并两个结果
+// 子区间的结果按区间顺序合并，combine只需满足结合律，不要求交换律
+template <typename T, typename Func, typename Combine>
+T parallel_reduce(ThreadPoolBase& pool, size_t first, size_t last, T identity,
+                  Func&& func, Combine&& combine, size_t grain = 0) {
+    if (first >= last) {
+        return identity;
+    }
+    size_t n = last - first;
+    if (grain == 0) {
+        grain = parallel_detail::autoGrain(pool, n);
+    }
+
+    // 按粒度切成固定的块，每块的结果写入对应位置，最后按顺序合并
+    size_t chunks = (n + grain - 1) / grain;
+    std::vector<parallel_detail::Padded<T>> partial(chunks, parallel_detail::Padded<T>{identity});
+    parallel_detail::forRange(pool, 0, chunks, [&](size_t b, size_t e) {
+        for (size_t c = b; c < e; c++) {
+            size_t lo = first + c * grain;
+            size_t hi = std::min(lo + grain, last);
+            partial[c].value_ = func(lo, hi, identity);
+        }
+    }, 1);
+
+    T result = identity;
+    for (auto& value : partial) {
+        result = combine(std::move(result), std::move(value.value_));
+    }
+    return result;
+}
+
+
+// 并行前缀扫描  将[first, last)的前缀结果写入d_first，op需满足结合律
+// 第一遍并行求出每块的归约值，顺序求出各块的起始值，第二遍并行写出每块的扫描结果
+// 输入和输出都按下标并行访问，需要随机访问迭代器
+template <std::random_access_iterator RandomIt, std::random_access_iterator OutRandomIt, typename T, typename Op>
+OutRandomIt parallel_scan(ThreadPoolBase& pool, RandomIt first, RandomIt last, OutRandomIt d_first,
+                          T init, Op&& op, ScanType type = ScanType::Scan_Inclusive, size_t grain = 0) {
+    size_t n = std::distance(first, last);
+    if (n == 0) {
+        return d_first;
+    }
+    if (grain == 0) {
+        grain = parallel_detail::autoGrain(pool, n);
+    }
+
+    size_t chunks = (n + grain - 1) / grain;
+    std::vector<parallel_detail::Padded<T>> sums(chunks);
+    parallel_detail::forRange(pool, 0, chunks, [&](size_t b, size_t e) {
+        for (size_t c = b; c < e; c++) {
+            size_t lo = c * grain;
+            size_t hi = std::min(lo + grain, n);
+            T sum = first[lo];
+            for (size_t i = lo + 1; i < hi; i++) {
+                sum = op(std::move(sum), first[i]);
+            }
+            sums[c].value_ = std::move(sum);
+        }
+    }, 1);
+
+    // 各块的起始值(不含本块)
+    std::vector<T> offsets(chunks);
+    T running = init;
+    for (size_t c = 0; c < chunks; c++) {
+        offsets[c] = running;
+        running = op(std::move(running), sums[c].value_);
+    }
+
+    parallel_detail::forRange(pool, 0, chunks, [&](size_t b, size_t e) {
+        for (size_t c = b; c < e; c++) {
+            size_t lo = c * grain;
+            size_t hi = std::min(lo + grain, n);
+            T acc = offsets[c];
+            for (size_t i = lo; i < hi; i++) {
+                if (type == ScanType::Scan_Inclusive) {
+                    acc = op(std::move(acc), first[i]);
+                    d_first[i] = acc;
+                } else {
+                    T next = op(acc, first[i]);
+                    d_first[i] = std::move(acc);
+                    acc = std::move(next);
+                }
+            }
+        }
+    }, 1);
+
+    return d_first + n;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+// 内存块池  按16字节分级缓存释放的内存块，下次分配同样大小时直接复用
+// 每个线程有自己的缓存，分配和释放不加锁；内存块常常在另一个线程释放(如future的共享状态)，
+// 所以线程缓存超过上限时整批交给全局缓存，线程缓存为空时再从全局缓存整批取回
+class BlockPool {
+public:
+    static constexpr size_t ALIGN = 16;
+    static constexpr size_t MAX_BLOCK_SIZE = 512;
+    static constexpr size_t BATCH_SIZE = 128;  // 线程缓存与全局缓存之间一次转移的块数
+
+    static void* allocate(size_t size) {
+        if (size == 0 || size > MAX_BLOCK_SIZE) {
+            return ::operator new(size);
+        }
+        size_t index = (size - 1) / ALIGN;
+        BlockPool* pool = local();
+        if (pool != nullptr) {
+            FreeList& list = pool->lists_[index];
+            if (list.head_ == nullptr) {
+                list.head_ = central(index).take(list.count_);
+            }
+            if (list.head_ != nullptr) {
+                Block* block = list.head_;
+                list.head_ = block->next_;
+                list.count_--;
+                return block;
+            }
+        }
+        return ::operator new((index + 1) * ALIGN);
+    }
+
+    static void deallocate(void* p, size_t size) {
+        if (p == nullptr) {
+            return ;
+        }
+        if (size == 0 || size > MAX_BLOCK_SIZE) {
+            ::operator delete(p);
+            return ;
+        }
+        size_t index = (size - 1) / ALIGN;
+        Block* block = static_cast<Block*>(p);
+        BlockPool* pool = local();
+        if (pool == nullptr) {
+            block->next_ = nullptr;
+            central(index).give(block, 1);
+            return ;
+        }
+        FreeList& list = pool->lists_[index];
+        block->next_ = list.head_;
+        list.head_ = block;
+        list.count_++;
+        if (list.count_ >= 2 * BATCH_SIZE) {
+            list.head_ = central(index).give(list.head_, BATCH_SIZE);
+            list.count_ -= BATCH_SIZE;
+        }
+    }
+
+    ~BlockPool() {
+        alive() = false;
+        for (size_t i = 0; i < MAX_BLOCK_SIZE / ALIGN; i++) {
+            if (lists_[i].head_ != nullptr) {
+                central(i).give(lists_[i].head_, lists_[i].count_);
+            }
+        }
+    }
+
+private:
+    struct Block {
+        Block* next_;
+        Block* nextBatch_;  // 全局缓存中串联各批次
+    };
+
+    struct FreeList {
+        Block* head_ = nullptr;
+        size_t count_ = 0;
+    };
+
+    // 全局缓存  以批为单位存取，加锁的频率为每BATCH_SIZE次分配一次
+    class Central {
+    public:
+        // 交出链表头部的count个块，返回剩余部分
+        Block* give(Block* head, size_t count) {
+            Block* tail = head;
+            for (size_t i = 1; i < count && tail->next_ != nullptr; i++) {
+                tail = tail->next_;
+            }
+            Block* rest = tail->next_;
+            tail->next_ = nullptr;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            head->nextBatch_ = batches_;
+            batches_ = head;
+            return rest;
+        }
+
+        // 取回一批块，count返回块数
+        Block* take(size_t& count) {
+            Block* batch = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batch = batches_;
+                if (batch != nullptr) {
+                    batches_ = batch->nextBatch_;
+                }
+            }
+            count = 0;
+            for (Block* b = batch; b != nullptr; b = b->next_) {
+                count++;
+            }
+            return batch;
+        }
+
+    private:
+        std::mutex mutex_;
+        Block* batches_ = nullptr;
+    };
+
+    FreeList lists_[MAX_BLOCK_SIZE / ALIGN];
+
+    static Central& central(size_t index) {
+        static Central centrals[MAX_BLOCK_SIZE / ALIGN];
+        return centrals[index];
+    }
+
+    // 线程退出时缓存已析构，之后释放的块直接交给全局缓存
+    static bool& alive() {
+        static thread_local bool alive = true;
+        return alive;
+    }
+
+    static BlockPool* local() {
+        if (!alive()) {
+            return nullptr;
+        }
+        static thread_local BlockPool pool;
+        return &pool;
+    }
+};
+
+
+// 从BlockPool分配内存的分配器，用于std::promise等需要分配共享状态的场合
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(BlockPool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        BlockPool::deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+#endif
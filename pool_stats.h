@@ -0,0 +1,144 @@
+#ifndef POOL_STATS_H
+#define POOL_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// 耗时直方图  按2的幂分桶，第i个桶统计[2^i, 2^(i+1))纳秒，0纳秒计入第0个桶
+struct LatencyHistogram {
+    static constexpr size_t BUCKETS = 40;  // 最后一个桶包含2^39纳秒(约9分钟)以上的所有值
+
+    uint64_t counts_[BUCKETS] = {};
+
+    static size_t bucket(uint64_t ns) {
+        return ns == 0 ? 0 : std::min<size_t>(std::bit_width(ns) - 1, BUCKETS - 1);
+    }
+
+    uint64_t count() const {
+        uint64_t sum = 0;
+        for (uint64_t c : counts_) {
+            sum += c;
+        }
+        return sum;
+    }
+
+    // 第p(0~1)分位数的近似值，返回所在桶的上界(纳秒)，没有数据时返回0
+    uint64_t percentile(double p) const {
+        uint64_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, uint64_t(p * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                return uint64_t(1) << (i + 1);
+            }
+        }
+        return uint64_t(1) << BUCKETS;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; i++) {
+            counts_[i] += other.counts_[i];
+        }
+    }
+};
+
+
+// 一个线程的运行统计
+struct WorkerStats {
+    uint64_t tasksExecuted_ = 0;  // 执行的任务数量
+    uint64_t busyNs_ = 0;  // 执行任务的时间
+    uint64_t idleNs_ = 0;  // 获取和等待任务的时间
+    LatencyHistogram queueWait_;  // 任务从提交到开始执行的等待时间
+    LatencyHistogram execTime_;  // 任务的执行时间
+
+    void merge(const WorkerStats& other) {
+        tasksExecuted_ += other.tasksExecuted_;
+        busyNs_ += other.busyNs_;
+        idleNs_ += other.idleNs_;
+        queueWait_.merge(other.queueWait_);
+        execTime_.merge(other.execTime_);
+    }
+};
+
+
+// 线程池运行统计的快照  各项计数在读取过程中仍在变化，彼此之间不保证严格一致
+struct PoolStats {
+    std::vector<WorkerStats> workers_;  // 每个工作槽位一项，已退出线程的计数保留在原槽位
+    WorkerStats external_;  // 线程池外部的线程通过runPendingTask帮忙执行的任务
+    WorkerStats total_;  // 以上所有项的合计
+
+    size_t threadSize_ = 0;  // 当前线程数量
+    size_t idleThreadSize_ = 0;  // 空闲线程数量
+    size_t blockedThreadSize_ = 0;  // 处于阻塞区间的线程数量
+    size_t taskSize_ = 0;  // 等待执行的任务数量
+    size_t queueHighWater_ = 0;  // 等待执行的任务数量的历史最大值
+    uint64_t threadsSpawned_ = 0;  // Cached模式下扩充创建的线程数量
+    uint64_t threadsRetired_ = 0;  // Cached模式下空闲超时退出的线程数量
+    uint64_t threadsCompensated_ = 0;  // 为阻塞区间补充创建的线程数量
+    uint64_t submitTimeouts_ = 0;  // 等待任务队列空余超时而提交失败的任务数量
+    uint64_t submitRejected_ = 0;  // 任务队列已满被立即拒绝的任务数量(Overload_Fail)
+    uint64_t callerRuns_ = 0;  // 任务队列已满在提交者线程中执行的任务数量(Overload_CallerRuns)
+    uint64_t tasksDropped_ = 0;  // 为新任务腾出位置而丢弃的任务数量(Overload_DropOldest)
+};
+
+
+// 一个线程的运行计数  独占缓存行，执行任务时只更新本线程的计数，不与其他线程争抢
+// 只有所属的线程写入，读后写即可，不需要带锁前缀的原子加；线程池外部的线程共用一组计数(shared)，用原子加
+struct alignas(64) WorkerCounters {
+    explicit WorkerCounters(bool shared = false)
+        : shared_(shared) {
+    }
+
+    std::atomic<uint64_t> tasksExecuted_{0};
+    std::atomic<uint64_t> busyNs_{0};
+    std::atomic<uint64_t> idleNs_{0};
+    std::atomic<uint64_t> queueWait_[LatencyHistogram::BUCKETS] = {};
+    std::atomic<uint64_t> execTime_[LatencyHistogram::BUCKETS] = {};
+
+    // 记录一个任务的等待时间和执行时间
+    void recordTask(uint64_t waitNs, uint64_t execNs) {
+        add(tasksExecuted_, 1);
+        add(queueWait_[LatencyHistogram::bucket(waitNs)], 1);
+        add(execTime_[LatencyHistogram::bucket(execNs)], 1);
+    }
+
+    void addBusy(uint64_t ns) {
+        add(busyNs_, ns);
+    }
+
+    void addIdle(uint64_t ns) {
+        add(idleNs_, ns);
+    }
+
+    WorkerStats snapshot() const {
+        WorkerStats stats;
+        stats.tasksExecuted_ = tasksExecuted_.load(std::memory_order_relaxed);
+        stats.busyNs_ = busyNs_.load(std::memory_order_relaxed);
+        stats.idleNs_ = idleNs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+            stats.queueWait_.counts_[i] = queueWait_[i].load(std::memory_order_relaxed);
+            stats.execTime_.counts_[i] = execTime_[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+private:
+    bool shared_;  // 是否由多个线程同时写入
+
+    void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        if (shared_) {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        } else {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef PRIORITY_TASK_QUEUE_H
+#define PRIORITY_TASK_QUEUE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ring_deque.h"
+
+// 多级优先队列  每个优先级(0最高)一个FIFO环形队列和一个按截止时间排序的最小堆
+// 同一优先级内有截止时间的任务按截止时间先后执行(EDF)，然后才是没有截止时间的任务(FIFO)
+// 老化：较低优先级中最早的任务已等待超过agingNs×级差时，先于较高优先级执行，低优先级不会饿死
+// 出队在选择优先级时最多检查LEVELS个队首，之后FIFO为O(1)，堆为O(log n)
+// T需要有enqueueTime_成员(入队时刻，纳秒)
+template <typename T, size_t LEVELS>
+class PriorityTaskQueue {
+public:
+    static constexpr uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+    explicit PriorityTaskQueue(uint64_t agingNs) : agingNs_(agingNs), seq_(0), size_(0) {}
+    ~PriorityTaskQueue() = default;
+
+    PriorityTaskQueue(const PriorityTaskQueue&) = delete;
+    PriorityTaskQueue& operator=(const PriorityTaskQueue&) = delete;
+
+    void setAgingTime(uint64_t agingNs) {
+        agingNs_ = agingNs;
+    }
+
+    // 放入指定优先级，deadline为截止时刻(纳秒)
+    void push(T item, size_t level, uint64_t deadline = NO_DEADLINE) {
+        Level& l = levels_[level];
+        if (deadline == NO_DEADLINE) {
+            l.fifo_.push_back(std::move(item));
+        } else {
+            l.heap_.push_back(Entry{ deadline, seq_++, std::move(item) });
+            std::push_heap(l.heap_.begin(), l.heap_.end(), Later());
+        }
+        size_++;
+    }
+
+    // 按优先级、老化和截止时间取出下一个任务
+    bool pop(T& item) {
+        size_t level = select();
+        if (level == LEVELS) {
+            return false;
+        }
+        Level& l = levels_[level];
+        if (!l.heap_.empty()) {
+            std::pop_heap(l.heap_.begin(), l.heap_.end(), Later());
+            item = std::move(l.heap_.back().item_);
+            l.heap_.pop_back();
+        } else {
+            item = std::move(l.fifo_.front());
+            l.fifo_.pop_front();
+        }
+        size_--;
+        return true;
+    }
+
+    // 只从指定优先级的FIFO部分取出任务
+    bool popFifo(size_t level, T& item) {
+        Level& l = levels_[level];
+        if (l.fifo_.empty()) {
+            return false;
+        }
+        item = std::move(l.fifo_.front());
+        l.fifo_.pop_front();
+        size_--;
+        return true;
+    }
+
+    // 从最低的优先级开始，取出evictable(item)为true的任务中最早入队的一个  队列已满需要丢弃任务时使用
+    // FIFO部分按顺序查找第一个可以丢弃的任务，前面不能丢弃的任务依次后移，保持原来的顺序；
+    // 堆中按入队时刻查找，取出后重建堆
+    template <typename Pred>
+    bool popOldest(T& item, Pred evictable) {
+        for (size_t level = LEVELS; level > 0; level--) {
+            Level& l = levels_[level - 1];
+            size_t fifoAt = 0;
+            while (fifoAt < l.fifo_.size() && !evictable(l.fifo_[fifoAt])) {
+                fifoAt++;
+            }
+            size_t heapAt = l.heap_.size();
+            for (size_t i = 0; i < l.heap_.size(); i++) {
+                if (evictable(l.heap_[i].item_)
+                    && (heapAt == l.heap_.size() || l.heap_[i].item_.enqueueTime_ < l.heap_[heapAt].item_.enqueueTime_)) {
+                    heapAt = i;
+                }
+            }
+            bool inFifo = fifoAt < l.fifo_.size();
+            bool inHeap = heapAt < l.heap_.size();
+            if (!inFifo && !inHeap) {
+                continue;
+            }
+
+            if (inFifo && (!inHeap || l.fifo_[fifoAt].enqueueTime_ <= l.heap_[heapAt].item_.enqueueTime_)) {
+                item = std::move(l.fifo_[fifoAt]);
+                for (size_t i = fifoAt; i > 0; i--) {
+                    l.fifo_[i] = std::move(l.fifo_[i - 1]);
+                }
+                l.fifo_.pop_front();
+            } else {
+                item = std::move(l.heap_[heapAt].item_);
+                l.heap_[heapAt] = std::move(l.heap_.back());
+                l.heap_.pop_back();
+                std::make_heap(l.heap_.begin(), l.heap_.end(), Later());
+            }
+            size_--;
+            return true;
+        }
+        return false;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // 指定优先级中的任务数量
+    size_t size(size_t level) const {
+        return levels_[level].fifo_.size() + levels_[level].heap_.size();
+    }
+
+    // 指定优先级中带截止时间的任务数量
+    size_t deadlineSize(size_t level) const {
+        return levels_[level].heap_.size();
+    }
+
+    // 指定优先级中最早入队的任务的入队时刻，为空时返回NO_DEADLINE
+    // 只比较FIFO队首和堆顶，堆中更早入队的任务由截止时间保证及时执行
+    uint64_t oldest(size_t level) const {
+        const Level& l = levels_[level];
+        uint64_t t = NO_DEADLINE;
+        if (!l.fifo_.empty()) {
+            t = l.fifo_.front().enqueueTime_;
+        }
+        if (!l.heap_.empty()) {
+            t = std::min(t, l.heap_.front().item_.enqueueTime_);
+        }
+        return t;
+    }
+
+private:
+    struct Entry {
+        uint64_t deadline_;
+        uint64_t seq_;  // 截止时间相同时按入队顺序
+        T item_;
+    };
+
+    // 堆顶为截止时间最早的任务
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.deadline_ != b.deadline_ ? a.deadline_ > b.deadline_ : a.seq_ > b.seq_;
+        }
+    };
+
+    struct Level {
+        RingDeque<T> fifo_;
+        std::vector<Entry> heap_;
+    };
+
+    Level levels_[LEVELS];
+    uint64_t agingNs_;
+    uint64_t seq_;
+    size_t size_;
+
+    // 选择出队的优先级  默认为最高的非空优先级，较低优先级中超出老化时间最多的任务优先
+    size_t select() const {
+        size_t best = 0;
+        while (best < LEVELS && size(best) == 0) {
+            best++;
+        }
+        if (best == LEVELS || size_ == size(best)) {
+            return best;
+        }
+
+        uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        size_t chosen = best;
+        uint64_t overdue = 0;
+        for (size_t level = best + 1; level < LEVELS; level++) {
+            uint64_t t = oldest(level);
+            if (t == NO_DEADLINE || now < t) {
+                continue;
+            }
+            uint64_t age = now - t;
+            uint64_t limit = agingNs_ * (level - best);
+            if (age >= limit && age - limit >= overdue) {
+                chosen = level;
+                overdue = age - limit;
+            }
+        }
+        return chosen;
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef RING_DEQUE_H
+#define RING_DEQUE_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// 可增长的环形双端队列  容量按2倍增长且不收缩
+// 与std::deque不同，队列稳定后入队出队不再分配和释放内存
+template <typename T>
+class RingDeque {
+public:
+    RingDeque() : buf_(nullptr), capacity_(0), head_(0), size_(0) {}
+    ~RingDeque() = default;
+
+    RingDeque(const RingDeque&) = delete;
+    RingDeque& operator=(const RingDeque&) = delete;
+
+    void push_back(T item) {
+        if (size_ == capacity_) {
+            grow();
+        }
+        buf_[(head_ + size_) & (capacity_ - 1)] = std::move(item);
+        size_++;
+    }
+
+    void push_front(T item) {
+        if (size_ == capacity_) {
+            grow();
+        }
+        head_ = (head_ + capacity_ - 1) & (capacity_ - 1);
+        buf_[head_] = std::move(item);
+        size_++;
+    }
+
+    T& front() {
+        return buf_[head_];
+    }
+
+    const T& front() const {
+        return buf_[head_];
+    }
+
+    T& back() {
+        return buf_[(head_ + size_ - 1) & (capacity_ - 1)];
+    }
+
+    // 弹出时将槽位重置为空，及时释放元素持有的资源
+    void pop_front() {
+        buf_[head_] = T();
+        head_ = (head_ + 1) & (capacity_ - 1);
+        size_--;
+    }
+
+    void pop_back() {
+        back() = T();
+        size_--;
+    }
+
+    // 第i个元素(从队首开始)
+    T& operator[](size_t i) {
+        return buf_[(head_ + i) & (capacity_ - 1)];
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+private:
+    std::unique_ptr<T[]> buf_;
+    size_t capacity_;  // 始终为2的幂
+    size_t head_;
+    size_t size_;
+
+    void grow() {
+        size_t capacity = capacity_ == 0 ? 16 : capacity_ * 2;
+        std::unique_ptr<T[]> buf(new T[capacity]);
+        for (size_t i = 0; i < size_; i++) {
+            buf[i] = std::move((*this)[i]);
+        }
+        buf_ = std::move(buf);
+        capacity_ = capacity;
+        head_ = 0;
+    }
+};
+
+#endif
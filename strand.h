@@ -0,0 +1,315 @@
+#ifndef STRAND_H
+#define STRAND_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "threadpool_base.h"
+#include "ring_deque.h"
+#include "pool_allocator.h"
+
+// 串行执行器(strand)  提交到同一个strand的任务按提交顺序逐个执行，可以在任意空闲的工作线程上执行，
+// 同一时刻最多一个，不需要为每个连接/账户加锁，也不会因锁竞争让工作线程阻塞
+// 任务从空变为非空时向线程池提交一个作业，作业依次执行strand中的任务，连续执行DRAIN_BATCH个后重新提交自己，
+// 避免一个繁忙的strand长时间占住工作线程
+// 与直接提交给线程池的作业相同，post()的任务抛出的异常不会被捕获；需要结果或异常时用submitTask()
+
+namespace strand_detail {
+
+// 串行执行的作业连续执行的任务数量上限
+constexpr size_t DRAIN_BATCH = 64;
+
+// 向线程池提交作业，线程池队列已满时在当前线程执行
+inline void postOrRun(ThreadPoolBase& pool, ThreadPoolBase::Job job) {
+    if (!pool.tryPost(job)) {
+        job();
+    }
+}
+
+// 把func和参数打包为将结果存入promise的任务
+template <typename Func, typename... Args>
+auto packTask(Func&& func, Args&&... args) {
+    using RType = decltype(func(args...));
+    std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+    std::future<RType> result = promise.get_future();
+    TaskFunc task = [promise = std::move(promise),
+                     func = std::forward<Func>(func),
+                     args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        try {
+            if constexpr (std::is_void_v<RType>) {
+                std::apply(func, args);
+                promise.set_value();
+            } else {
+                promise.set_value(std::apply(func, args));
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    };
+    return std::make_pair(std::move(task), std::move(result));
+}
+
+}  // namespace strand_detail
+
+
+// 单个串行执行器  任务保存在无锁的多生产者单消费者链表中，节点从内存块池分配；
+// 没有任务时只占用对象本身的几个指针，不持有堆内存
+//   Strand conn(pool);
+//   conn.post([&] { onRead(); });
+//   conn.post([&] { onWrite(); });  // onRead()执行完之后才执行
+class Strand {
+public:
+    explicit Strand(ThreadPoolBase& pool)
+        : pool_(pool),
+          head_(&stub_),
+          tail_(&stub_) {
+    }
+
+    // 等待已提交的任务执行完，期间帮忙执行线程池中的任务；需在线程池关闭之前析构
+    ~Strand() {
+        pool_.helpUntil(size_);
+    }
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    template <typename Func>
+    void post(Func&& func) {
+        void* p = BlockPool::allocate(sizeof(Node));
+        push(new (p) Node(TaskFunc(std::forward<Func>(func))));
+        if (size_.add() == 0) {
+            strand_detail::postOrRun(pool_, [this]() { drain(); });
+        }
+    }
+
+    // 提交任务，返回future  func的返回值或异常存入future
+    template <typename Func, typename... Args>
+    auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+        auto packed = strand_detail::packTask(std::forward<Func>(func), std::forward<Args>(args)...);
+        post(std::move(packed.first));
+        return std::move(packed.second);
+    }
+
+    // 当前线程是否正在执行这个strand的任务
+    bool runningInThisThread() const {
+        return current_ == this;
+    }
+
+    // 尚未执行完的任务数量
+    size_t size() const {
+        return size_.count();
+    }
+
+private:
+    struct NodeBase {
+        std::atomic<NodeBase*> next_{nullptr};
+    };
+
+    struct Node : NodeBase {
+        explicit Node(TaskFunc func) : func_(std::move(func)) {}
+        TaskFunc func_;
+    };
+
+    ThreadPoolBase& pool_;
+    std::atomic<NodeBase*> head_;  // 最后放入的节点，生产者交换
+    NodeBase* tail_;  // 下一个取出的节点，只由执行中的作业访问
+    NodeBase stub_;  // 链表为空时的占位节点
+    CompletionCounter size_;  // 尚未执行完的任务数量，从0变为1的提交者负责提交作业
+
+    static inline thread_local const Strand* current_ = nullptr;
+
+    void push(NodeBase* node) {
+        node->next_.store(nullptr, std::memory_order_relaxed);
+        NodeBase* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next_.store(node, std::memory_order_release);
+    }
+
+    // 取出最早的节点  生产者交换了head_但还没有链接上时返回nullptr
+    Node* pop() {
+        NodeBase* tail = tail_;
+        NodeBase* next = tail->next_.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next_.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        // 只剩最后一个节点，放回占位节点后才能取出它
+        push(&stub_);
+        next = tail->next_.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return static_cast<Node*>(tail);
+        }
+        return nullptr;
+    }
+
+    // 依次执行任务，执行完最后一个任务后返回
+    void drain() {
+        const Strand* saved = current_;
+        current_ = this;
+        size_t executed = 0;
+        for (;;) {
+            Node* node;
+            while ((node = pop()) == nullptr) {
+                // size_已计入但生产者还没有链接节点，很快会完成
+                std::this_thread::yield();
+            }
+            node->func_();
+            node->~Node();
+            BlockPool::deallocate(node, sizeof(Node));
+
+            // 计数减到0之后析构随时可能返回
+            if (size_.done()) {
+                break;
+            }
+            if (++executed >= strand_detail::DRAIN_BATCH) {
+                // 让出工作线程，线程池队列已满时继续在当前线程执行
+                ThreadPoolBase::Job job = [this]() { drain(); };
+                if (pool_.tryPost(job)) {
+                    break;
+                }
+                executed = 0;
+            }
+        }
+        current_ = saved;
+    }
+};
+
+
+// 按键分组的串行执行器  同一个键的任务按提交顺序逐个执行，不同键的任务并行执行
+// 只为有任务的键保存状态(一个哈希表项和任务队列)，键的任务全部执行完后删除，
+// 因此键的数量(连接、账户)可以达到数百万；哈希表分为多个分片，各有一把锁，只在存取任务时持有，执行任务时不持有
+//   StrandMap<uint64_t> accounts(pool);
+//   accounts.post(accountId, [=] { apply(accountId, delta); });
+template <typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class StrandMap {
+public:
+    static constexpr size_t DEFAULT_SHARDS = 64;
+
+    explicit StrandMap(ThreadPoolBase& pool, size_t shards = DEFAULT_SHARDS)
+        : pool_(pool),
+          shardCount_(shards == 0 ? 1 : shards),
+          shards_(new Shard[shardCount_]) {
+    }
+
+    // 等待所有键的任务执行完，期间帮忙执行线程池中的任务；需在线程池关闭之前析构
+    ~StrandMap() {
+        pool_.helpUntil(active_);
+    }
+
+    StrandMap(const StrandMap&) = delete;
+    StrandMap& operator=(const StrandMap&) = delete;
+
+    template <typename Func>
+    void post(const Key& key, Func&& func) {
+        Shard& shard = shardOf(key);
+        Entry* entry;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex_);
+            auto [it, inserted] = shard.map_.try_emplace(key);
+            it->second.tasks_.push_back(TaskFunc(std::forward<Func>(func)));
+            if (!inserted) {
+                return ;
+            }
+            entry = &it->second;
+            entry->key_ = &it->first;
+        }
+        active_.add();
+        strand_detail::postOrRun(pool_, [this, &shard, entry]() { drain(shard, entry); });
+    }
+
+    // 提交任务，返回future  func的返回值或异常存入future
+    template <typename Func, typename... Args>
+    auto submitTask(const Key& key, Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+        auto packed = strand_detail::packTask(std::forward<Func>(func), std::forward<Args>(args)...);
+        post(key, std::move(packed.first));
+        return std::move(packed.second);
+    }
+
+    // 有尚未执行完的任务的键的数量
+    size_t activeKeys() const {
+        return active_.count();
+    }
+
+private:
+    struct Entry {
+        RingDeque<TaskFunc> tasks_;  // 队首为正在执行或下一个执行的任务
+        const Key* key_ = nullptr;  // 指向哈希表节点中的键，删除时使用
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex_;
+        std::unordered_map<Key, Entry, Hash, KeyEqual> map_;
+    };
+
+    ThreadPoolBase& pool_;
+    size_t shardCount_;
+    std::unique_ptr<Shard[]> shards_;
+    CompletionCounter active_;  // 有任务的键的数量(即执行中的作业数量)
+    Hash hash_;
+
+    Shard& shardOf(const Key& key) {
+        size_t h = hash_(key);
+        // 混合高位，避免与哈希表的桶选择使用相同的低位
+        h ^= h >> 17;
+        h *= 0x9e3779b97f4a7c15ull;
+        return shards_[(h >> 32) % shardCount_];
+    }
+
+    // 依次执行一个键的任务，队列为空时删除这个键；任务执行完才出队，提交者据此判断是否需要提交作业
+    void drain(Shard& shard, Entry* entry) {
+        size_t executed = 0;
+        for (;;) {
+            TaskFunc task;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex_);
+                task = std::move(entry->tasks_.front());
+            }
+            task();
+            task = TaskFunc();
+
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex_);
+                entry->tasks_.pop_front();
+                if (entry->tasks_.empty()) {
+                    Key key = *entry->key_;
+                    shard.map_.erase(key);
+                    entry = nullptr;
+                }
+            }
+            if (entry == nullptr) {
+                break;
+            }
+            if (++executed >= strand_detail::DRAIN_BATCH) {
+                ThreadPoolBase::Job job = [this, &shard, entry]() { drain(shard, entry); };
+                if (pool_.tryPost(job)) {
+                    return ;
+                }
+                executed = 0;
+            }
+        }
+        // 计数减到0之后析构随时可能返回
+        active_.done();
+    }
+};
+
+#endif
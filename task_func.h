@@ -0,0 +1,121 @@
+#ifndef TASK_FUNC_H
+#define TASK_FUNC_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只能移动的任务类型  相当于std::function<void()>，但可以保存只能移动的可调用对象(如std::promise)
+// 捕获不超过INLINE_SIZE字节的可调用对象直接存放在内部缓冲区中，不需要分配堆内存
+class TaskFunc {
+public:
+    static constexpr size_t INLINE_SIZE = 56;
+
+    TaskFunc() noexcept : ops_(nullptr) {}
+    TaskFunc(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+    template <typename Func, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Func>, TaskFunc>>>
+    TaskFunc(Func&& func) : ops_(nullptr) {
+        using Fn = std::decay_t<Func>;
+        if constexpr (isInline<Fn>()) {
+            new (buf_) Fn(std::forward<Func>(func));
+            ops_ = &InlineOps<Fn>::ops;
+        } else {
+            *reinterpret_cast<Fn**>(buf_) = new Fn(std::forward<Func>(func));
+            ops_ = &HeapOps<Fn>::ops;
+        }
+    }
+
+    ~TaskFunc() {
+        reset();
+    }
+
+    TaskFunc(TaskFunc&& other) noexcept : ops_(other.ops_) {
+        if (ops_ != nullptr) {
+            ops_->move(other.buf_, buf_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    TaskFunc& operator=(TaskFunc&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops_ = other.ops_;
+            if (ops_ != nullptr) {
+                ops_->move(other.buf_, buf_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    TaskFunc(const TaskFunc&) = delete;
+    TaskFunc& operator=(const TaskFunc&) = delete;
+
+    // 执行任务
+    void operator()() {
+        ops_->call(buf_);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+
+    // 是否存放在内部缓冲区中(测试分配次数时使用)
+    template <typename Fn>
+    static constexpr bool isInline() {
+        return sizeof(Fn) <= INLINE_SIZE
+            && alignof(Fn) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<Fn>;
+    }
+
+private:
+    // 类型擦除后的操作表
+    struct Ops {
+        void (*call)(void* buf);
+        void (*move)(void* from, void* to) noexcept;  // 移动到to并析构from
+        void (*destroy)(void* buf) noexcept;
+    };
+
+    template <typename Fn>
+    struct InlineOps {
+        static void call(void* buf) {
+            (*static_cast<Fn*>(buf))();
+        }
+        static void move(void* from, void* to) noexcept {
+            new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        }
+        static void destroy(void* buf) noexcept {
+            static_cast<Fn*>(buf)->~Fn();
+        }
+        static constexpr Ops ops = { &call, &move, &destroy };
+    };
+
+    template <typename Fn>
+    struct HeapOps {
+        static void call(void* buf) {
+            (**static_cast<Fn**>(buf))();
+        }
+        static void move(void* from, void* to) noexcept {
+            *static_cast<Fn**>(to) = *static_cast<Fn**>(from);
+        }
+        static void destroy(void* buf) noexcept {
+            delete *static_cast<Fn**>(buf);
+        }
+        static constexpr Ops ops = { &call, &move, &destroy };
+    };
+
+    void reset() noexcept {
+        if (ops_ != nullptr) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE];
+    const Ops* ops_;
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "threadpool_base.h"
+
+// 任务依赖图(DAG)  节点为无参可调用对象，边a->b表示b在a完成之后执行
+// 每个节点有一个原子计数器记录尚未完成的前驱数量，最后一个完成的前驱把它放入线程池，
+// 执行中的任务从不阻塞等待其他任务；前驱写入的数据对后继可见，节点之间通过捕获的变量传递结果
+// 图建好之后可以反复run，每次只重置计数器，不重新分配内存；同一个图不能同时run多次
+class TaskGraph {
+public:
+    using NodeId = size_t;
+
+    TaskGraph() : failed_(false), checked_(true) {}
+    ~TaskGraph() = default;
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // 添加节点，返回节点id  func在每次run时执行一次
+    template <typename Func>
+    NodeId addNode(Func&& func) {
+        nodes_.emplace_back(std::make_unique<Node>());
+        nodes_.back()->func_ = TaskFunc(std::forward<Func>(func));
+        checked_ = false;
+        return nodes_.size() - 1;
+    }
+
+    // 添加边from->to，to在from完成之后才执行
+    void addEdge(NodeId from, NodeId to) {
+        if (from >= nodes_.size() || to >= nodes_.size() || from == to) {
+            throw std::invalid_argument("TaskGraph: invalid edge");
+        }
+        nodes_[from]->successors_.push_back(to);
+        nodes_[to]->predecessors_++;
+        checked_ = false;
+    }
+
+    size_t size() const {
+        return nodes_.size();
+    }
+
+    // 在线程池中执行整个图，所有节点完成后返回
+    // 调用线程不阻塞，而是一起执行线程池中的任务；在工作线程中调用也不会占住线程
+    // 有节点抛出异常时，尚未开始的节点不再执行(但仍按依赖关系完成计数)，全部结束后重新抛出第一个异常
+    void run(ThreadPoolBase& pool) {
+        if (!checked_) {
+            check();
+        }
+        if (nodes_.empty()) {
+            return ;
+        }
+
+        // 上一次run已经全部结束，这里没有并发访问
+        for (auto& node : nodes_) {
+            node->pending_.store(node->predecessors_, std::memory_order_relaxed);
+        }
+        remaining_.add(nodes_.size());
+        failed_.store(false, std::memory_order_relaxed);
+        error_ = nullptr;
+
+        for (NodeId root : roots_) {
+            post(pool, root);
+        }
+        wait(pool);
+    }
+
+private:
+    struct Node {
+        TaskFunc func_;
+        std::vector<NodeId> successors_;
+        size_t predecessors_ = 0;  // 前驱数量
+        std::atomic<size_t> pending_{0};  // 本次run中尚未完成的前驱数量
+    };
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::vector<NodeId> roots_;  // 没有前驱的节点
+    CompletionCounter remaining_;  // 本次run中尚未完成的节点数量
+    std::atomic_bool failed_;
+    std::exception_ptr error_;
+    std::mutex mutex_;  // 保护error_
+    bool checked_;  // 图修改后是否已检查过环并求出roots_
+
+    // 求出没有前驱的节点，并按拓扑排序检查图中是否有环
+    void check() {
+        roots_.clear();
+        std::vector<size_t> indegree(nodes_.size());
+        std::vector<NodeId> ready;
+        for (NodeId id = 0; id < nodes_.size(); id++) {
+            indegree[id] = nodes_[id]->predecessors_;
+            if (indegree[id] == 0) {
+                roots_.push_back(id);
+                ready.push_back(id);
+            }
+        }
+        size_t visited = 0;
+        while (!ready.empty()) {
+            NodeId id = ready.back();
+            ready.pop_back();
+            visited++;
+            for (NodeId next : nodes_[id]->successors_) {
+                if (--indegree[next] == 0) {
+                    ready.push_back(next);
+                }
+            }
+        }
+        if (visited != nodes_.size()) {
+            roots_.clear();
+            throw std::invalid_argument("TaskGraph: graph contains a cycle");
+        }
+        checked_ = true;
+    }
+
+    // 将节点交给线程池，队列已满时直接在当前线程执行
+    void post(ThreadPoolBase& pool, NodeId id) {
+        ThreadPoolBase::Job job = [this, &pool, id]() { execute(pool, id); };
+        if (!pool.tryPost(job)) {
+            job();
+        }
+    }
+
+    // 执行节点并通知后继  就绪的后继中最后一个由当前线程接着执行，其余交给线程池，
+    // 链式依赖不经过任务队列，也不会递归加深调用栈
+    void execute(ThreadPoolBase& pool, NodeId id) {
+        // 完成计数之后只有next尚未完成时才继续访问成员，此时run不会返回；否则图随时可能被释放或再次run
+        const NodeId none = nodes_.size();
+        for (;;) {
+            Node& node = *nodes_[id];
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    node.func_();
+                } catch (...) {
+                    setError(std::current_exception());
+                }
+            }
+
+            NodeId next = none;
+            for (NodeId succ : node.successors_) {
+                if (nodes_[succ]->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next != none) {
+                        post(pool, next);
+                    }
+                    next = succ;
+                }
+            }
+            remaining_.done();
+            if (next == none) {
+                return ;
+            }
+            id = next;
+        }
+    }
+
+    void setError(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+            error_ = e;
+        }
+        failed_ = true;
+    }
+
+    // 执行线程池中的任务直到所有节点完成
+    void wait(ThreadPoolBase& pool) {
+        pool.helpUntil(remaining_);
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+};
+
+#endif
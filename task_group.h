@@ -0,0 +1,149 @@
+#ifndef TASK_GROUP_H
+#define TASK_GROUP_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include "threadpool_base.h"
+#include "ring_deque.h"
+#include "cancellation.h"
+
+// 结构化的任务组  run(f)把f交给线程池，wait()等待组内所有任务完成
+// 组内任务先放入组自己的队列，再向线程池提交一个取出并执行组内任务的作业；
+// wait()的线程从组的队列取任务执行(后放入的先执行，与工作窃取相同)，组的队列为空时再执行线程池中的其他任务，
+// 等待期间不占住线程，任务在工作线程中创建子任务组并等待(递归分治)也不会在固定大小的线程池中死锁
+// 任务抛出异常时取消组内尚未开始的任务，wait()重新抛出第一个异常；执行中的任务可以用isCancelled()检查后提前返回
+// 构造时传入令牌，令牌取消时组内尚未开始的任务同样不再执行(wait()不因此抛出异常)
+//   TaskGroup g(pool);
+//   g.run([&] { left = solve(a, mid); });
+//   right = solve(mid, b);
+//   g.wait();
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPoolBase& pool, CancellationToken token = CancellationToken())
+        : pool_(pool),
+          token_(std::move(token)),
+          cancelled_(false) {
+    }
+
+    // 没有调用wait()时在析构中等待(不抛出异常)，因异常离开作用域时先取消尚未开始的任务
+    ~TaskGroup() {
+        if (pending_.count() > 0 && std::uncaught_exceptions() > 0) {
+            cancel();
+        }
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    // 在线程池中执行func  任务队列已满时由当前线程执行组内的一个任务
+    template <typename Func>
+    void run(Func&& func) {
+        pending_.add();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(TaskFunc(std::forward<Func>(func)));
+        }
+        ThreadPoolBase::Job job = [this]() {
+            TaskFunc task;
+            if (popFront(task)) {
+                execute(task);
+            }
+            // 计数减到0之后wait随时可能返回，任务组可能被释放
+            pending_.done();
+        };
+        if (!pool_.tryPost(job)) {
+            job();
+        }
+    }
+
+    // 等待组内所有任务完成，期间执行组内和线程池中的任务；有任务抛出异常时重新抛出第一个
+    // 返回(或抛出)之后任务组恢复初始状态，可以继续使用
+    void wait() {
+        pool_.helpUntil(pending_, [this]() {
+            TaskFunc task;
+            if (!popBack(task)) {
+                return false;
+            }
+            execute(task);
+            return true;
+        });
+
+        std::exception_ptr error = std::move(error_);
+        error_ = nullptr;
+        cancelled_.store(false, std::memory_order_relaxed);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // 取消组内尚未开始的任务，执行中的任务不受影响
+    void cancel() {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    // 是否已被取消(调用了cancel()、有任务抛出异常或令牌已取消)
+    bool isCancelled() const {
+        return cancelled_.load(std::memory_order_relaxed) || token_.isCancelled();
+    }
+
+private:
+    ThreadPoolBase& pool_;
+    CancellationToken token_;
+    std::mutex mutex_;  // 保护tasks_
+    RingDeque<TaskFunc> tasks_;  // 组内尚未开始的任务
+    CompletionCounter pending_;  // 尚未完成的作业数量，每个作业最多执行一个组内任务
+    std::atomic_bool cancelled_;
+    std::exception_ptr error_;
+    std::mutex errorMutex_;
+
+    // 线程池中的作业从队首取出最早的任务
+    bool popFront(TaskFunc& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) {
+            return false;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+        return true;
+    }
+
+    // 等待的线程从队尾取出最近放入的任务
+    bool popBack(TaskFunc& task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) {
+            return false;
+        }
+        task = std::move(tasks_.back());
+        tasks_.pop_back();
+        return true;
+    }
+
+    // 已取消时只丢弃任务；等待的线程直接执行的任务，其作业之后取不到任务，只完成计数
+    void execute(TaskFunc& task) {
+        if (isCancelled()) {
+            return ;
+        }
+        try {
+            task();
+        } catch (...) {
+            setError(std::current_exception());
+        }
+    }
+
+    void setError(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        if (!error_) {
+            error_ = e;
+        }
+        cancelled_ = true;
+    }
+};
+
+#endif
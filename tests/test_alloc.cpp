@@ -0,0 +1,98 @@
+// 提交路径的堆内存分配  预热之后，小捕获的任务提交和获取结果不再分配内存
+
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+static std::atomic<size_t> g_allocs(0);
+
+// 替换operator new计数，operator delete相应地调用free
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// 释放不内联，否则GCC会把free与计数的operator new误判为不匹配
+[[gnu::noinline]] static void countedFree(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+static const int TASKS = 256;
+static const int ROUNDS = 50;
+
+static long runRound(ThreadPool& pool, std::vector<std::future<int>>& futures) {
+    long sum = 0;
+    for (int i = 0; i < TASKS; i++) {
+        futures.emplace_back(pool.submitTask([i](int b) { return i + b; }, 1));
+    }
+    for (auto& f : futures) {
+        sum += f.get();
+    }
+    futures.clear();
+    return sum;
+}
+
+static void testSteadyState() {
+    for (QueueMode mode : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        ThreadPool pool;
+        pool.setQueueMode(mode);
+        pool.setTaskQueThreshold(TASKS);
+        pool.start(2);
+
+        std::vector<std::future<int>> futures;
+        futures.reserve(TASKS);
+
+        // 线程缓存需要几轮才能填满
+        for (int r = 0; r < 10; r++) {
+            runRound(pool, futures);
+        }
+        size_t before = g_allocs.load();
+        long sum = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            sum += runRound(pool, futures);
+        }
+        size_t allocs = g_allocs.load() - before;
+        CHECK_EQ(sum, long(ROUNDS) * TASKS * (TASKS + 1) / 2);
+
+        // 工作线程的缓存积累到上限之前，提交者偶尔还要分配新的内存块，平均到每个任务远小于1次
+        CHECK(allocs * 10 < size_t(ROUNDS * TASKS));
+    }
+}
+
+int main() {
+    RUN_TEST(testSteadyState);
+    return 0;
+}
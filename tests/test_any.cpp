@@ -0,0 +1,189 @@
+// Any的内部缓冲区和内存池存放、移出取值、类型标记，以及Task/Result接口稳定状态下不分配内存
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "threadpool.h"
+#include "test_util.h"
+
+static std::atomic<size_t> g_allocs(0);
+
+// 替换operator new计数，operator delete相应地调用free
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// 释放不内联，否则GCC会把free与计数的operator new误判为不匹配
+[[gnu::noinline]] static void countedFree(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    countedFree(p);
+}
+
+// 记录析构次数，Size决定放在内部缓冲区还是内存池中
+template <size_t Size>
+struct Counted {
+    static inline int destroyed = 0;
+    std::array<char, Size> data{};
+    bool owner = true;
+
+    Counted() = default;
+    Counted(Counted&& other) noexcept : data(other.data) {
+        other.owner = false;
+    }
+    ~Counted() {
+        if (owner) {
+            destroyed++;
+        }
+    }
+};
+
+static bool castThrows(Any& any) {
+    try {
+        any.cast_<long>();
+    } catch (const char*) {
+        return true;
+    }
+    return false;
+}
+
+static void testInline() {
+    Any a(42);
+    CHECK(a.is<int>());
+    CHECK(!a.is<long>());
+    CHECK(castThrows(a));
+    CHECK_EQ(a.cast_<int>(), 42);
+
+    // 取值移出数据而不是复制
+    std::string text(100, 'x');
+    Any s(std::move(text));
+    std::string out = s.cast_<std::string>();
+    CHECK_EQ(out.size(), size_t(100));
+    CHECK(s.cast_<std::string>().empty());
+
+    std::vector<int> v(1000, 1);
+    const int* data = v.data();
+    Any m(std::move(v));
+    Any moved(std::move(m));
+    CHECK(m.empty());
+    std::vector<int> back = moved.cast_<std::vector<int>>();
+    CHECK(back.data() == data);
+
+    Any none;
+    CHECK(none.empty());
+    CHECK(castThrows(none));
+}
+
+template <size_t Size>
+static void checkDestroyedOnce() {
+    Counted<Size>::destroyed = 0;
+    {
+        Any a{Counted<Size>()};
+        Any b(std::move(a));
+        Any c;
+        c = std::move(b);
+        CHECK(c.template is<Counted<Size>>());
+        CHECK_EQ(Counted<Size>::destroyed, 0);
+    }
+    CHECK_EQ(Counted<Size>::destroyed, 1);
+}
+
+static void testLifetime() {
+    checkDestroyedOnce<8>();
+    checkDestroyedOnce<Any::INLINE_SIZE * 4>();
+
+    // 内存池中的数据移动Any时只转移指针
+    Any big{Counted<Any::INLINE_SIZE * 4>()};
+    size_t before = g_allocs.load();
+    Any other(std::move(big));
+    CHECK_EQ(g_allocs.load() - before, size_t(0));
+}
+
+class AddTask : public Task {
+public:
+    AddTask(int a, int b) : a_(a), b_(b) {}
+
+    Any run() {
+        return a_ + b_;
+    }
+
+private:
+    int a_;
+    int b_;
+};
+
+static long runRound(ThreadPool& pool, std::vector<Result>& results, int tasks) {
+    long sum = 0;
+    for (int i = 0; i < tasks; i++) {
+        results.emplace_back(pool.submitTask(makeTask<AddTask>(i, 1)));
+    }
+    for (auto& res : results) {
+        sum += res.get().cast_<int>();
+    }
+    results.clear();
+    return sum;
+}
+
+// Task对象和结果状态来自内存池，预热之后提交和获取结果平均不分配内存
+static void testSteadyState() {
+    const int tasks = 256;
+    const int rounds = 50;
+    for (QueueMode mode : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        ThreadPool pool;
+        pool.setQueueMode(mode);
+        pool.setTaskQueThreshold(tasks);
+        pool.start(2);
+
+        std::vector<Result> results;
+        results.reserve(tasks);
+        for (int r = 0; r < 10; r++) {
+            runRound(pool, results, tasks);
+        }
+        size_t before = g_allocs.load();
+        long sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            sum += runRound(pool, results, tasks);
+        }
+        size_t allocs = g_allocs.load() - before;
+        CHECK_EQ(sum, long(rounds) * tasks * (tasks + 1) / 2);
+        CHECK(allocs * 10 < size_t(rounds * tasks));
+    }
+}
+
+int main() {
+    RUN_TEST(testInline);
+    RUN_TEST(testLifetime);
+    RUN_TEST(testSteadyState);
+    return 0;
+}
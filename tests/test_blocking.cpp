@@ -0,0 +1,114 @@
+// 阻塞区间  进入时补充线程，离开后多出的线程退出；嵌套只计最外层，补充的线程数量不超过线程数量上限
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+// 在阻塞区间中等待release，进入后增加entered
+static void blockIn(ThreadPool& pool, std::atomic_int& entered, std::atomic_bool& release) {
+    ThreadPool::BlockingScope scope(pool);
+    entered++;
+    while (!release) {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+static void testCompensate() {
+    ThreadPool pool;
+    pool.setThreadSizeThreshold(4);
+    pool.start(2);
+
+    std::atomic_int entered(0);
+    std::atomic_bool release(false);
+    auto blocked = pool.submitTask([&]() { blockIn(pool, entered, release); });
+    CHECK(waitUntil([&]() { return entered.load() == 1; }));
+    CHECK_EQ(pool.threadSize(), size_t(3));
+    CHECK_EQ(pool.stats().threadsCompensated_, uint64_t(1));
+
+    // 补充的线程照常执行任务
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 10; i++) {
+        results.push_back(pool.submitTask([i]() { return i; }));
+    }
+    int sum = 0;
+    for (auto& r : results) {
+        sum += r.get();
+    }
+    CHECK_EQ(sum, 45);
+
+    // 离开阻塞区间后多出的线程退出
+    release = true;
+    blocked.get();
+    CHECK(waitUntil([&]() { return pool.threadSize() == size_t(2); }));
+}
+
+static void testNested() {
+    ThreadPool pool;
+    pool.setThreadSizeThreshold(4);
+    pool.start(2);
+
+    std::atomic_int entered(0);
+    std::atomic_bool release(false);
+    auto blocked = pool.submitTask([&]() {
+        ThreadPool::BlockingScope outer(pool);
+        pool.blocking([&]() { blockIn(pool, entered, release); });
+    });
+    CHECK(waitUntil([&]() { return entered.load() == 1; }));
+    CHECK_EQ(pool.threadSize(), size_t(3));
+    CHECK_EQ(pool.stats().threadsCompensated_, uint64_t(1));
+    release = true;
+    blocked.get();
+    CHECK(waitUntil([&]() { return pool.threadSize() == size_t(2); }));
+}
+
+static void testLimit() {
+    ThreadPool pool;
+    pool.setThreadSizeThreshold(3);
+    pool.start(2);
+
+    // 两个线程都阻塞，只能再补充一个线程
+    std::atomic_int entered(0);
+    std::atomic_bool release(false);
+    std::vector<std::future<void>> blocked;
+    for (int i = 0; i < 3; i++) {
+        blocked.push_back(pool.submitTask([&]() { blockIn(pool, entered, release); }));
+    }
+    CHECK(waitUntil([&]() { return entered.load() == 3; }));
+    CHECK_EQ(pool.threadSize(), size_t(3));
+    CHECK_EQ(pool.stats().threadsCompensated_, uint64_t(1));
+
+    release = true;
+    for (auto& b : blocked) {
+        b.get();
+    }
+    CHECK(waitUntil([&]() { return pool.threadSize() == size_t(2); }));
+}
+
+// 不在工作线程中时什么也不做
+static void testOutsidePool() {
+    ThreadPool pool;
+    pool.setThreadSizeThreshold(4);
+    pool.start(2);
+    {
+        ThreadPool::BlockingScope scope(pool);
+        ThreadPool::BlockingScope current;
+        CHECK_EQ(pool.threadSize(), size_t(2));
+    }
+    CHECK_EQ(pool.threadSize(), size_t(2));
+    CHECK_EQ(pool.stats().threadsCompensated_, uint64_t(0));
+}
+
+int main() {
+    RUN_TEST(testCompensate);
+    RUN_TEST(testNested);
+    RUN_TEST(testLimit);
+    RUN_TEST(testOutsidePool);
+    return 0;
+}
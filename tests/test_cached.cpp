@@ -0,0 +1,59 @@
+// Cached模式的线程数量控制  任务积压、等待时间超过目标时由控制线程扩充，空闲超过keepAlive的多余线程退出
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static void testGrowAndRetire() {
+    ThreadPool pool;
+    pool.setMode(PoolMode::Mode_Cached);
+    pool.setThreadSizeThreshold(8);
+    pool.setKeepAliveTime(100ms);
+    pool.setTargetQueueWait(1ms);
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    // 任务在等待而不占用CPU，积压时扩充线程
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 32; i++) {
+        results.push_back(pool.submitTask([]() { std::this_thread::sleep_for(20ms); }));
+    }
+    CHECK(waitUntil([&]() { return pool.threadSize() > 1; }));
+    for (auto& r : results) {
+        r.get();
+    }
+    PoolStats stats = pool.stats();
+    CHECK(stats.threadsSpawned_ > 0);
+    CHECK(stats.threadSize_ <= 8);
+
+    // 空闲超过keepAlive后回到下限(默认为初始线程数量)
+    CHECK(waitUntil([&]() { return pool.threadSize() == 1; }));
+    CHECK(pool.stats().threadsRetired_ > 0);
+}
+
+// 线程数量下限之内的线程不会退出
+static void testMinimum() {
+    ThreadPool pool;
+    pool.setMode(PoolMode::Mode_Cached);
+    pool.setThreadSizeThreshold(8);
+    pool.setThreadSizeMin(2);
+    pool.setKeepAliveTime(20ms);
+    pool.start(4);
+    CHECK(waitUntil([&]() { return pool.threadSize() == 2; }));
+    std::this_thread::sleep_for(100ms);
+    CHECK_EQ(pool.threadSize(), size_t(2));
+    CHECK_EQ(pool.submitTask([]() { return 7; }).get(), 7);
+}
+
+int main() {
+    RUN_TEST(testGrowAndRetire);
+    RUN_TEST(testMinimum);
+    return 0;
+}
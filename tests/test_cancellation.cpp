@@ -0,0 +1,163 @@
+// 协作式取消  令牌与子来源、队列中和执行中的任务取消、任务组的令牌
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "task_group.h"
+#include "cancellation.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+static void testToken() {
+    CancellationToken none;
+    CHECK(!none.canBeCancelled());
+    CHECK(!none.isCancelled());
+
+    CancellationSource source;
+    CancellationToken token = source.token();
+    CHECK(token.canBeCancelled());
+    CHECK(!token.isCancelled());
+    source.cancel();
+    CHECK(token.isCancelled());
+    CHECK(source.isCancelled());
+    CHECK_THROWS(token.throwIfCancelled(), TaskCancelled);
+}
+
+static void testChildSource() {
+    // 父来源取消时子来源一起取消，子来源取消不影响父来源和兄弟来源
+    CancellationSource parent;
+    CancellationSource child(parent.token());
+    CancellationSource sibling(parent.token());
+    CancellationSource grandchild(child.token());
+
+    child.cancel();
+    CHECK(child.isCancelled());
+    CHECK(grandchild.isCancelled());
+    CHECK(!parent.isCancelled());
+    CHECK(!sibling.isCancelled());
+
+    parent.cancel();
+    CHECK(sibling.token().isCancelled());
+}
+
+// 占住唯一的工作线程，令随后的任务留在队列中
+static void blockWorker(ThreadPool& pool, std::atomic_bool& started, std::atomic_bool& release) {
+    pool.submitTask([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+}
+
+static void testQueuedTasks() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(1);
+        std::atomic_bool started(false);
+        std::atomic_bool release(false);
+        blockWorker(pool, started, release);
+
+        // 队列中的任务在取出时发现令牌已取消，不执行，未关联令牌和关联其他来源的任务照常执行
+        CancellationSource source;
+        CancellationSource other;
+        std::atomic<int> ran(0);
+        std::vector<std::future<int>> cancelled;
+        for (int i = 0; i < 10; i++) {
+            cancelled.push_back(pool.submitTask(source.token(), [&]() { ran++; return 1; }));
+        }
+        auto plain = pool.submitTask([]() { return 2; });
+        auto kept = pool.submitTask(other.token(), []() { return 3; });
+        source.cancel();
+        release = true;
+
+        for (auto& f : cancelled) {
+            CHECK_THROWS(f.get(), TaskCancelled);
+        }
+        CHECK_EQ(ran.load(), 0);
+        CHECK_EQ(plain.get(), 2);
+        CHECK_EQ(kept.get(), 3);
+    }
+}
+
+static void testRunningTask() {
+    ThreadPool pool;
+    pool.start(2);
+
+    // 执行中的任务轮询令牌，throwIfCancelled()使get()抛出TaskCancelled
+    CancellationSource source;
+    std::atomic_bool started(false);
+    auto f = pool.submitTask(source.token(), [&, token = source.token()]() {
+        started = true;
+        for (;;) {
+            token.throwIfCancelled();
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    source.cancel();
+    CHECK_THROWS(f.get(), TaskCancelled);
+}
+
+static void testChildCancelsTasks() {
+    // 按层级成组取消  父来源取消时子来源的任务也不再执行
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    blockWorker(pool, started, release);
+
+    CancellationSource connection;
+    CancellationSource request(connection.token());
+    auto a = pool.submitTask(request.token(), []() { return 1; });
+    auto b = pool.submitTask(connection.token(), []() { return 2; });
+    connection.cancel();
+    release = true;
+    CHECK_THROWS(a.get(), TaskCancelled);
+    CHECK_THROWS(b.get(), TaskCancelled);
+}
+
+static void testTaskGroupToken() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    blockWorker(pool, started, release);
+
+    // 令牌取消后组内尚未开始的任务不再执行，wait()不抛出异常
+    CancellationSource source;
+    std::atomic<int> ran(0);
+    TaskGroup g(pool, source.token());
+    for (int i = 0; i < 20; i++) {
+        g.run([&]() { ran++; });
+    }
+    CHECK(!g.isCancelled());
+    source.cancel();
+    CHECK(g.isCancelled());
+    release = true;
+    g.wait();
+    CHECK_EQ(ran.load(), 0);
+}
+
+int main() {
+    RUN_TEST(testToken);
+    RUN_TEST(testChildSource);
+    RUN_TEST(testQueuedTasks);
+    RUN_TEST(testRunningTask);
+    RUN_TEST(testChildCancelsTasks);
+    RUN_TEST(testTaskGroupToken);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 协程支持  schedule切换到工作线程、spawn、CoTask的返回值和异常传递、async
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "coro_task.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static CoTask<std::thread::id> switchToPool(ThreadPool& pool) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id();
+}
+
+static void testSchedule() {
+    ThreadPool pool;
+    pool.start(2);
+    CHECK(syncWait(switchToPool(pool)) != std::this_thread::get_id());
+
+    // 关闭之后不挂起，在当前线程继续执行
+    pool.shutdown();
+    CHECK(syncWait(switchToPool(pool)) == std::this_thread::get_id());
+}
+
+static CoTask<void> recordThread(std::atomic<std::thread::id>& id) {
+    id = std::this_thread::get_id();
+    co_return;
+}
+
+static void testScheduleWhenFull() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(2);
+    pool.start(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    auto blocker = pool.submitTask([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 2; i++) {
+        results.push_back(pool.submitTask([]() {}));
+    }
+
+    // 任务队列已满，协程仍然挂起，由工作线程恢复
+    std::atomic<std::thread::id> id{};
+    spawn(pool, recordThread(id));
+    CHECK(id.load() == std::thread::id());
+    release = true;
+    CHECK(waitUntil([&]() { return id.load() != std::thread::id(); }));
+    CHECK(id.load() != std::this_thread::get_id());
+    blocker.get();
+    for (auto& r : results) {
+        r.get();
+    }
+}
+
+static CoTask<int> square(ThreadPool& pool, int x) {
+    co_await pool.schedule();
+    if (x < 0) {
+        throw std::invalid_argument("negative");
+    }
+    co_return x * x;
+}
+
+static CoTask<int> sumSquares(ThreadPool& pool, int n) {
+    int sum = 0;
+    for (int i = 1; i <= n; i++) {
+        sum += co_await square(pool, i);
+    }
+    co_return sum;
+}
+
+static void testChaining() {
+    ThreadPool pool;
+    pool.start(2);
+    CHECK_EQ(syncWait(sumSquares(pool, 10)), 385);
+
+    // 内层协程的异常在co_await处重新抛出，经过外层传到syncWait
+    auto outer = [](ThreadPool& pool) -> CoTask<int> {
+        co_return co_await square(pool, -1);
+    };
+    CHECK_THROWS(syncWait(outer(pool)), std::invalid_argument);
+}
+
+static CoTask<int> asyncSum(ThreadPool& pool) {
+    int a = co_await pool.async([](int x) { return x + 1; }, 41);
+    co_await pool.async([]() {});
+    co_return a;
+}
+
+static void testAsync() {
+    ThreadPool pool;
+    pool.start(2);
+    CHECK_EQ(syncWait(asyncSum(pool)), 42);
+
+    auto failing = [](ThreadPool& pool) -> CoTask<int> {
+        co_return co_await pool.async([]() -> int { throw std::runtime_error("async"); });
+    };
+    CHECK_THROWS(syncWait(failing(pool)), std::runtime_error);
+}
+
+int main() {
+    RUN_TEST(testSchedule);
+    RUN_TEST(testScheduleWhenFull);
+    RUN_TEST(testChaining);
+    RUN_TEST(testAsync);
+    return 0;
+}
@@ -0,0 +1,205 @@
+// CpuTopology的sysfs拓扑解析、cgroup v2/v1配额解析和sched_getaffinity
+// 拓扑和cgroup文件写入临时目录，以它为根目录读取
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "cpu_topology.h"
+#include "test_util.h"
+
+namespace fs = std::filesystem;
+
+// 临时根目录，析构时删除
+class Fixture {
+public:
+    Fixture() {
+        char tmpl[] = "/tmp/cpu_topology_XXXXXX";
+        CHECK(mkdtemp(tmpl) != nullptr);
+        root_ = tmpl;
+    }
+
+    ~Fixture() {
+        fs::remove_all(root_);
+    }
+
+    void write(const std::string& path, const std::string& content) {
+        fs::path file = root_ + path;
+        fs::create_directories(file.parent_path());
+        std::ofstream(file) << content << "\n";
+    }
+
+    const std::string& root() const {
+        return root_;
+    }
+
+private:
+    std::string root_;
+};
+
+// 2个NUMA节点，每个节点一个封装、一个末级缓存、2个物理核，每个核2个超线程
+// cpu0/cpu2为封装0的核0，cpu1/cpu3为核1；cpu4-7同样分布在封装1上
+static void writeSysfs(Fixture& f) {
+    for (int cpu = 0; cpu < 8; cpu++) {
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        int package = cpu / 4;
+        f.write(dir + "/topology/physical_package_id", std::to_string(package));
+        f.write(dir + "/topology/core_id", std::to_string(cpu % 2));
+        f.write(dir + "/cache/index0/level", "1");
+        f.write(dir + "/cache/index0/shared_cpu_list", std::to_string(cpu));
+        f.write(dir + "/cache/index1/level", "3");
+        f.write(dir + "/cache/index1/shared_cpu_list", package == 0 ? "0-3" : "4-7");
+    }
+    f.write("/sys/devices/system/node/online", "0-1");
+    f.write("/sys/devices/system/node/node0/cpulist", "0-3");
+    f.write("/sys/devices/system/node/node1/cpulist", "4-7");
+}
+
+static void testParseCpuList() {
+    CHECK(CpuTopology::parseCpuList("0-3,8,10-11") == std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }));
+    CHECK(CpuTopology::parseCpuList("5") == std::vector<int>({ 5 }));
+    CHECK(CpuTopology::parseCpuList("").empty());
+    CHECK(CpuTopology::parseCpuList("x,2") == std::vector<int>({ 2 }));
+}
+
+static void testSysfsTopology() {
+    Fixture f;
+    writeSysfs(f);
+    CpuTopology topo = CpuTopology::load({ 0, 1, 2, 3, 4, 5, 6, 7 }, f.root());
+    CHECK_EQ(topo.cpus().size(), 8u);
+
+    CpuInfo c2 = topo.find(2);
+    CHECK_EQ(c2.core_, 0);
+    CHECK_EQ(c2.llc_, 0);
+    CHECK_EQ(c2.node_, 0);
+    CpuInfo c7 = topo.find(7);
+    CHECK_EQ(c7.core_, 65536 + 1);
+    CHECK_EQ(c7.llc_, 4);
+    CHECK_EQ(c7.node_, 1);
+    CHECK_EQ(topo.find(9).node_, -1);
+
+    // 紧凑：同一物理核的超线程相邻；分散：轮流取两个缓存，先取不同的物理核
+    CHECK(topo.place(AffinityPolicy::Affinity_Compact, 8) == std::vector<int>({ 0, 2, 1, 3, 4, 6, 5, 7 }));
+    CHECK(topo.place(AffinityPolicy::Affinity_Scatter, 8) == std::vector<int>({ 0, 4, 1, 5, 2, 6, 3, 7 }));
+    CHECK(topo.place(AffinityPolicy::Affinity_Scatter, 10).size() == 10u);
+    CHECK(topo.place(AffinityPolicy::Affinity_Explicit, 3, { 6, 7 }) == std::vector<int>({ 6, 7, 6 }));
+    CHECK(topo.place(AffinityPolicy::Affinity_None, 4).empty());
+
+    // 只有部分CPU可用(taskset/cpuset)时只包含这些CPU
+    CpuTopology subset = CpuTopology::load({ 1, 5 }, f.root());
+    CHECK_EQ(subset.cpus().size(), 2u);
+    CHECK_EQ(subset.find(5).node_, 1);
+    CHECK(subset.place(AffinityPolicy::Affinity_Compact, 2) == std::vector<int>({ 1, 5 }));
+
+    // 没有sysfs信息时位置字段为-1
+    Fixture empty;
+    CpuInfo unknown = CpuTopology::load({ 3 }, empty.root()).find(3);
+    CHECK(unknown.core_ == -1 && unknown.llc_ == -1 && unknown.node_ == -1);
+}
+
+static void testCgroupV2() {
+    Fixture f;
+    f.write("/proc/self/cgroup", "0::/user.slice/app.scope");
+    f.write("/proc/self/mountinfo",
+            "24 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+            "35 24 0:30 / /sys/fs/cgroup rw,nosuid,nodev,noexec,relatime shared:9 - cgroup2 cgroup2 rw,nsdelegate");
+    f.write("/sys/fs/cgroup/user.slice/app.scope/cpu.max", "max 100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 0);
+
+    // 上层cgroup的限制同样生效，取最小值
+    f.write("/sys/fs/cgroup/user.slice/cpu.max", "150000 100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 1.5);
+    f.write("/sys/fs/cgroup/user.slice/app.scope/cpu.max", "50000 100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 0.5);
+
+    // 默认线程数量不超过向上取整的配额
+    f.write("/sys/fs/cgroup/user.slice/app.scope/cpu.max", "250000 100000");
+    f.write("/sys/fs/cgroup/user.slice/cpu.max", "max 100000");
+    writeSysfs(f);
+    CHECK_EQ(CpuTopology::load({ 0, 1, 2, 3, 4, 5, 6, 7 }, f.root()).defaultThreadSize(), 3u);
+    CHECK_EQ(CpuTopology::load({ 0, 1 }, f.root()).defaultThreadSize(), 2u);
+}
+
+static void testCgroupV2Namespace() {
+    // 容器内挂载的是cgroup层级的子目录，/proc/self/cgroup中的路径需要去掉挂载根目录
+    Fixture f;
+    f.write("/proc/self/cgroup", "0::/docker/abc");
+    f.write("/proc/self/mountinfo",
+            "40 30 0:31 /docker/abc /sys/fs/cgroup ro,nosuid - cgroup2 cgroup rw");
+    f.write("/sys/fs/cgroup/cpu.max", "200000 100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 2.0);
+}
+
+static void testCgroupV1() {
+    Fixture f;
+    f.write("/proc/self/cgroup",
+            "5:memory:/batch\n"
+            "4:cpu,cpuacct:/batch\n"
+            "1:name=systemd:/batch");
+    f.write("/proc/self/mountinfo",
+            "24 1 8:1 / / rw,relatime shared:1 - ext4 /dev/sda1 rw\n"
+            "30 25 0:26 / /sys/fs/cgroup/memory rw,nosuid shared:10 - cgroup cgroup rw,memory\n"
+            "31 25 0:27 / /sys/fs/cgroup/cpu,cpuacct rw,nosuid shared:11 - cgroup cgroup rw,cpu,cpuacct");
+    f.write("/sys/fs/cgroup/cpu,cpuacct/batch/cpu.cfs_quota_us", "-1");
+    f.write("/sys/fs/cgroup/cpu,cpuacct/batch/cpu.cfs_period_us", "100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 0);
+
+    f.write("/sys/fs/cgroup/cpu,cpuacct/batch/cpu.cfs_quota_us", "250000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 2.5);
+}
+
+static void testCgroupV1Fallback() {
+    // 混合模式：v2层级没有cpu.max(cpu控制器在v1上)时读取v1的配额
+    Fixture f;
+    f.write("/proc/self/cgroup",
+            "4:cpu,cpuacct:/job\n"
+            "0::/job");
+    f.write("/proc/self/mountinfo",
+            "31 25 0:27 / /sys/fs/cgroup/cpu,cpuacct rw,nosuid - cgroup cgroup rw,cpu,cpuacct\n"
+            "32 25 0:28 / /sys/fs/cgroup/unified rw,nosuid - cgroup2 cgroup2 rw");
+    f.write("/sys/fs/cgroup/unified/job/cgroup.procs", "1");
+    f.write("/sys/fs/cgroup/cpu,cpuacct/job/cpu.cfs_quota_us", "50000");
+    f.write("/sys/fs/cgroup/cpu,cpuacct/job/cpu.cfs_period_us", "100000");
+    CHECK(CpuTopology::cpuQuota(f.root()) == 0.5);
+}
+
+static void testNoCgroup() {
+    Fixture f;
+    CHECK(CpuTopology::cpuQuota(f.root()) == 0);
+}
+
+static void testDetectAffinity() {
+    cpu_set_t saved;
+    CPU_ZERO(&saved);
+    CHECK(sched_getaffinity(0, sizeof(saved), &saved) == 0);
+    CHECK_EQ(CpuTopology::detect().cpus().size(), size_t(CPU_COUNT(&saved)));
+
+    // 限制为一个CPU(相当于taskset -c)，detect只返回这个CPU
+    int first = 0;
+    while (!CPU_ISSET(first, &saved)) {
+        first++;
+    }
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(first, &one);
+    CHECK(sched_setaffinity(0, sizeof(one), &one) == 0);
+    CpuTopology topo = CpuTopology::detect();
+    CHECK(sched_setaffinity(0, sizeof(saved), &saved) == 0);
+    CHECK_EQ(topo.cpus().size(), 1u);
+    CHECK_EQ(topo.cpus()[0].cpu_, first);
+    CHECK_EQ(topo.defaultThreadSize(), 1u);
+}
+
+int main() {
+    RUN_TEST(testParseCpuList);
+    RUN_TEST(testSysfsTopology);
+    RUN_TEST(testCgroupV2);
+    RUN_TEST(testCgroupV2Namespace);
+    RUN_TEST(testCgroupV1);
+    RUN_TEST(testCgroupV1Fallback);
+    RUN_TEST(testNoCgroup);
+    RUN_TEST(testDetectAffinity);
+    return 0;
+}
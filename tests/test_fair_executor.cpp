@@ -0,0 +1,206 @@
+// 公平共享  按权重分配执行时间、并发上限、调整上限、submitTask的结果和统计
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "fair_executor.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+// 忙等一段时间，使每个任务的执行时间大致相同
+static void spin(std::chrono::microseconds d) {
+    auto end = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// 占住唯一的工作线程，令随后的调度作业留在队列中
+static void blockWorker(ThreadPool& pool, std::atomic_bool& started, std::atomic_bool& release) {
+    pool.submitTask([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+}
+
+static void testWeights() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    blockWorker(pool, started, release);
+
+    // 两个租户同时积压相同开销的任务，单个工作线程按3:1的比例执行
+    std::vector<int> order;
+    std::mutex mutex;
+    {
+        FairExecutor fair(pool);
+        SubExecutor& a = fair.addExecutor(3);
+        SubExecutor& b = fair.addExecutor(1);
+        for (int i = 0; i < 200; i++) {
+            for (int tenant = 0; tenant < 2; tenant++) {
+                (tenant == 0 ? a : b).post([&, tenant]() {
+                    spin(200us);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    order.push_back(tenant);
+                });
+            }
+        }
+        // 只由工作线程执行，析构之前不帮忙执行
+        release = true;
+        CHECK(waitUntil([&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return order.size() == 400;
+        }));
+    }
+    long first = std::count(order.begin(), order.begin() + 100, 0);
+    CHECK(first >= 60 && first <= 90);
+}
+
+static void testLateTenant() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    // 一个租户积压大量任务时，后来的租户不需要排在它的全部任务之后
+    std::atomic<int> heavyDone(0);
+    std::atomic<int> heavyAtLight(-1);
+    FairExecutor fair(pool);
+    SubExecutor& heavy = fair.addExecutor(1);
+    SubExecutor& light = fair.addExecutor(1);
+    for (int i = 0; i < 200; i++) {
+        heavy.post([&]() {
+            spin(100us);
+            heavyDone++;
+        });
+    }
+    CHECK(waitUntil([&]() { return heavyDone.load() > 0; }));
+    light.post([&]() { heavyAtLight = heavyDone.load(); });
+    CHECK(waitUntil([&]() { return heavyAtLight.load() >= 0; }));
+    CHECK(heavyAtLight.load() < 150);
+}
+
+static void testMaxConcurrency() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    std::atomic<int> done(0);
+    auto task = [&]() {
+        int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(2ms);
+        running--;
+        done++;
+    };
+
+    FairExecutor fair(pool);
+    SubExecutor& capped = fair.addExecutor(1, 2);
+    SubExecutor& other = fair.addExecutor(1);
+    for (int i = 0; i < 30; i++) {
+        capped.post(task);
+    }
+    // 达到上限的租户不占住其他租户的线程
+    auto f = other.submitTask([]() { return 7; });
+    CHECK_EQ(f.get(), 7);
+    CHECK(waitUntil([&]() { return done.load() == 30; }));
+    CHECK(peak.load() <= 2);
+
+    SubExecutorStats stats = capped.stats();
+    CHECK_EQ(stats.maxConcurrency_, 2u);
+    CHECK_EQ(stats.tasks_.tasksExecuted_, 30u);
+    CHECK_EQ(stats.queued_, 0u);
+    CHECK(stats.queueHighWater_ >= 20);
+    CHECK_EQ(fair.stats().size(), 2u);
+    CHECK_EQ(fair.stats()[1].tasks_.tasksExecuted_, 1u);
+}
+
+static void testRaiseConcurrency() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+
+    // 上限为1时积压的任务逐个执行，提高上限后被推迟的调度作业继续执行
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    std::atomic<int> done(0);
+    std::atomic_bool release(false);
+    FairExecutor fair(pool);
+    SubExecutor& e = fair.addExecutor(1, 1);
+    for (int i = 0; i < 8; i++) {
+        e.post([&]() {
+            int now = ++running;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+            }
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+            running--;
+            done++;
+        });
+    }
+    std::this_thread::sleep_for(20ms);
+    CHECK_EQ(peak.load(), 1);
+    e.setMaxConcurrency(3);
+    CHECK(waitUntil([&]() { return running.load() >= 2; }));
+    release = true;
+    CHECK(waitUntil([&]() { return done.load() == 8; }));
+    CHECK(peak.load() <= 3);
+}
+
+static void testSubmitTask() {
+    ThreadPool pool;
+    pool.start(2);
+    FairExecutor fair(pool);
+    SubExecutor& e = fair.addExecutor(2);
+    auto value = e.submitTask([](int x, int y) { return x * y; }, 6, 7);
+    auto error = e.submitTask([]() -> int { throw std::runtime_error("fail"); });
+    CHECK_EQ(value.get(), 42);
+    CHECK_THROWS(error.get(), std::runtime_error);
+    e.setWeight(5);
+    CHECK_EQ(e.stats().weight_, 5u);
+}
+
+static void testThrowingTask() {
+    // 线程池没有启动时调度作业在提交者的线程中执行，任务的异常传给post的调用者
+    ThreadPool pool;
+    std::atomic<int> done(0);
+    {
+        FairExecutor fair(pool);
+        SubExecutor& e = fair.addExecutor(1, 1);
+        CHECK_THROWS(e.post([&]() {
+            // 达到并发上限，这个任务的调度作业被推迟，抛出异常之后另行提交
+            e.post([&]() { done++; });
+            throw std::runtime_error("fail");
+        }), std::runtime_error);
+        CHECK_EQ(done.load(), 1);
+        CHECK_EQ(e.stats().running_, size_t(0));
+        e.post([&]() { done++; });
+        CHECK_EQ(done.load(), 2);
+    }  // 计数已经归零，析构不会卡住
+}
+
+int main() {
+    RUN_TEST(testWeights);
+    RUN_TEST(testLateTenant);
+    RUN_TEST(testMaxConcurrency);
+    RUN_TEST(testRaiseConcurrency);
+    RUN_TEST(testSubmitTask);
+    RUN_TEST(testThrowingTask);
+    return 0;
+}
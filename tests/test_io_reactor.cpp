@@ -0,0 +1,312 @@
+// I/O反应器  两种后端的等待就绪、读写(管道、socket、普通文件)、协程、cancel(fd)和带着未完成操作析构
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "threadpool_final.h"
+#include "io_reactor.h"
+#include "coro_task.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const IoBackend BACKENDS[] = { IoBackend::Backend_Epoll, IoBackend::Backend_Uring };
+
+// 回调的结果，NONE表示尚未完成
+struct Outcome {
+    static constexpr ssize_t NONE = -1000000;
+    std::atomic<ssize_t> value{NONE};
+
+    auto callback() {
+        return [this](ssize_t n) { value = n; };
+    }
+
+    bool wait() {
+        return waitUntil([&]() { return value.load() != NONE; });
+    }
+};
+
+static void closeAll(std::initializer_list<int> fds) {
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+static void testBackend() {
+    ThreadPool pool;
+    pool.start(2);
+    {
+        IoReactor io(pool, IoBackend::Backend_Epoll);
+        CHECK(io.backend() == IoBackend::Backend_Epoll);
+    }
+    {
+        // io_uring不可用时退回epoll
+        IoReactor io(pool, IoBackend::Backend_Uring);
+        CHECK(io.backend() == IoBackend::Backend_Uring || io.backend() == IoBackend::Backend_Epoll);
+    }
+}
+
+static void testReadableWritable() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        IoReactor io(pool, backend);
+        int fds[2];
+        CHECK(::pipe(fds) == 0);
+
+        // 管道的写端立即可写；读端在写入数据之后才可读
+        Outcome writable;
+        Outcome readable;
+        io.onWritable(fds[1], writable.callback());
+        io.onReadable(fds[0], readable.callback());
+        CHECK(writable.wait());
+        CHECK(writable.value.load() & EPOLLOUT);
+        std::this_thread::sleep_for(10ms);
+        CHECK_EQ(readable.value.load(), Outcome::NONE);
+        CHECK(::write(fds[1], "x", 1) == 1);
+        CHECK(readable.wait());
+        CHECK(readable.value.load() & EPOLLIN);
+
+        // 对端关闭也使读端就绪
+        char c;
+        CHECK(::read(fds[0], &c, 1) == 1);
+        Outcome hangup;
+        io.onReadable(fds[0], hangup.callback());
+        ::close(fds[1]);
+        CHECK(hangup.wait());
+        CHECK(hangup.value.load() & (EPOLLHUP | EPOLLRDHUP));
+        io.cancel(fds[0]);
+        ::close(fds[0]);
+    }
+}
+
+static void testReadWriteSocket() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        IoReactor io(pool, backend);
+        int sv[2];
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+        // 先开始读取，数据稍后到达
+        char buf[16] = {};
+        Outcome read;
+        io.read(sv[1], buf, sizeof(buf), -1, read.callback());
+        std::this_thread::sleep_for(10ms);
+        CHECK_EQ(read.value.load(), Outcome::NONE);
+
+        Outcome written;
+        io.write(sv[0], "hello", 5, -1, written.callback());
+        CHECK(written.wait());
+        CHECK_EQ(written.value.load(), 5);
+        CHECK(read.wait());
+        CHECK_EQ(read.value.load(), 5);
+        CHECK(std::memcmp(buf, "hello", 5) == 0);
+
+        // 对端关闭后读到文件结束
+        ::close(sv[0]);
+        Outcome eof;
+        io.read(sv[1], buf, sizeof(buf), -1, eof.callback());
+        CHECK(eof.wait());
+        CHECK_EQ(eof.value.load(), 0);
+        io.cancel(sv[0]);
+        io.cancel(sv[1]);
+        ::close(sv[1]);
+    }
+}
+
+static void testReadWriteFile() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        IoReactor io(pool, backend);
+        char path[] = "/tmp/test_io_reactorXXXXXX";
+        int fd = ::mkstemp(path);
+        CHECK(fd >= 0);
+        ::unlink(path);
+
+        // 普通文件按偏移读写，epoll后端直接在工作线程中执行
+        Outcome written;
+        io.write(fd, "abcdef", 6, 0, written.callback());
+        CHECK(written.wait());
+        CHECK_EQ(written.value.load(), 6);
+        char buf[4] = {};
+        Outcome read;
+        io.read(fd, buf, 3, 2, read.callback());
+        CHECK(read.wait());
+        CHECK_EQ(read.value.load(), 3);
+        CHECK(std::string(buf) == "cde");
+
+        // 失败时为-errno
+        Outcome failed;
+        io.read(-1, buf, 1, 0, failed.callback());
+        CHECK(failed.wait());
+        CHECK_EQ(failed.value.load(), -EBADF);
+        ::close(fd);
+    }
+}
+
+static CoTask<ssize_t> echo(IoReactor& io, int in, int out) {
+    char buf[32];
+    ssize_t n = co_await io.asyncRead(in, buf, sizeof(buf));
+    if (n <= 0) {
+        co_return n;
+    }
+    co_return co_await io.asyncWrite(out, buf, n);
+}
+
+static void testCoroutine() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        IoReactor io(pool, backend);
+        int a[2];
+        int b[2];
+        CHECK(::pipe(a) == 0 && ::pipe(b) == 0);
+        CHECK(::write(a[1], "ping", 4) == 4);
+        CHECK_EQ(syncWait(echo(io, a[0], b[1])), 4);
+        char buf[8] = {};
+        CHECK(::read(b[0], buf, sizeof(buf)) == 4);
+        CHECK(std::string(buf) == "ping");
+
+        auto wait = [](IoReactor& io, int fd) -> CoTask<ssize_t> {
+            co_return co_await io.writable(fd);
+        };
+        CHECK(syncWait(wait(io, b[1])) & EPOLLOUT);
+        for (int fd : { a[0], a[1], b[0], b[1] }) {
+            io.cancel(fd);
+        }
+        closeAll({ a[0], a[1], b[0], b[1] });
+    }
+}
+
+static void testCancel() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        IoReactor io(pool, backend);
+        int fds[2];
+        CHECK(::pipe(fds) == 0);
+
+        // 空管道上的读取和等待就绪不会完成，取消后得到-ECANCELED
+        char buf[8];
+        Outcome read;
+        Outcome readable;
+        io.read(fds[0], buf, sizeof(buf), -1, read.callback());
+        io.onReadable(fds[0], readable.callback());
+        std::this_thread::sleep_for(10ms);
+        CHECK_EQ(io.pending(), 2u);
+        io.cancel(fds[0]);
+        CHECK(read.wait());
+        CHECK(readable.wait());
+        CHECK_EQ(read.value.load(), -ECANCELED);
+        CHECK_EQ(readable.value.load(), -ECANCELED);
+        CHECK(waitUntil([&]() { return io.pending() == 0; }));
+
+        // 取消之后fd可以继续使用
+        Outcome again;
+        io.read(fds[0], buf, sizeof(buf), -1, again.callback());
+        CHECK(::write(fds[1], "ok", 2) == 2);
+        CHECK(again.wait());
+        CHECK_EQ(again.value.load(), 2);
+        io.cancel(fds[0]);
+        closeAll({ fds[0], fds[1] });
+    }
+}
+
+static void testCancelManyOps() {
+    // 提交队列只有2项、完成队列只有4项，取消请求多于队列的空位，暂缓后重新提交
+    ThreadPool pool;
+    pool.start(2);
+    IoReactor io(pool, IoBackend::Backend_Uring, 2);
+    const int PIPES = 16;
+    std::vector<int> fds(PIPES * 2);
+    std::vector<Outcome> reads(PIPES);
+    char buf[PIPES];
+    for (int i = 0; i < PIPES; i++) {
+        CHECK(::pipe(&fds[i * 2]) == 0);
+        io.read(fds[i * 2], &buf[i], 1, -1, reads[i].callback());
+    }
+    std::this_thread::sleep_for(10ms);
+    for (int i = 0; i < PIPES; i++) {
+        io.cancel(fds[i * 2]);
+    }
+    for (int i = 0; i < PIPES; i++) {
+        CHECK(reads[i].wait());
+        CHECK_EQ(reads[i].value.load(), -ECANCELED);
+    }
+    CHECK(waitUntil([&]() { return io.pending() == 0; }));
+    for (int fd : fds) {
+        ::close(fd);
+    }
+}
+
+static void testDestroyWithPendingOps() {
+    for (IoBackend backend : BACKENDS) {
+        ThreadPool pool;
+        pool.start(2);
+        int fds[2];
+        int sv[2];
+        CHECK(::pipe(fds) == 0);
+        CHECK(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+        // 析构时取消所有未完成的操作，回调在析构返回前或随后在线程池中以-ECANCELED执行
+        std::vector<Outcome> outcomes(4);
+        char buf[2][8];
+        {
+            IoReactor io(pool, backend, 4);
+            io.read(fds[0], buf[0], sizeof(buf[0]), -1, outcomes[0].callback());
+            io.onReadable(fds[0], outcomes[1].callback());
+            io.read(sv[0], buf[1], sizeof(buf[1]), -1, outcomes[2].callback());
+            io.onReadable(sv[1], outcomes[3].callback());
+            std::this_thread::sleep_for(10ms);
+        }
+        for (Outcome& outcome : outcomes) {
+            CHECK(outcome.wait());
+            CHECK_EQ(outcome.value.load(), -ECANCELED);
+        }
+        closeAll({ fds[0], fds[1], sv[0], sv[1] });
+    }
+}
+
+static void testDestroyAfterLastOp() {
+    // 最后一个操作在通知之后才允许析构，反复创建和销毁
+    ThreadPool pool;
+    pool.start(2);
+    int fds[2];
+    CHECK(::pipe(fds) == 0);
+    for (int i = 0; i < 200; i++) {
+        std::atomic<int> done(0);
+        {
+            IoReactor io(pool, i % 2 == 0 ? IoBackend::Backend_Epoll : IoBackend::Backend_Uring);
+            CHECK(::write(fds[1], "x", 1) == 1);
+            char c;
+            io.read(fds[0], &c, 1, -1, [&](ssize_t) { done++; });
+            io.onWritable(fds[1], [&](ssize_t) { done++; });
+            CHECK(waitUntil([&]() { return done.load() == 2; }));
+            io.cancel(fds[0]);
+            io.cancel(fds[1]);
+        }
+    }
+    closeAll({ fds[0], fds[1] });
+}
+
+int main() {
+    RUN_TEST(testBackend);
+    RUN_TEST(testReadableWritable);
+    RUN_TEST(testReadWriteSocket);
+    RUN_TEST(testReadWriteFile);
+    RUN_TEST(testCoroutine);
+    RUN_TEST(testCancel);
+    RUN_TEST(testCancelManyOps);
+    RUN_TEST(testDestroyWithPendingOps);
+    RUN_TEST(testDestroyAfterLastOp);
+    return 0;
+}
@@ -0,0 +1,212 @@
+// Task/Result接口的基本测试  提交、批量提交、延续任务、协程等待、拒绝和取消
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "threadpool.h"
+#include "coro_task.h"
+#include "test_util.h"
+
+class SumTask : public Task {
+public:
+    SumTask(int begin, int end) : begin_(begin), end_(end) {}
+
+    Any run() {
+        long sum = 0;
+        for (int i = begin_; i <= end_; i++) {
+            sum += i;
+        }
+        return sum;
+    }
+
+private:
+    int begin_;
+    int end_;
+};
+
+static void testSubmit() {
+    for (QueueMode queueMode : { QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree }) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.start(4);
+
+        std::vector<Result> results;
+        for (int i = 0; i < 100; i++) {
+            results.push_back(pool.submitTask(makeTask<SumTask>(1, i)));
+        }
+        for (int i = 0; i < 100; i++) {
+            CHECK_EQ(results[i].get().cast_<long>(), long(i) * (i + 1) / 2);
+        }
+    }
+}
+
+static void testSubmitBatch() {
+    ThreadPool pool;
+    pool.start(2);
+    std::vector<std::shared_ptr<Task>> tasks;
+    for (int i = 0; i < 50; i++) {
+        tasks.push_back(makeTask<SumTask>(i, i));
+    }
+    std::vector<Result> results = pool.submitBatch(tasks);
+    for (int i = 0; i < 50; i++) {
+        CHECK_EQ(results[i].get().cast_<long>(), long(i));
+    }
+}
+
+static void testThen() {
+    ThreadPool pool;
+    pool.start(2);
+    Result res = pool.submitTask(makeTask<SumTask>(1, 10))
+        .then([](Any any) { return Any(any.cast_<long>() * 2); });
+    CHECK_EQ(res.get().cast_<long>(), 110L);
+
+    // 返回值已就绪后注册的延续任务立即提交；延续任务可以继续串联
+    Result ready = pool.submitTask(makeTask<SumTask>(1, 3));
+    CHECK(waitUntil([&]() { return ready.ready(); }));
+    Result chained = ready.then([](Any any) { return Any(any.cast_<long>() + 1); })
+        .then([](Any any) { return Any(any.cast_<long>() * 10); });
+    CHECK_EQ(chained.get().cast_<long>(), 70L);
+
+    // 返回值只能交给一个延续任务，第二次注册被拒绝，func不执行
+    std::atomic<int> calls(0);
+    Result source = pool.submitTask(makeTask<SumTask>(1, 4));
+    Result first = source.then([&](Any any) { calls++; return Any(any.cast_<long>()); });
+    Result second = source.then([&](Any any) { calls++; return any; });
+    CHECK(second.rejected());
+    CHECK(second.get().empty());
+    CHECK_EQ(first.get().cast_<long>(), 10L);
+    CHECK_EQ(calls.load(), 1);
+
+    // 提交时被拒绝的Result注册延续任务同样被拒绝
+    pool.shutdown();
+    Result rejected = pool.submitTask(makeTask<SumTask>(1, 1));
+    CHECK(rejected.rejected());
+    Result after = rejected.then([&](Any any) { calls++; return any; });
+    CHECK(after.rejected());
+    CHECK_EQ(calls.load(), 1);
+}
+
+static CoTask<long> addResults(ThreadPool& pool) {
+    long a = (co_await pool.submitTask(makeTask<SumTask>(1, 4))).cast_<long>();
+    long b = (co_await pool.submitTask(makeTask<SumTask>(1, 5))).cast_<long>();
+    co_return a + b;
+}
+
+// 返回值已交给then注册的延续任务，co_await不挂起，结果为空
+static CoTask<bool> awaitAfterThen(ThreadPool& pool, std::atomic_int& calls) {
+    Result res = pool.submitTask(makeTask<SumTask>(1, 3));
+    res.then([&](Any any) { calls += any.cast_<long>(); return Any(); });
+    Any any = co_await res;
+    co_return any.empty();
+}
+
+static void testCoAwait() {
+    ThreadPool pool;
+    pool.start(2);
+    CHECK_EQ(syncWait(addResults(pool)), 25L);
+
+    std::atomic_int calls(0);
+    CHECK(syncWait(awaitAfterThen(pool, calls)));
+    CHECK(waitUntil([&]() { return calls.load() == 6; }));
+}
+
+// 占住工作线程直到opened_为true
+class GateTask : public Task {
+public:
+    GateTask(std::atomic_bool& started, std::atomic_bool& opened) : started_(started), opened_(opened) {}
+
+    Any run() {
+        started_ = true;
+        while (!opened_) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return 0;
+    }
+
+private:
+    std::atomic_bool& started_;
+    std::atomic_bool& opened_;
+};
+
+static void testRejected() {
+    for (OverloadPolicy policy : { OverloadPolicy::Overload_Fail, OverloadPolicy::Overload_DropOldest }) {
+        ThreadPool pool;
+        pool.setTaskQueThreshold(2);
+        pool.setOverloadPolicy(policy);
+        pool.start(1);
+        std::atomic_bool started(false);
+        std::atomic_bool opened(false);
+        pool.submitTask(makeTask<GateTask>(started, opened));
+        CHECK(waitUntil([&]() { return started.load(); }));
+
+        // Fail拒绝新任务，DropOldest丢弃最早的任务；被拒绝的任务get()返回空的Any
+        Result a = pool.submitTask(makeTask<SumTask>(1, 1));
+        Result b = pool.submitTask(makeTask<SumTask>(1, 2));
+        Result c = pool.submitTask(makeTask<SumTask>(1, 3));
+        Result& lost = policy == OverloadPolicy::Overload_Fail ? c : a;
+        Result& kept = policy == OverloadPolicy::Overload_Fail ? a : c;
+        CHECK(lost.rejected());
+        CHECK(!kept.rejected());
+        CHECK(!b.rejected());
+
+        opened = true;
+        CHECK_EQ(b.get().cast_<long>(), 3L);
+        CHECK_EQ(kept.get().cast_<long>(), policy == OverloadPolicy::Overload_Fail ? 1L : 6L);
+        CHECK(lost.get().empty());
+        pool.shutdown();
+        CHECK(pool.submitTask(makeTask<SumTask>(1, 4)).rejected());
+    }
+}
+
+// 执行中轮询令牌，取消后提前结束
+class PollTask : public Task {
+public:
+    explicit PollTask(std::atomic_bool& started) : started_(started) {}
+
+    Any run() {
+        started_ = true;
+        for (;;) {
+            throwIfCancelled();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+private:
+    std::atomic_bool& started_;
+};
+
+static void testCancelled() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    // 执行中的任务调用throwIfCancelled()结束，队列中的任务取出时不再执行
+    CancellationSource source;
+    std::atomic_bool started(false);
+    Result running = pool.submitTask(makeTask<PollTask>(started), source.token());
+    CHECK(waitUntil([&]() { return started.load(); }));
+    CancellationSource child(source.token());
+    Result queued = pool.submitTask(makeTask<SumTask>(1, 2), child.token());
+    Result plain = pool.submitTask(makeTask<SumTask>(1, 3));
+    source.cancel();
+
+    CHECK(running.get().empty());
+    CHECK(running.cancelled());
+    CHECK(queued.get().empty());
+    CHECK(queued.cancelled());
+    CHECK(!queued.rejected());
+    CHECK_EQ(plain.get().cast_<long>(), 6L);
+    CHECK(!plain.cancelled());
+}
+
+int main() {
+    RUN_TEST(testSubmit);
+    RUN_TEST(testSubmitBatch);
+    RUN_TEST(testThen);
+    RUN_TEST(testCoAwait);
+    RUN_TEST(testRejected);
+    RUN_TEST(testCancelled);
+    return 0;
+}
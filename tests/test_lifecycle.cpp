@@ -0,0 +1,228 @@
+// 运行时调整线程数量、暂停/恢复和关闭(Shutdown_Drain/Shutdown_Discard/超时)
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "parallel.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+static void testResize() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setThreadSizeThreshold(8);
+        pool.start(2);
+        CHECK_EQ(pool.threadSize(), 2u);
+
+        pool.resize(6);
+        CHECK_EQ(pool.threadSize(), 6u);
+        // 不超过线程数量上限
+        pool.resize(100);
+        CHECK_EQ(pool.threadSize(), 8u);
+
+        std::atomic<int> done(0);
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 200; i++) {
+            futures.push_back(pool.submitTask([&]() { done++; }));
+        }
+        // 减少时多余的线程执行完当前任务后退出，队列中的任务仍然全部执行
+        pool.resize(1);
+        for (auto& f : futures) {
+            f.get();
+        }
+        CHECK_EQ(done.load(), 200);
+        CHECK(waitUntil([&]() { return pool.threadSize() == 1; }));
+        CHECK_EQ(pool.submitTask([]() { return 3; }).get(), 3);
+    }
+}
+
+static void testResizeFromWorker() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.setTaskQueThreshold(1024);
+    pool.setThreadSizeThreshold(4);
+    pool.start(4);
+
+    // 工作线程的本地队列中还有任务时缩减，本地队列中的任务转入全局队列
+    std::atomic<int> done(0);
+    auto f = pool.submitTask([&]() {
+        for (int i = 0; i < 100; i++) {
+            pool.submitTask([&]() { done++; });
+        }
+        pool.resize(1);
+    });
+    f.get();
+    CHECK(waitUntil([&]() { return done.load() == 100; }));
+    CHECK(waitUntil([&]() { return pool.threadSize() == 1; }));
+}
+
+static void testConcurrentResize() {
+    // 多个线程同时resize，同时提交任务；线程的启动与join已退出的线程不会交错
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.setTaskQueThreshold(1024);
+    pool.setThreadSizeThreshold(8);
+    pool.start(2);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> resizers;
+    for (int t = 0; t < 3; t++) {
+        resizers.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            while (!stop) {
+                pool.resize(1 + rng() % 8);
+                std::this_thread::yield();
+            }
+        });
+    }
+    std::atomic<int> done(0);
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 2000; i++) {
+        futures.push_back(pool.submitTask([&]() { done++; }));
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
+    stop = true;
+    for (auto& t : resizers) {
+        t.join();
+    }
+    CHECK_EQ(done.load(), 2000);
+
+    pool.resize(3);
+    CHECK(waitUntil([&]() { return pool.threadSize() == 3; }));
+}
+
+static void testPauseResume() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(2);
+
+        pool.pause();
+        std::atomic<int> done(0);
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 50; i++) {
+            futures.push_back(pool.submitTask([&]() { done++; }));
+        }
+        std::this_thread::sleep_for(50ms);
+        CHECK_EQ(done.load(), 0);
+
+        // 辅助组件的作业在调用线程中执行，不会等到resume
+        std::atomic<int> n(0);
+        parallel_for(pool, 0, 100, [&](size_t) { n++; }, 1);
+        CHECK_EQ(n.load(), 100);
+        CHECK_EQ(done.load(), 0);
+
+        pool.resume();
+        for (auto& f : futures) {
+            f.get();
+        }
+        CHECK_EQ(done.load(), 50);
+    }
+}
+
+static void testShutdownDrain() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        std::atomic<int> done(0);
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(2);
+        for (int i = 0; i < 100; i++) {
+            pool.submitTask([&]() { done++; });
+        }
+        CHECK(pool.shutdown(ShutdownMode::Shutdown_Drain).empty());
+        CHECK_EQ(done.load(), 100);
+
+        // 关闭后提交失败，重复关闭返回空
+        auto f = pool.submitTask([]() { return 1; });
+        CHECK_THROWS(f.get(), TaskRejected);
+        CHECK(!pool.trySubmit([]() { return 1; }).has_value());
+        CHECK(pool.shutdown(ShutdownMode::Shutdown_Discard).empty());
+    }
+}
+
+static void testShutdownDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(1);
+
+        // 唯一的线程被占住，其余任务留在队列中
+        std::atomic<bool> started(false), release(false);
+        auto busy = pool.submitTask([&]() {
+            started = true;
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+            return 1;
+        });
+        CHECK(waitUntil([&]() { return started.load(); }));
+
+        std::atomic<int> done(0);
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 20; i++) {
+            futures.push_back(pool.submitTask([&]() { done++; }));
+        }
+        std::thread releaser([&]() {
+            std::this_thread::sleep_for(30ms);
+            release = true;
+        });
+        std::vector<ThreadPool::Job> discarded = pool.shutdown(ShutdownMode::Shutdown_Discard);
+        releaser.join();
+
+        // 正在执行的任务正常完成，队列中的任务交还给调用者，销毁后future得到TaskRejected
+        CHECK_EQ(busy.get(), 1);
+        CHECK_EQ(discarded.size(), 20u);
+        CHECK_EQ(done.load(), 0);
+        discarded.clear();
+        for (auto& f : futures) {
+            CHECK_THROWS(f.get(), TaskRejected);
+        }
+    }
+}
+
+static void testShutdownTimeout() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    std::atomic<int> done(0);
+    for (int i = 0; i < 100; i++) {
+        pool.submitTask([&]() {
+            std::this_thread::sleep_for(5ms);
+            done++;
+        });
+    }
+    // 超时后剩余的任务不再执行，耗时不超过timeout加上一个任务
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<ThreadPool::Job> discarded = pool.shutdown(ShutdownMode::Shutdown_Drain, 50ms);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    CHECK(elapsed < 1s);
+    CHECK(!discarded.empty());
+    CHECK_EQ(done.load() + int(discarded.size()), 100);
+}
+
+int main() {
+    RUN_TEST(testResize);
+    RUN_TEST(testResizeFromWorker);
+    RUN_TEST(testConcurrentResize);
+    RUN_TEST(testPauseResume);
+    RUN_TEST(testShutdownDrain);
+    RUN_TEST(testShutdownDiscard);
+    RUN_TEST(testShutdownTimeout);
+    return 0;
+}
@@ -0,0 +1,617 @@
+// 过载策略(Block/Fail/CallerRuns/DropOldest)、trySubmit和Shutdown_Discard；
+// 辅助组件(任务组、并行算法、任务图、strand、公平调度、I/O反应器、定时器)的作业不会被丢弃
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "threadpool_final.h"
+#include "task_group.h"
+#include "task_graph.h"
+#include "parallel.h"
+#include "strand.h"
+#include "fair_executor.h"
+#include "io_reactor.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+// 占住一个工作线程直到open()，使后续任务留在队列中
+struct Gate {
+    std::atomic_bool started{false};
+    std::atomic_bool opened{false};
+
+    void block(ThreadPool& pool) {
+        pool.submitTask([this]() {
+            started = true;
+            while (!opened) {
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+        CHECK(waitUntil([&]() { return started.load(); }));
+    }
+
+    void open() {
+        opened = true;
+    }
+};
+
+// 提交n个空任务，Overload_DropOldest下把队列中的其他任务挤出去
+static void flood(ThreadPool& pool, int n) {
+    for (int i = 0; i < n; i++) {
+        pool.submitTask([]() {});
+    }
+}
+
+static void startPool(ThreadPool& pool, QueueMode queueMode, size_t threshold, OverloadPolicy policy) {
+    pool.setQueueMode(queueMode);
+    pool.setTaskQueThreshold(threshold);
+    pool.setOverloadPolicy(policy, 20ms);
+    pool.start(1);
+}
+
+static void testBlockTimeout() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+        auto a = pool.submitTask([]() { return 1; });
+        auto b = pool.submitTask([]() { return 2; });
+
+        // 队列已满，等待blockTime后拒绝
+        auto start = std::chrono::steady_clock::now();
+        auto c = pool.submitTask([]() { return 3; });
+        CHECK(std::chrono::steady_clock::now() - start >= 15ms);
+        CHECK_THROWS(c.get(), TaskRejected);
+        CHECK_EQ(pool.stats().submitTimeouts_, 1u);
+
+        gate.open();
+        CHECK_EQ(a.get() + b.get(), 3);
+    }
+}
+
+static void testFail() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_Fail);
+        Gate gate;
+        gate.block(pool);
+        auto a = pool.submitTask([]() { return 1; });
+        auto b = pool.submitTask([]() { return 2; });
+        auto c = pool.submitTask([]() { return 3; });
+        CHECK_THROWS(c.get(), TaskRejected);
+        CHECK_EQ(pool.stats().submitRejected_, 1u);
+        CHECK_EQ(pool.stats().submitTimeouts_, 0u);
+
+        gate.open();
+        CHECK_EQ(a.get() + b.get(), 3);
+    }
+}
+
+static void testCallerRuns() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_CallerRuns);
+        Gate gate;
+        gate.block(pool);
+        pool.submitTask([]() {});
+        pool.submitTask([]() {});
+
+        // 队列已满，在提交者的线程中执行
+        auto f = pool.submitTask([]() { return std::this_thread::get_id(); });
+        CHECK(f.wait_for(0ms) == std::future_status::ready);
+        CHECK(f.get() == std::this_thread::get_id());
+        CHECK_EQ(pool.stats().callerRuns_, 1u);
+        gate.open();
+    }
+}
+
+static void testDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+        auto a = pool.submitTask([]() { return 1; });
+        auto b = pool.submitTask([]() { return 2; });
+        auto c = pool.submitTask([]() { return 3; });
+
+        // 最早的任务被丢弃，新任务进入队列
+        CHECK_THROWS(a.get(), TaskRejected);
+        CHECK_EQ(pool.stats().tasksDropped_, 1u);
+        gate.open();
+        CHECK_EQ(b.get() + c.get(), 5);
+    }
+}
+
+static void testTrySubmit() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+        auto a = pool.trySubmit([]() { return 1; });
+        auto b = pool.trySubmit([]() { return 2; });
+        CHECK(a.has_value() && b.has_value());
+
+        // 队列已满时不等待blockTime，直接返回空值
+        auto start = std::chrono::steady_clock::now();
+        CHECK(!pool.trySubmit([]() { return 3; }).has_value());
+        CHECK(std::chrono::steady_clock::now() - start < 15ms);
+        CHECK_EQ(pool.stats().submitTimeouts_, 0u);
+
+        gate.open();
+        CHECK_EQ(a->get() + b->get(), 3);
+        pool.shutdown();
+        CHECK(!pool.trySubmit([]() { return 4; }).has_value());
+    }
+}
+
+// 线程池内部线程提交的任务(工作窃取模式下放入本地队列)同样受任务队列上限和过载策略限制
+static void testWorkerSubmit() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 2, OverloadPolicy::Overload_Fail);
+        std::vector<std::future<int>> inner;
+        pool.submitTask([&]() {
+            for (int i = 0; i < 4; i++) {
+                inner.push_back(pool.submitTask([i]() { return i; }));
+            }
+            std::vector<std::function<int()>> batch(3, []() { return 10; });
+            for (auto& f : pool.submitBatch(batch.begin(), batch.end())) {
+                inner.push_back(std::move(f));
+            }
+        }).get();
+
+        int sum = 0;
+        int rejected = 0;
+        for (auto& f : inner) {
+            try {
+                sum += f.get();
+            } catch (const TaskRejected&) {
+                rejected++;
+            }
+        }
+        CHECK_EQ(sum, 1);
+        CHECK_EQ(rejected, 5);
+        CHECK_EQ(pool.stats().submitRejected_, 5u);
+        CHECK(pool.stats().queueHighWater_ <= 2);
+    }
+}
+
+// 工作线程从全局队列顺带取走放入本地队列的任务仍计入上限
+static void testBatchedTasksCounted() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_Global);
+    pool.setTaskQueThreshold(4);
+    pool.setOverloadPolicy(OverloadPolicy::Overload_Fail);
+
+    // 启动前放入的任务由唯一的线程一次取走，阻塞任务之后的3个进入该线程的本地队列
+    Gate gate;
+    pool.submitTask([&]() {
+        gate.started = true;
+        while (!gate.opened) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    std::vector<std::future<void>> queued;
+    for (int i = 0; i < 3; i++) {
+        queued.push_back(pool.submitTask([]() {}));
+    }
+    pool.start(1);
+    CHECK(waitUntil([&]() { return gate.started.load(); }));
+
+    auto a = pool.submitTask([]() {});
+    auto b = pool.submitTask([]() {});
+    CHECK(b.wait_for(0ms) == std::future_status::ready);
+    CHECK_THROWS(b.get(), TaskRejected);
+    CHECK_EQ(pool.stats().taskSize_, size_t(4));
+    gate.open();
+    a.get();
+    for (auto& f : queued) {
+        f.get();
+    }
+}
+
+// 以下各组件的作业在队列中等待时被大量新任务挤压，作业不会被丢弃，组件等待的计数能够归零
+
+static void testTaskGroupDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+
+        std::atomic<int> done(0);
+        TaskGroup g(pool);
+        for (int i = 0; i < 4; i++) {
+            g.run([&]() { done++; });
+        }
+        flood(pool, 64);
+        CHECK(pool.stats().tasksDropped_ > 0);
+        gate.open();
+        g.wait();
+        CHECK_EQ(done.load(), 4);
+    }
+}
+
+static void testParallelDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+
+        // 工作线程被占住，子区间的作业全部留在队列中，每次迭代都挤压队列
+        std::atomic<int> done(0);
+        parallel_for(pool, 0, 64, [&](size_t) {
+            flood(pool, 4);
+            done++;
+        }, 1);
+        CHECK_EQ(done.load(), 64);
+        CHECK(pool.stats().tasksDropped_ > 0);
+        gate.open();
+    }
+}
+
+static void testTaskGraphDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+
+        std::atomic<int> done(0);
+        TaskGraph graph;
+        TaskGraph::NodeId root = graph.addNode([&]() { done++; });
+        TaskGraph::NodeId sink = graph.addNode([&]() { done++; });
+        for (int i = 0; i < 16; i++) {
+            TaskGraph::NodeId node = graph.addNode([&]() {
+                flood(pool, 4);
+                done++;
+            });
+            graph.addEdge(root, node);
+            graph.addEdge(node, sink);
+        }
+        graph.run(pool);
+        CHECK_EQ(done.load(), 18);
+        CHECK(pool.stats().tasksDropped_ > 0);
+        gate.open();
+    }
+}
+
+static void testStrandDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+
+        std::vector<int> order;
+        std::atomic<int> done(0);
+        {
+            Strand strand(pool);
+            StrandMap<int> map(pool);
+            for (int i = 0; i < 8; i++) {
+                strand.post([&, i]() { order.push_back(i); });
+                map.post(i % 4, [&]() { done++; });
+            }
+            flood(pool, 64);
+            CHECK(pool.stats().tasksDropped_ > 0);
+            gate.open();
+            // 析构时等待所有任务执行完
+        }
+        CHECK_EQ(order.size(), 8u);
+        for (int i = 0; i < 8; i++) {
+            CHECK_EQ(order[i], i);
+        }
+        CHECK_EQ(done.load(), 8);
+    }
+}
+
+static void testFairExecutorDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+        Gate gate;
+        gate.block(pool);
+
+        std::atomic<int> done(0);
+        {
+            FairExecutor fair(pool);
+            SubExecutor& a = fair.addExecutor(1);
+            SubExecutor& b = fair.addExecutor(2, 1);
+            // 每个任务一个调度作业，队列中留出被挤压的位置
+            for (int i = 0; i < 3; i++) {
+                a.post([&]() { done++; });
+                b.post([&]() { done++; });
+            }
+            flood(pool, 64);
+            CHECK(pool.stats().tasksDropped_ > 0);
+            gate.open();
+        }
+        CHECK_EQ(done.load(), 6);
+    }
+}
+
+static void testIoReactorDropOldest() {
+    for (IoBackend backend : { IoBackend::Backend_Epoll, IoBackend::Backend_Auto }) {
+        for (QueueMode queueMode : QUEUE_MODES) {
+            ThreadPool pool;
+            startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+            Gate gate;
+            gate.block(pool);
+
+            // 等待就绪和读取用两个管道，io_uring的读取不会先把等待就绪的数据读走
+            int ready[2];
+            int fds[2];
+            CHECK(::pipe(ready) == 0 && ::pipe(fds) == 0);
+            CHECK(::write(ready[1], "a", 1) == 1);
+            CHECK(::write(fds[1], "ab", 2) == 2);
+            std::atomic<int> done(0);
+            std::atomic<ssize_t> bytes(0);
+            char buf[2];
+            {
+                IoReactor io(pool, backend);
+                io.onReadable(ready[0], [&](ssize_t) { done++; });
+                io.read(fds[0], buf, sizeof(buf), -1, [&](ssize_t n) {
+                    bytes = n;
+                    done++;
+                });
+                // 等轮询线程把读写或完成回调放入队列
+                std::this_thread::sleep_for(20ms);
+                flood(pool, 64);
+                CHECK(pool.stats().tasksDropped_ > 0);
+                gate.open();
+                CHECK(waitUntil([&]() { return done.load() == 2; }));
+                CHECK_EQ(bytes.load(), 2);
+                io.cancel(ready[0]);
+                io.cancel(fds[0]);
+            }
+            for (int fd : { ready[0], ready[1], fds[0], fds[1] }) {
+                ::close(fd);
+            }
+        }
+    }
+}
+
+static void testTimerDropOldest() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 8, OverloadPolicy::Overload_DropOldest);
+
+        // 周期任务的下一次执行在队列中被挤出时就不会再安排，持续挤压期间仍应不断触发
+        std::atomic<int> fired(0);
+        TimerHandle timer = pool.submitEvery(1ms, [&]() { fired++; });
+        auto end = std::chrono::steady_clock::now() + 100ms;
+        while (std::chrono::steady_clock::now() < end) {
+            flood(pool, 16);
+            std::this_thread::sleep_for(100us);
+        }
+        int seen = fired.load();
+        CHECK(waitUntil([&]() { return fired.load() >= seen + 3; }));
+        timer.cancel();
+    }
+}
+
+// Shutdown_Discard只返回用户提交的任务，组件的作业仍然执行，等待它们的线程不会永远阻塞
+
+// 在其他线程中关闭线程池，稍后放开工作线程
+static std::vector<ThreadPool::Job> discardLater(ThreadPool& pool, Gate& gate, std::atomic_bool* release = nullptr) {
+    std::thread opener([&]() {
+        std::this_thread::sleep_for(20ms);
+        if (release != nullptr) {
+            *release = true;
+        }
+        gate.open();
+    });
+    std::vector<ThreadPool::Job> discarded = pool.shutdown(ShutdownMode::Shutdown_Discard);
+    opener.join();
+    return discarded;
+}
+
+static void testTaskGroupDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        std::atomic<int> done(0);
+        TaskGroup g(pool);
+        for (int i = 0; i < 4; i++) {
+            g.run([&]() { done++; });
+        }
+        flood(pool, 5);
+        CHECK_EQ(discardLater(pool, gate).size(), 5u);
+        g.wait();
+        CHECK_EQ(done.load(), 4);
+    }
+}
+
+static void testParallelDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        // 调用线程切分出的子区间都在队列中时，它在第一个子区间上等待
+        std::atomic<int> done(0);
+        std::atomic_bool entered(false);
+        std::atomic_bool release(false);
+        std::thread caller([&]() {
+            parallel_for(pool, 0, 16, [&](size_t i) {
+                if (i == 0) {
+                    entered = true;
+                    while (!release) {
+                        std::this_thread::sleep_for(1ms);
+                    }
+                }
+                done++;
+            }, 1);
+        });
+        CHECK(waitUntil([&]() { return entered.load(); }));
+        flood(pool, 5);
+        CHECK_EQ(discardLater(pool, gate, &release).size(), 5u);
+        caller.join();
+        CHECK_EQ(done.load(), 16);
+    }
+}
+
+static void testTaskGraphDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        // 第一个根节点由调用线程取出并等待，其余根节点留在队列中
+        std::atomic<int> done(0);
+        std::atomic_bool entered(false);
+        std::atomic_bool release(false);
+        TaskGraph graph;
+        graph.addNode([&]() {
+            entered = true;
+            while (!release) {
+                std::this_thread::sleep_for(1ms);
+            }
+            done++;
+        });
+        for (int i = 0; i < 4; i++) {
+            graph.addNode([&]() { done++; });
+        }
+        std::thread caller([&]() { graph.run(pool); });
+        CHECK(waitUntil([&]() { return entered.load(); }));
+        flood(pool, 5);
+        CHECK_EQ(discardLater(pool, gate, &release).size(), 5u);
+        caller.join();
+        CHECK_EQ(done.load(), 5);
+    }
+}
+
+static void testStrandDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        std::vector<int> order;
+        std::atomic<int> done(0);
+        {
+            Strand strand(pool);
+            StrandMap<int> map(pool);
+            for (int i = 0; i < 8; i++) {
+                strand.post([&, i]() { order.push_back(i); });
+                map.post(i % 4, [&]() { done++; });
+            }
+            flood(pool, 5);
+            CHECK_EQ(discardLater(pool, gate).size(), 5u);
+        }
+        CHECK_EQ(order.size(), 8u);
+        CHECK_EQ(done.load(), 8);
+    }
+}
+
+static void testFairExecutorDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        std::atomic<int> done(0);
+        {
+            FairExecutor fair(pool);
+            SubExecutor& a = fair.addExecutor(1, 1);
+            for (int i = 0; i < 8; i++) {
+                a.post([&]() { done++; });
+            }
+            flood(pool, 5);
+            CHECK_EQ(discardLater(pool, gate).size(), 5u);
+        }
+        CHECK_EQ(done.load(), 8);
+    }
+}
+
+static void testIoReactorDiscard() {
+    for (IoBackend backend : { IoBackend::Backend_Epoll, IoBackend::Backend_Auto }) {
+        for (QueueMode queueMode : QUEUE_MODES) {
+            ThreadPool pool;
+            startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+            Gate gate;
+            gate.block(pool);
+
+            int fds[2];
+            CHECK(::pipe(fds) == 0);
+            CHECK(::write(fds[1], "ab", 2) == 2);
+            std::atomic<ssize_t> bytes(0);
+            char buf[2];
+            {
+                IoReactor io(pool, backend);
+                io.read(fds[0], buf, sizeof(buf), -1, [&](ssize_t n) { bytes = n; });
+                std::this_thread::sleep_for(20ms);
+                flood(pool, 5);
+                CHECK_EQ(discardLater(pool, gate).size(), 5u);
+                CHECK_EQ(bytes.load(), 2);
+                io.cancel(fds[0]);
+            }
+            ::close(fds[0]);
+            ::close(fds[1]);
+        }
+    }
+}
+
+static void testTimerDiscard() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        startPool(pool, queueMode, 1024, OverloadPolicy::Overload_Block);
+        Gate gate;
+        gate.block(pool);
+
+        // 定时任务不在返回的任务中，Shutdown_Discard之后也不再执行
+        std::atomic<int> fired(0);
+        pool.submitAfter(1ms, [&]() { fired++; });
+        pool.submitEvery(1ms, [&]() { fired++; });
+        pool.submitAfter(1h, [&]() { fired++; });
+        std::this_thread::sleep_for(5ms);
+        flood(pool, 5);
+        CHECK_EQ(discardLater(pool, gate).size(), 5u);
+        CHECK_EQ(fired.load(), 0);
+    }
+}
+
+int main() {
+    RUN_TEST(testBlockTimeout);
+    RUN_TEST(testFail);
+    RUN_TEST(testCallerRuns);
+    RUN_TEST(testDropOldest);
+    RUN_TEST(testTrySubmit);
+    RUN_TEST(testWorkerSubmit);
+    RUN_TEST(testBatchedTasksCounted);
+    RUN_TEST(testTaskGroupDropOldest);
+    RUN_TEST(testParallelDropOldest);
+    RUN_TEST(testTaskGraphDropOldest);
+    RUN_TEST(testStrandDropOldest);
+    RUN_TEST(testFairExecutorDropOldest);
+    RUN_TEST(testIoReactorDropOldest);
+    RUN_TEST(testTimerDropOldest);
+    RUN_TEST(testTaskGroupDiscard);
+    RUN_TEST(testParallelDiscard);
+    RUN_TEST(testTaskGraphDiscard);
+    RUN_TEST(testStrandDiscard);
+    RUN_TEST(testFairExecutorDiscard);
+    RUN_TEST(testIoReactorDiscard);
+    RUN_TEST(testTimerDiscard);
+    return 0;
+}
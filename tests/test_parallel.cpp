@@ -0,0 +1,172 @@
+// parallel_for / parallel_reduce / parallel_scan的结果和异常传递
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "parallel.h"
+#include "test_util.h"
+
+static void testFor() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.start(4);
+
+    std::vector<int> hits(10000, 0);
+    parallel_for(pool, 0, hits.size(), [&](size_t i) { hits[i]++; });
+    for (int h : hits) {
+        CHECK_EQ(h, 1);
+    }
+
+    // 子区间形式，指定粒度
+    std::vector<int> ranges(1000, 0);
+    parallel_for(pool, 0, ranges.size(), [&](size_t b, size_t e) {
+        CHECK(e - b <= 7);
+        for (size_t i = b; i < e; i++) {
+            ranges[i] = int(i);
+        }
+    }, 7);
+    for (size_t i = 0; i < ranges.size(); i++) {
+        CHECK_EQ(ranges[i], int(i));
+    }
+
+    // 空区间不调用func
+    parallel_for(pool, 5, 5, [](size_t) { CHECK(false); });
+}
+
+static void testReduce() {
+    ThreadPool pool;
+    pool.start(4);
+
+    long sum = parallel_reduce(pool, 0, 100000, 0L,
+        [](size_t b, size_t e, long init) {
+            for (size_t i = b; i < e; i++) {
+                init += long(i);
+            }
+            return init;
+        },
+        [](long a, long b) { return a + b; });
+    CHECK_EQ(sum, 100000L * 99999 / 2);
+
+    // 结果按区间顺序合并，不满足交换律的combine也得到正确结果
+    std::string s = parallel_reduce(pool, 0, 26, std::string(),
+        [](size_t b, size_t e, std::string init) {
+            for (size_t i = b; i < e; i++) {
+                init += char('a' + i);
+            }
+            return init;
+        },
+        [](std::string a, const std::string& b) { return a + b; }, 3);
+    CHECK(s == "abcdefghijklmnopqrstuvwxyz");
+
+    // 每块的结果分别存放，T为bool时多个线程同时写入相邻的块也没有数据竞争
+    for (int round = 0; round < 100; round++) {
+        bool all = parallel_reduce(pool, 0, 256, true,
+            [](size_t b, size_t e, bool init) { return init && e > b; },
+            [](bool a, bool b) { return a && b; }, 1);
+        CHECK(all);
+    }
+}
+
+static void testScan() {
+    ThreadPool pool;
+    pool.start(4);
+
+    std::vector<int> in(1000);
+    std::iota(in.begin(), in.end(), 1);
+    std::vector<int> expected(in.size());
+
+    for (size_t grain : { size_t(0), size_t(1), size_t(33), size_t(5000) }) {
+        std::vector<int> out(in.size());
+        auto end = parallel_scan(pool, in.begin(), in.end(), out.begin(), 0, std::plus<int>(),
+                                 ScanType::Scan_Inclusive, grain);
+        CHECK(end == out.end());
+        std::inclusive_scan(in.begin(), in.end(), expected.begin());
+        CHECK(out == expected);
+
+        parallel_scan(pool, in.data(), in.data() + in.size(), out.data(), 10, std::plus<int>(),
+                      ScanType::Scan_Exclusive, grain);
+        std::exclusive_scan(in.begin(), in.end(), expected.begin(), 10);
+        CHECK(out == expected);
+    }
+}
+
+static void testException() {
+    ThreadPool pool;
+    pool.start(4);
+
+    std::atomic<int> calls(0);
+    CHECK_THROWS(parallel_for(pool, 0, 1000, [&](size_t i) {
+        calls++;
+        if (i == 500) {
+            throw std::runtime_error("boom");
+        }
+    }, 1), std::runtime_error);
+
+    CHECK_THROWS(parallel_reduce(pool, 0, 100, 0,
+        [](size_t b, size_t, int) -> int {
+            if (b >= 50) {
+                throw std::logic_error("reduce");
+            }
+            return 0;
+        },
+        [](int a, int b) { return a + b; }, 10), std::logic_error);
+
+    // 异常之后线程池仍可正常使用
+    std::atomic<int> n(0);
+    parallel_for(pool, 0, 100, [&](size_t) { n++; });
+    CHECK_EQ(n.load(), 100);
+}
+
+static void testNestedAndRepeated() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.start(4);
+
+    // 工作线程中嵌套调用，等待时帮忙执行任务，不会死锁
+    std::atomic<long> total(0);
+    parallel_for(pool, 0, 8, [&](size_t) {
+        parallel_for(pool, 0, 100, [&](size_t i) { total += long(i); });
+    }, 1);
+    CHECK_EQ(total.load(), 8L * 4950);
+
+    // 大量短小的调用，Context在最后一个子区间通知之后才能销毁
+    for (int round = 0; round < 2000; round++) {
+        std::atomic<int> n(0);
+        parallel_for(pool, 0, 16, [&](size_t) { n++; }, 1);
+        CHECK_EQ(n.load(), 16);
+    }
+}
+
+static void testNotRunning() {
+    // 没有启动的线程池中没有线程取任务，子区间都在调用线程中执行
+    ThreadPool idle;
+    std::atomic<int> n(0);
+    parallel_for(idle, 0, 1000, [&](size_t) { n++; }, 1);
+    CHECK_EQ(n.load(), 1000);
+    long sum = parallel_reduce(idle, 0, 100, 0L,
+        [](size_t b, size_t e, long init) { return init + long(e - b); },
+        [](long a, long b) { return a + b; }, 7);
+    CHECK_EQ(sum, 100L);
+
+    // 已关闭的线程池同样如此
+    ThreadPool stopped;
+    stopped.start(2);
+    stopped.shutdown();
+    n = 0;
+    parallel_for(stopped, 0, 1000, [&](size_t) { n++; }, 1);
+    CHECK_EQ(n.load(), 1000);
+}
+
+int main() {
+    RUN_TEST(testFor);
+    RUN_TEST(testReduce);
+    RUN_TEST(testScan);
+    RUN_TEST(testException);
+    RUN_TEST(testNestedAndRepeated);
+    RUN_TEST(testNotRunning);
+    return 0;
+}
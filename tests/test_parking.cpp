@@ -0,0 +1,63 @@
+// 线程休眠和唤醒  每个任务最多唤醒一个休眠的线程，休眠期间没有定时轮询，空转的线程不需要唤醒
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+// 调度事件中开始休眠(ph为B)和被唤醒(ph为E)的次数
+static size_t countEvents(ThreadPool& pool, const char* phase) {
+    std::ostringstream os;
+    pool.dumpTrace(os);
+    std::string json = os.str();
+    std::string key = std::string("\"name\":\"parked\",\"ph\":\"") + phase + "\"";
+    size_t count = 0;
+    for (size_t pos = json.find(key); pos != std::string::npos; pos = json.find(key, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static void testOneWakeupPerTask() {
+    ThreadPool pool;
+    pool.setSpinBudget(0);
+    pool.enableTrace();
+    pool.start(4);
+    CHECK(waitUntil([&]() { return countEvents(pool, "B") == 4; }));
+
+    // 空闲的线程一直休眠，不会定时醒来
+    std::this_thread::sleep_for(100ms);
+    CHECK_EQ(countEvents(pool, "E"), size_t(0));
+
+    for (int i = 1; i <= 3; i++) {
+        pool.submitTask([]() {}).get();
+        CHECK(waitUntil([&]() { return countEvents(pool, "B") == size_t(4 + i); }));
+        CHECK_EQ(countEvents(pool, "E"), size_t(i));
+    }
+}
+
+static void testSpinning() {
+    ThreadPool pool;
+    pool.setSpinBudget(size_t(1) << 40);
+    pool.enableTrace();
+    pool.start(1);
+
+    // 线程一直在空转，提交的任务直接被取走，不需要唤醒
+    for (int i = 0; i < 10; i++) {
+        pool.submitTask([]() {}).get();
+    }
+    CHECK_EQ(countEvents(pool, "B"), size_t(0));
+    CHECK_EQ(countEvents(pool, "E"), size_t(0));
+}
+
+int main() {
+    RUN_TEST(testOneWakeupPerTask);
+    RUN_TEST(testSpinning);
+    return 0;
+}
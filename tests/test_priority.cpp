@@ -0,0 +1,94 @@
+// 优先级和截止时间  高优先级先执行，同一优先级内按截止时间先后(EDF)，低优先级等待过久后老化提前
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+// 唯一的线程被占住时提交任务，放开后按执行顺序记录各任务的编号
+struct Recorder {
+    ThreadPool pool;
+    std::atomic_bool started{false};
+    std::atomic_bool opened{false};
+    std::vector<int> order;
+    std::vector<std::future<void>> results;
+
+    explicit Recorder(std::chrono::milliseconds aging = 1000ms) {
+        pool.setQueueMode(QueueMode::Queue_Global);
+        pool.setAgingTime(aging);
+        pool.setTaskQueThreshold(64);
+        pool.start(1);
+        pool.submitTask([this]() {
+            started = true;
+            while (!opened) {
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+        CHECK(waitUntil([&]() { return started.load(); }));
+    }
+
+    void submit(int id, TaskPriority priority) {
+        results.push_back(pool.submitTask(priority, [this, id]() { order.push_back(id); }));
+    }
+
+    void submit(int id, TaskPriority priority, ThreadPool::Deadline deadline) {
+        results.push_back(pool.submitTask(priority, deadline, [this, id]() { order.push_back(id); }));
+    }
+
+    std::vector<int> run() {
+        opened = true;
+        for (auto& r : results) {
+            r.get();
+        }
+        return order;
+    }
+};
+
+static void testPriorityOrder() {
+    Recorder rec;
+    rec.submit(3, TaskPriority::Priority_Low);
+    rec.submit(2, TaskPriority::Priority_Normal);
+    rec.submit(1, TaskPriority::Priority_High);
+    rec.submit(4, TaskPriority::Priority_Low);
+    rec.submit(5, TaskPriority::Priority_Normal);
+    CHECK(rec.run() == std::vector<int>({ 1, 2, 5, 3, 4 }));
+}
+
+static void testDeadline() {
+    Recorder rec;
+    auto now = std::chrono::steady_clock::now();
+    rec.submit(4, TaskPriority::Priority_Normal);
+    rec.submit(3, TaskPriority::Priority_Normal, now + 300ms);
+    rec.submit(1, TaskPriority::Priority_Normal, now + 100ms);
+    rec.submit(2, TaskPriority::Priority_Normal, now + 200ms);
+
+    // 截止时间只在同一优先级内排序
+    rec.submit(0, TaskPriority::Priority_High);
+    rec.submit(5, TaskPriority::Priority_Low, now + 1ms);
+    CHECK(rec.run() == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+}
+
+static void testAging() {
+    Recorder rec(20ms);
+    rec.submit(3, TaskPriority::Priority_Low);
+
+    // 低两级的任务等待超过两倍老化时间后先于高优先级执行
+    std::this_thread::sleep_for(60ms);
+    rec.submit(1, TaskPriority::Priority_High);
+    rec.submit(2, TaskPriority::Priority_Normal);
+    std::vector<int> order = rec.run();
+    CHECK(order == std::vector<int>({ 3, 1, 2 }));
+}
+
+int main() {
+    RUN_TEST(testPriorityOrder);
+    RUN_TEST(testDeadline);
+    RUN_TEST(testAging);
+    return 0;
+}
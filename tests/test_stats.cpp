@@ -0,0 +1,104 @@
+// 运行统计  每个线程的任务计数、等待和执行时间直方图、外部线程的计数和队列的历史最大值
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static void testTaskCounts() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 1000; i++) {
+        results.push_back(pool.submitTask([]() {}));
+    }
+    for (auto& r : results) {
+        r.get();
+    }
+    // future在任务返回之前就绪，计数在任务返回之后才记录
+    CHECK(waitUntil([&]() { return pool.stats().total_.tasksExecuted_ == 1000; }));
+
+    PoolStats stats = pool.stats();
+    CHECK(stats.workers_.size() >= 4);
+    uint64_t sum = stats.external_.tasksExecuted_;
+    for (const WorkerStats& w : stats.workers_) {
+        sum += w.tasksExecuted_;
+    }
+    CHECK_EQ(sum, uint64_t(1000));
+    CHECK_EQ(stats.total_.queueWait_.count(), uint64_t(1000));
+    CHECK_EQ(stats.total_.execTime_.count(), uint64_t(1000));
+    CHECK_EQ(stats.threadSize_, size_t(4));
+    CHECK_EQ(stats.taskSize_, size_t(0));
+}
+
+static void testBusyAndWait() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    // 唯一的线程执行一个20毫秒的任务，其后的任务至少等待这么久
+    std::atomic_bool started(false);
+    auto slow = pool.submitTask([&]() {
+        started = true;
+        std::this_thread::sleep_for(20ms);
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    auto queued = pool.submitTask([]() {});
+    slow.get();
+    queued.get();
+    CHECK(waitUntil([&]() { return pool.stats().total_.tasksExecuted_ == 2; }));
+
+    PoolStats stats = pool.stats();
+    CHECK(stats.workers_[0].busyNs_ >= uint64_t(20000000));
+    CHECK(stats.total_.execTime_.percentile(1.0) >= uint64_t(20000000));
+    CHECK(stats.total_.queueWait_.percentile(1.0) >= uint64_t(10000000));
+    CHECK(stats.total_.queueWait_.percentile(0.0) < uint64_t(10000000));
+}
+
+static void testQueueHighWater() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    auto blocker = pool.submitTask([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 50; i++) {
+        results.push_back(pool.submitTask([]() {}));
+    }
+    CHECK_EQ(pool.stats().taskSize_, size_t(50));
+
+    // 线程池外部的线程帮忙执行的任务计入external_
+    CHECK(pool.runPendingTask());
+    CHECK_EQ(pool.stats().external_.tasksExecuted_, uint64_t(1));
+    CHECK_EQ(pool.stats().taskSize_, size_t(49));
+    release = true;
+    for (auto& r : results) {
+        r.get();
+    }
+    PoolStats stats = pool.stats();
+    CHECK(stats.queueHighWater_ >= 50);
+    CHECK(waitUntil([&]() { return pool.stats().taskSize_ == 0; }));
+}
+
+int main() {
+    RUN_TEST(testTaskCounts);
+    RUN_TEST(testBusyAndWait);
+    RUN_TEST(testQueueHighWater);
+    return 0;
+}
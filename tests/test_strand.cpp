@@ -0,0 +1,193 @@
+// 串行执行  Strand/StrandMap的任务顺序、互斥、不同键并行、submitTask和析构
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "strand.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+// 记录同时执行的任务数量的最大值
+struct Overlap {
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+
+    void enter() {
+        int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+    }
+
+    void leave() {
+        running--;
+    }
+};
+
+static void testOrder() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(4);
+
+        // 超过一批(DRAIN_BATCH)的任务中途让出工作线程，顺序不变，任务之间不并发
+        std::vector<int> order;
+        Overlap overlap;
+        {
+            Strand strand(pool);
+            for (int i = 0; i < 1000; i++) {
+                strand.post([&, i]() {
+                    overlap.enter();
+                    CHECK(strand.runningInThisThread());
+                    order.push_back(i);
+                    overlap.leave();
+                });
+            }
+            CHECK(!strand.runningInThisThread());
+        }
+        CHECK_EQ(order.size(), 1000u);
+        for (int i = 0; i < 1000; i++) {
+            CHECK_EQ(order[i], i);
+        }
+        CHECK_EQ(overlap.peak.load(), 1);
+    }
+}
+
+static void testProducers() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+
+    // 多个线程同时提交，每个提交者的任务按它的提交顺序执行
+    const int PRODUCERS = 4;
+    const int TASKS = 500;
+    std::vector<int> last(PRODUCERS, -1);
+    std::atomic<int> outOfOrder(0);
+    Overlap overlap;
+    {
+        Strand strand(pool);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCERS; p++) {
+            producers.emplace_back([&, p]() {
+                for (int i = 0; i < TASKS; i++) {
+                    strand.post([&, p, i]() {
+                        overlap.enter();
+                        if (last[p] != i - 1) {
+                            outOfOrder++;
+                        }
+                        last[p] = i;
+                        overlap.leave();
+                    });
+                }
+            });
+        }
+        for (auto& t : producers) {
+            t.join();
+        }
+    }
+    CHECK_EQ(outOfOrder.load(), 0);
+    CHECK_EQ(overlap.peak.load(), 1);
+    for (int p = 0; p < PRODUCERS; p++) {
+        CHECK_EQ(last[p], TASKS - 1);
+    }
+}
+
+static void testSubmitTask() {
+    ThreadPool pool;
+    pool.start(2);
+    Strand strand(pool);
+    auto value = strand.submitTask([](int x) { return x + 1; }, 41);
+    auto error = strand.submitTask([]() -> int { throw std::runtime_error("fail"); });
+    CHECK_EQ(value.get(), 42);
+    CHECK_THROWS(error.get(), std::runtime_error);
+
+    StrandMap<int> map(pool);
+    auto keyed = map.submitTask(7, [](int x) { return x * 2; }, 21);
+    CHECK_EQ(keyed.get(), 42);
+}
+
+static void testStrandMapOrder() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(4);
+
+        // 同一个键的任务按顺序且不并发，键的任务全部执行完后删除
+        const int KEYS = 16;
+        std::vector<std::vector<int>> order(KEYS);
+        std::vector<Overlap> overlap(KEYS);
+        {
+            StrandMap<int> map(pool, 4);
+            for (int i = 0; i < 200; i++) {
+                for (int k = 0; k < KEYS; k++) {
+                    map.post(k, [&, k, i]() {
+                        overlap[k].enter();
+                        order[k].push_back(i);
+                        overlap[k].leave();
+                    });
+                }
+            }
+            CHECK(waitUntil([&]() { return map.activeKeys() == 0; }));
+        }
+        for (int k = 0; k < KEYS; k++) {
+            CHECK_EQ(order[k].size(), 200u);
+            for (int i = 0; i < 200; i++) {
+                CHECK_EQ(order[k][i], i);
+            }
+            CHECK_EQ(overlap[k].peak.load(), 1);
+        }
+    }
+}
+
+static void testStrandMapParallel() {
+    ThreadPool pool;
+    pool.start(2);
+
+    // 不同键的任务并行执行  键0的任务等待键1的任务开始
+    std::atomic_bool other(false);
+    std::atomic_bool seen(false);
+    StrandMap<int> map(pool);
+    map.post(0, [&]() { seen = waitUntil([&]() { return other.load(); }); });
+    map.post(1, [&]() { other = true; });
+    CHECK(waitUntil([&]() { return map.activeKeys() == 0; }));
+    CHECK(seen.load());
+}
+
+static void testDestroyAfterLastTask() {
+    // 最后一个任务在通知之后才允许析构，反复在栈上创建和销毁
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+    for (int i = 0; i < 2000; i++) {
+        std::atomic<int> done(0);
+        {
+            Strand strand(pool);
+            StrandMap<int> map(pool);
+            strand.post([&]() { done++; });
+            map.post(i, [&]() { done++; });
+        }
+        CHECK_EQ(done.load(), 2);
+    }
+}
+
+int main() {
+    RUN_TEST(testOrder);
+    RUN_TEST(testProducers);
+    RUN_TEST(testSubmitTask);
+    RUN_TEST(testStrandMapOrder);
+    RUN_TEST(testStrandMapParallel);
+    RUN_TEST(testDestroyAfterLastTask);
+    return 0;
+}
@@ -0,0 +1,193 @@
+// future接口的基本提交测试  各队列模式和线程池模式下提交、批量提交、异常传递
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+static void testSubmitAllModes() {
+    for (PoolMode poolMode : { PoolMode::Mode_Fixed, PoolMode::Mode_Cached }) {
+        for (QueueMode queueMode : QUEUE_MODES) {
+            ThreadPool pool;
+            pool.setMode(poolMode);
+            pool.setQueueMode(queueMode);
+            pool.start(4);
+
+            std::vector<std::future<int>> futures;
+            for (int i = 0; i < 1000; i++) {
+                futures.push_back(pool.submitTask([](int a, int b) { return a + b; }, i, 1));
+            }
+            long sum = 0;
+            for (auto& f : futures) {
+                sum += f.get();
+            }
+            CHECK_EQ(sum, 1000L * 999 / 2 + 1000);
+        }
+    }
+}
+
+static void testSubmitFromWorkers() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.start(4);
+
+        // 工作线程中提交的任务进入本地队列(Queue_WorkStealing)，可以被其他线程窃取
+        std::atomic<int> done(0);
+        auto outer = pool.submitTask([&]() {
+            std::vector<std::future<void>> inner;
+            for (int i = 0; i < 200; i++) {
+                inner.push_back(pool.submitTask([&]() { done++; }));
+            }
+            return inner.size();
+        });
+        CHECK_EQ(outer.get(), 200u);
+        CHECK(waitUntil([&]() { return done.load() == 200; }));
+    }
+}
+
+static void testSubmitBeforeStart() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(64);
+
+        // start之前提交的任务留在队列中(无锁模式下还没有环形队列，放入全局队列)，start之后执行
+        std::atomic<int> done(0);
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < 32; i++) {
+            futures.push_back(pool.submitTask([&]() { done++; }));
+        }
+        CHECK_EQ(done.load(), 0);
+        pool.start(2);
+        for (int i = 0; i < 32; i++) {
+            futures.push_back(pool.submitTask([&]() { done++; }));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        CHECK_EQ(done.load(), 64);
+    }
+}
+
+static void testWorkStealing() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+
+    // 一个工作线程提交的任务都在它的本地队列中，其他线程窃取后一起执行
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> done(0);
+    pool.submitTask([&]() {
+        for (int i = 0; i < 64; i++) {
+            pool.submitTask([&]() {
+                std::this_thread::sleep_for(1ms);
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+                done++;
+            });
+        }
+    }).get();
+    CHECK(waitUntil([&]() { return done.load() == 64; }));
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(threads.size() >= 2);
+}
+
+static void testLockFreeFull() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_LockFree);
+    pool.setTaskQueThreshold(4);
+    pool.start(1);
+
+    // 占住唯一的工作线程，环形队列放满之后提交者等待空余
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    pool.submitTask([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    std::thread releaser([&]() {
+        std::this_thread::sleep_for(50ms);
+        release = true;
+    });
+
+    std::atomic<int> done(0);
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 20; i++) {
+        futures.push_back(pool.submitTask([&]() { done++; }));
+    }
+    releaser.join();
+    for (auto& f : futures) {
+        f.get();
+    }
+    CHECK_EQ(done.load(), 20);
+}
+
+static void testSubmitBatch() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.start(2);
+
+        std::vector<std::function<int()>> tasks;
+        for (int i = 0; i < 100; i++) {
+            tasks.push_back([i]() { return i * 2; });
+        }
+        auto futures = pool.submitBatch(tasks.begin(), tasks.end());
+        CHECK_EQ(futures.size(), tasks.size());
+        for (int i = 0; i < 100; i++) {
+            CHECK_EQ(futures[i].get(), i * 2);
+        }
+    }
+}
+
+static void testExceptionPropagates() {
+    ThreadPool pool;
+    pool.start(2);
+    auto f = pool.submitTask([]() -> int { throw std::runtime_error("boom"); });
+    CHECK_THROWS(f.get(), std::runtime_error);
+
+    // 抛出异常之后工作线程仍然可用
+    CHECK_EQ(pool.submitTask([]() { return 7; }).get(), 7);
+}
+
+static void testDestructorDrains() {
+    std::atomic<int> done(0);
+    {
+        ThreadPool pool;
+        pool.start(2);
+        for (int i = 0; i < 100; i++) {
+            pool.submitTask([&]() { done++; });
+        }
+    }
+    CHECK_EQ(done.load(), 100);
+}
+
+int main() {
+    RUN_TEST(testSubmitAllModes);
+    RUN_TEST(testSubmitFromWorkers);
+    RUN_TEST(testSubmitBeforeStart);
+    RUN_TEST(testWorkStealing);
+    RUN_TEST(testLockFreeFull);
+    RUN_TEST(testSubmitBatch);
+    RUN_TEST(testExceptionPropagates);
+    RUN_TEST(testDestructorDrains);
+    return 0;
+}
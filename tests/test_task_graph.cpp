@@ -0,0 +1,163 @@
+// TaskGraph的执行顺序、结果传递、异常传递和环检测
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "task_graph.h"
+#include "test_util.h"
+
+static void testDiamond() {
+    ThreadPool pool;
+    pool.setQueueMode(QueueMode::Queue_WorkStealing);
+    pool.start(4);
+
+    // a -> b, a -> c, b -> d, c -> d
+    int a = 0, b = 0, c = 0, d = 0;
+    TaskGraph graph;
+    auto na = graph.addNode([&]() { a = 1; });
+    auto nb = graph.addNode([&]() { b = a + 1; });
+    auto nc = graph.addNode([&]() { c = a + 2; });
+    auto nd = graph.addNode([&]() { d = b + c; });
+    graph.addEdge(na, nb);
+    graph.addEdge(na, nc);
+    graph.addEdge(nb, nd);
+    graph.addEdge(nc, nd);
+
+    // 同一个图可以反复执行
+    for (int round = 0; round < 100; round++) {
+        a = b = c = d = 0;
+        graph.run(pool);
+        CHECK_EQ(d, 5);
+    }
+}
+
+static void testChainOrderAndFanout() {
+    ThreadPool pool;
+    pool.start(4);
+
+    // 链式依赖按顺序执行
+    std::vector<int> order;
+    TaskGraph chain;
+    TaskGraph::NodeId prev = 0;
+    for (int i = 0; i < 50; i++) {
+        auto id = chain.addNode([&order, i]() { order.push_back(i); });
+        if (i > 0) {
+            chain.addEdge(prev, id);
+        }
+        prev = id;
+    }
+    chain.run(pool);
+    CHECK_EQ(order.size(), 50u);
+    for (int i = 0; i < 50; i++) {
+        CHECK_EQ(order[i], i);
+    }
+
+    // 一个根节点扇出到多个节点，再汇合到一个节点
+    std::atomic<int> done(0);
+    int seen = -1;
+    TaskGraph fan;
+    auto root = fan.addNode([]() {});
+    auto sink = fan.addNode([&]() { seen = done.load(); });
+    for (int i = 0; i < 200; i++) {
+        auto id = fan.addNode([&]() { done++; });
+        fan.addEdge(root, id);
+        fan.addEdge(id, sink);
+    }
+    fan.run(pool);
+    CHECK_EQ(seen, 200);
+}
+
+static void testException() {
+    ThreadPool pool;
+    pool.start(2);
+
+    bool after = false;
+    TaskGraph graph;
+    auto a = graph.addNode([]() { throw std::runtime_error("node"); });
+    auto b = graph.addNode([&]() { after = true; });
+    graph.addEdge(a, b);
+    CHECK_THROWS(graph.run(pool), std::runtime_error);
+    // 抛出异常之后尚未开始的节点不再执行
+    CHECK(!after);
+
+    // 异常之后线程池仍可执行其他图
+    int x = 0;
+    TaskGraph ok;
+    ok.addNode([&]() { x = 1; });
+    ok.run(pool);
+    CHECK_EQ(x, 1);
+}
+
+static void testInvalidGraphs() {
+    TaskGraph graph;
+    auto a = graph.addNode([]() {});
+    auto b = graph.addNode([]() {});
+    auto c = graph.addNode([]() {});
+    CHECK_THROWS(graph.addEdge(a, a), std::invalid_argument);
+    CHECK_THROWS(graph.addEdge(a, 10), std::invalid_argument);
+
+    graph.addEdge(a, b);
+    graph.addEdge(b, c);
+    graph.addEdge(c, a);
+    ThreadPool pool;
+    pool.start(1);
+    CHECK_THROWS(graph.run(pool), std::invalid_argument);
+
+    // 空图直接返回
+    TaskGraph empty;
+    empty.run(pool);
+}
+
+static void testRunFromWorker() {
+    ThreadPool pool;
+    pool.start(2);
+
+    // 在工作线程中执行图，等待期间帮忙执行任务，即使只有这些线程也不会死锁
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 4; i++) {
+        results.push_back(pool.submitTask([&pool]() {
+            std::atomic<int> sum(0);
+            TaskGraph graph;
+            auto root = graph.addNode([]() {});
+            for (int j = 1; j <= 10; j++) {
+                graph.addEdge(root, graph.addNode([&sum, j]() { sum += j; }));
+            }
+            graph.run(pool);
+            return sum.load();
+        }));
+    }
+    for (auto& f : results) {
+        CHECK_EQ(f.get(), 55);
+    }
+}
+
+static void testNotRunning() {
+    // 没有启动或已关闭的线程池中没有线程取任务，节点都在调用线程中执行
+    ThreadPool idle;
+    ThreadPool stopped;
+    stopped.start(2);
+    stopped.shutdown();
+    for (ThreadPool* pool : { &idle, &stopped }) {
+        std::vector<int> order;
+        TaskGraph g;
+        auto a = g.addNode([&]() { order.push_back(0); });
+        auto b = g.addNode([&]() { order.push_back(1); });
+        auto c = g.addNode([&]() { order.push_back(2); });
+        g.addEdge(a, b);
+        g.addEdge(b, c);
+        g.run(*pool);
+        CHECK(order == std::vector<int>({ 0, 1, 2 }));
+    }
+}
+
+int main() {
+    RUN_TEST(testDiamond);
+    RUN_TEST(testChainOrderAndFanout);
+    RUN_TEST(testException);
+    RUN_TEST(testInvalidGraphs);
+    RUN_TEST(testRunFromWorker);
+    RUN_TEST(testNotRunning);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// 任务组  结果、异常传播、等待期间执行其他任务、递归嵌套和重复使用
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "task_group.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+static void testResults() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(4);
+
+        std::vector<long> out(100);
+        TaskGroup g(pool);
+        for (int i = 0; i < 100; i++) {
+            g.run([&out, i]() { out[i] = long(i) * i; });
+        }
+        g.wait();
+        for (int i = 0; i < 100; i++) {
+            CHECK_EQ(out[i], long(i) * i);
+        }
+
+        // wait之后可以继续使用
+        std::atomic<int> done(0);
+        for (int i = 0; i < 10; i++) {
+            g.run([&]() { done++; });
+        }
+        g.wait();
+        CHECK_EQ(done.load(), 10);
+    }
+}
+
+static void testException() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    // 有任务抛出异常后，组被取消，尚未开始的任务不再执行，wait重新抛出第一个异常
+    std::atomic<int> done(0);
+    TaskGroup g(pool);
+    g.run([]() { throw std::runtime_error("first"); });
+    CHECK(waitUntil([&]() { return g.isCancelled(); }));
+    g.run([]() { throw std::runtime_error("second"); });
+    for (int i = 0; i < 50; i++) {
+        g.run([&]() { done++; });
+    }
+    bool thrown = false;
+    try {
+        g.wait();
+    } catch (const std::runtime_error& e) {
+        thrown = std::string(e.what()) == "first";
+    }
+    CHECK(thrown);
+    CHECK_EQ(done.load(), 0);
+
+    // 异常只抛出一次，之后恢复初始状态
+    CHECK(!g.isCancelled());
+    g.run([&]() { done = -1; });
+    g.wait();
+    CHECK_EQ(done.load(), -1);
+}
+
+static void testCancel() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    std::atomic<int> done(0);
+    TaskGroup g(pool);
+    g.run([&]() {
+        started = true;
+        while (!release) {
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    CHECK(waitUntil([&]() { return started.load(); }));
+    for (int i = 0; i < 10; i++) {
+        g.run([&]() { done++; });
+    }
+    g.cancel();
+    CHECK(g.isCancelled());
+    release = true;
+    g.wait();
+    CHECK_EQ(done.load(), 0);
+}
+
+static long fib(ThreadPool& pool, int n) {
+    if (n < 12) {
+        return n < 2 ? n : fib(pool, n - 1) + fib(pool, n - 2);
+    }
+    long a = 0;
+    TaskGroup g(pool);
+    g.run([&]() { a = fib(pool, n - 1); });
+    long b = fib(pool, n - 2);
+    g.wait();
+    return a + b;
+}
+
+static void testNested() {
+    // 工作线程在任务中等待子任务组时执行其他任务，2个线程的线程池中递归分治也不会死锁
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.setTaskQueThreshold(1024);
+        pool.start(2);
+        auto f = pool.submitTask([&]() { return fib(pool, 22); });
+        CHECK_EQ(f.get(), 17711L);
+    }
+}
+
+static void testWaitRunsOtherTasks() {
+    // 唯一的工作线程在等待组内任务时，组的作业和线程池中的其他任务由它自己执行
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(1);
+
+    std::atomic<int> other(0);
+    auto f = pool.submitTask([&]() {
+        TaskGroup g(pool);
+        std::atomic<int> done(0);
+        for (int i = 0; i < 10; i++) {
+            g.run([&]() { done++; });
+            pool.submitTask([&]() { other++; });
+        }
+        g.wait();
+        return done.load();
+    });
+    CHECK_EQ(f.get(), 10);
+    CHECK(waitUntil([&]() { return other.load() == 10; }));
+}
+
+static void testDestroyAfterLastJob() {
+    // 最后一个作业在通知之后才允许任务组析构，反复在栈上创建和销毁
+    ThreadPool pool;
+    pool.setTaskQueThreshold(1024);
+    pool.start(4);
+    for (int i = 0; i < 2000; i++) {
+        std::atomic<int> done(0);
+        {
+            TaskGroup g(pool);
+            g.run([&]() { done++; });
+            g.run([&]() { done++; });
+            if (i % 2 == 0) {
+                g.wait();
+            }
+        }
+        CHECK_EQ(done.load(), 2);
+    }
+}
+
+int main() {
+    RUN_TEST(testResults);
+    RUN_TEST(testException);
+    RUN_TEST(testCancel);
+    RUN_TEST(testNested);
+    RUN_TEST(testWaitRunsOtherTasks);
+    RUN_TEST(testDestroyAfterLastJob);
+    return 0;
+}
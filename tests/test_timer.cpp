@@ -0,0 +1,173 @@
+// 定时任务  submitAfter/submitAt/submitEvery的触发时刻和顺序、取消、繁忙时触发和关闭
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "threadpool_final.h"
+#include "test_util.h"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+static const QueueMode QUEUE_MODES[] = {
+    QueueMode::Queue_Global, QueueMode::Queue_WorkStealing, QueueMode::Queue_LockFree,
+};
+
+static void testSubmitAfter() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.start(2);
+
+        // 到期之前不执行，空闲的工作线程按到期时间等待后触发
+        std::atomic<int64_t> firedAt(0);
+        Clock::time_point start = Clock::now();
+        TimerHandle timer = pool.submitAfter(20ms, [&]() {
+            firedAt = (Clock::now() - start).count();
+        });
+        CHECK(bool(timer));
+        CHECK(waitUntil([&]() { return firedAt.load() != 0; }));
+        CHECK(std::chrono::nanoseconds(firedAt.load()) >= 20ms);
+        CHECK(!timer.cancel());
+    }
+}
+
+static void testSubmitAt() {
+    ThreadPool pool;
+    pool.start(1);
+    std::atomic<int64_t> firedAt(0);
+    Clock::time_point due = Clock::now() + 15ms;
+    pool.submitAt(due, [&]() { firedAt = Clock::now().time_since_epoch().count(); });
+    CHECK(waitUntil([&]() { return firedAt.load() != 0; }));
+    CHECK(firedAt.load() >= due.time_since_epoch().count());
+
+    // 已经过去的时刻在下一个刻度触发
+    std::atomic_bool past(false);
+    pool.submitAt(Clock::now() - 1s, [&]() { past = true; });
+    CHECK(waitUntil([&]() { return past.load(); }));
+}
+
+static void testOrder() {
+    ThreadPool pool;
+    pool.start(1);
+
+    // 倒序添加，按到期时间先后执行；跨越时间轮层级的定时器同样按时触发
+    std::vector<int> order;
+    std::mutex mutex;
+    std::atomic<int> fired(0);
+    for (int i = 5; i >= 0; i--) {
+        pool.submitAfter(std::chrono::milliseconds(5 + i * 60), [&, i]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(i);
+            fired++;
+        });
+    }
+    CHECK(waitUntil([&]() { return fired.load() == 6; }));
+    for (int i = 0; i < 6; i++) {
+        CHECK_EQ(order[i], i);
+    }
+}
+
+static void testCancel() {
+    ThreadPool pool;
+    pool.start(2);
+
+    std::atomic<int> fired(0);
+    TimerHandle a = pool.submitAfter(30ms, [&]() { fired++; });
+    TimerHandle b = pool.submitAfter(1h, [&]() { fired++; });
+    CHECK(!a.isCancelled());
+    CHECK(a.cancel());
+    CHECK(a.isCancelled());
+    CHECK(!a.cancel());
+    CHECK(b.cancel());
+    std::this_thread::sleep_for(60ms);
+    CHECK_EQ(fired.load(), 0);
+
+    // 默认构造的句柄
+    TimerHandle none;
+    CHECK(!none);
+    CHECK(!none.cancel());
+}
+
+static void testSubmitEvery() {
+    for (QueueMode queueMode : QUEUE_MODES) {
+        ThreadPool pool;
+        pool.setQueueMode(queueMode);
+        pool.start(2);
+
+        // 周期任务不会并发执行；取消后不再安排下一次
+        std::atomic<int> count(0);
+        std::atomic<int> running(0);
+        std::atomic<int> overlap(0);
+        TimerHandle timer = pool.submitEvery(2ms, [&]() {
+            if (++running > 1) {
+                overlap++;
+            }
+            count++;
+            std::this_thread::sleep_for(3ms);
+            running--;
+        });
+        CHECK(waitUntil([&]() { return count.load() >= 5; }));
+        CHECK(timer.cancel());
+        CHECK(waitUntil([&]() { return running.load() == 0; }));
+        int seen = count.load();
+        std::this_thread::sleep_for(30ms);
+        CHECK(count.load() <= seen + 1);
+        CHECK_EQ(overlap.load(), 0);
+    }
+}
+
+static void testBusyWorkers() {
+    ThreadPool pool;
+    pool.setTaskQueThreshold(4096);
+    pool.start(1);
+
+    // 唯一的工作线程一直在执行任务时，定时器在任务之间检查并触发
+    std::atomic_bool stop(false);
+    std::atomic<int> tasks(0);
+    std::function<void()> chain = [&]() {
+        tasks++;
+        std::this_thread::sleep_for(200us);
+        if (!stop) {
+            pool.submitTask(chain);
+        }
+    };
+    pool.submitTask(chain);
+    std::atomic_bool fired(false);
+    pool.submitAfter(10ms, [&]() { fired = true; });
+    CHECK(waitUntil([&]() { return fired.load(); }, 2000ms));
+    stop = true;
+    CHECK(tasks.load() > 0);
+}
+
+static void testShutdown() {
+    // 关闭时尚未到期的定时任务被丢弃；线程池析构后取消仍然安全
+    std::atomic<int> fired(0);
+    TimerHandle timer;
+    {
+        ThreadPool pool;
+        pool.start(1);
+        timer = pool.submitAfter(1h, [&]() { fired++; });
+        pool.submitEvery(1h, [&]() { fired++; });
+        pool.shutdown();
+        pool.submitAfter(1ms, [&]() { fired++; });
+        std::this_thread::sleep_for(10ms);
+    }
+    timer.cancel();
+    CHECK_EQ(fired.load(), 0);
+}
+
+int main() {
+    RUN_TEST(testSubmitAfter);
+    RUN_TEST(testSubmitAt);
+    RUN_TEST(testOrder);
+    RUN_TEST(testCancel);
+    RUN_TEST(testSubmitEvery);
+    RUN_TEST(testBusyWorkers);
+    RUN_TEST(testShutdown);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// 测试用的断言和等待工具  断言失败时输出位置并以非0退出，由ctest报告失败
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        auto va_ = (a); \
+        auto vb_ = (b); \
+        if (!(va_ == vb_)) { \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+                         #a, #b, (long long)va_, (long long)vb_); \
+            std::exit(1); \
+        } \
+    } while (0)
+
+// 检查表达式抛出指定类型的异常
+#define CHECK_THROWS(expr, type) \
+    do { \
+        bool thrown_ = false; \
+        try { \
+            (void)(expr); \
+        } catch (const type&) { \
+            thrown_ = true; \
+        } \
+        CHECK(thrown_); \
+    } while (0)
+
+// 依次运行测试函数，输出名称便于定位失败的用例
+#define RUN_TEST(func) \
+    do { \
+        std::printf("%s\n", #func); \
+        std::fflush(stdout); \
+        func(); \
+    } while (0)
+
+// 等待条件成立，超时返回false
+template <typename Pred>
+bool waitUntil(Pred pred, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+#endif
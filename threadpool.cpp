@@ -4,8 +4,6 @@
 #include <iostream>
 
 const size_t TASK_QUE_THRESHOLD = 1024;
-const size_t THREAD_SIZE_THRESHOLD = 100;
-const int THREAD_MAX_IDEL_TIME = 10;
 
 /*
 任务类方法实现
@@ -15,235 +13,274 @@ Task::Task()
 }
 
 void Task::setResult(Result* res) {
-    res_ = res;
+    res_ = res->state_;
 }
 
 void Task::exec() {
-    if (res_ != nullptr) {
+    if (res_ == nullptr) {
+        return ;
+    }
+    if (token_.isCancelled()) {
+        res_->setVal(Any(), Result::State::READY | Result::State::CANCELLED);
+        return ;
+    }
+    try {
         res_->setVal(run());
+    } catch (const TaskCancelled&) {
+        res_->setVal(Any(), Result::State::READY | Result::State::CANCELLED);
     }
 }
 
-
-/*
-线程池类方法实现
-*/
-
-ThreadPool::ThreadPool()   
-    : initThreadSize_(0), 
-      idleThreadSize_(0),
-      curThreadSize_(0),
-      threadSizeThreshold_(THREAD_SIZE_THRESHOLD),
-      taskSize_(0), 
-      taskQueThreshold_(TASK_QUE_THRESHOLD), 
-      poolMode_(PoolMode::Mode_Fixed),
-      isRunning_(false) {
+bool Task::isCancelled() const {
+    return token_.isCancelled();
 }
 
-ThreadPool::~ThreadPool() {
-    isRunning_ = false;
-    
-    std::unique_lock<std::mutex> lock(taskQueMutex_);
-    notEmpty_.notify_all();
-    exitCond_.wait(lock, [&]()->bool { return threads_.size() == 0; });
+void Task::throwIfCancelled() const {
+    token_.throwIfCancelled();
 }
 
-// 开启线程池
-void ThreadPool::start(size_t initThreadSize) {
-    // 设置线程池运行状态
-    isRunning_ = true;
+void Task::reject() {
+    if (res_ != nullptr) {
+        res_->setVal(Any(), Result::State::READY | Result::State::REJECTED);
+    }
+}
 
-    // 初始化线程数量
-    initThreadSize_ = initThreadSize;
-    curThreadSize_ = initThreadSize;
 
-    // 创建线程对象
-    for (int i = 0; i < initThreadSize_; i++) {
-        auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFuc, this, std::placeholders::_1));
-        int thread_id = ptr->getId();
-        threads_.emplace(thread_id, std::move(ptr));
+// 队列中的任务  没有执行就被析构(提交被拒绝、被丢弃)时把Result标记为被拒绝，等待者不会一直阻塞
+class TaskJob {
+public:
+    explicit TaskJob(std::shared_ptr<Task> sp)
+        : sp_(std::move(sp)) {
     }
-    // 启动所有线程
-    for (int i = 0; i < initThreadSize_; i++) {
-        threads_[i]->start();
-        idleThreadSize_++;
-    }
-}
 
-// 设置线程池的线程上线(Cached模式下)
-void ThreadPool::setThreadSizeThreshold(size_t thread_threshold) {
-    if (checkState()) {
-        return ;
+    TaskJob(TaskJob&&) noexcept = default;
+    TaskJob& operator=(TaskJob&&) = delete;
+
+    ~TaskJob() {
+        if (sp_ != nullptr) {
+            sp_->reject();
+        }
     }
-    if (poolMode_ == PoolMode::Mode_Cached) {
-        threadSizeThreshold_ = thread_threshold;
+
+    void operator()() {
+        std::shared_ptr<Task> sp = std::move(sp_);
+        sp->exec();
     }
-}
 
-// 设置线程池的工作模式
-void ThreadPool::setMode(PoolMode mode) {
-    if (checkState()) {
-        return ;
-    } 
-    poolMode_ = mode; 
-}
+private:
+    std::shared_ptr<Task> sp_;
+};
 
-// 查询线程池工作状态
-bool ThreadPool::checkState() const {
-    return isRunning_;
-}
 
-// 设置线程池的任务队列容量上限
-void ThreadPool::setTaskQueThreshold(size_t task_threshold) {
-    taskQueThreshold_ = task_threshold;
+/*
+线程池类方法实现
+*/
+
+ThreadPool::ThreadPool()
+    : ThreadPoolBase(TASK_QUE_THRESHOLD) {
 }
 
 // 提交任务至线程池    用户调用该接口向任务队列中添加任务
 Result ThreadPool::submitTask(std::shared_ptr<Task> sp) {
-    // 获取锁
-    std::unique_lock<std::mutex> lock(taskQueMutex_);
-
-    // 线程通信 等待任务队列空余
-    if (!notFull_.wait_for(lock, std::chrono::seconds(1), [&]()->bool { return taskQue_.size() < taskQueThreshold_; })) {
-        std::cerr << "Task queue is full, submit task fail." << std::endl;
-        return Result(std::move(sp), false);
-    }
-
-    // 任务队列空余，将任务加入队列
-    taskQue_.emplace(sp);
-    taskSize_++;
-
-    notEmpty_.notify_all(); 
-
-    // Cached模式下，根据任务数量和空闲线程数量判断是否需要创建新线程
-    if (poolMode_ == PoolMode::Mode_Cached && taskSize_ > idleThreadSize_ && curThreadSize_ < threadSizeThreshold_) {
-        auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFuc, this, std::placeholders::_1));
-        std::cout << "---Create new thread---" << std::endl;
-        int thread_id = ptr->getId();
-        threads_.emplace(thread_id, std::move(ptr));
-        threads_[thread_id]->start();
-        curThreadSize_++;
-        idleThreadSize_++;
-    }
-
-    return Result(std::move(sp));
-}
-
-// 定义线程函数  线程池的所有线程从任务队列中获取任务并执行
-void ThreadPool::threadFuc(int thread_id) {
-    auto lastTime = std::chrono::high_resolution_clock().now();
-
-    for (;;) {
-        std::shared_ptr<Task> task;
-        // 建立作用域限制线程获取锁的时间
-        {
-            // 获取锁
-            std::unique_lock<std::mutex> lock(taskQueMutex_);
-
-            std::cout << "Thread id: " << std::this_thread::get_id() << " try to acquire task..." << std::endl;
-
-            // Cached模式下，回收超过空闲时间的多余线程
-            while (taskQue_.size() == 0) {
-                if (!isRunning_) {
-                    threads_.erase(thread_id);
-                    std::cout << "Thread id: " << std::this_thread::get_id() << " exit..." << std::endl;
-                    exitCond_.notify_all();
-                    return ;
-                }
-
-                if (poolMode_ == PoolMode::Mode_Cached) {
-                    if (std::cv_status::timeout == notEmpty_.wait_for(lock, std::chrono::seconds(1))) {
-                        auto nowTime = std::chrono::high_resolution_clock().now();
-                        auto durTime = std::chrono::duration_cast<std::chrono::seconds>(nowTime - lastTime);
-                        if (durTime.count() >= THREAD_MAX_IDEL_TIME && curThreadSize_ > initThreadSize_) {
-                            threads_.erase(thread_id);
-                            std::cout << "---Thread exit, id: " << std::this_thread::get_id() << "---" << std::endl; 
-                            curThreadSize_--;
-                            idleThreadSize_--;
-                            return ;
-                        }
-                    }
-                } else {
-                    // 等待notEmpty条件
-                    notEmpty_.wait(lock);
-                }
-
-                // if (!isRunning_) {
-                //     threads_.erase(thread_id);
-                //     exitCond_.notify_all();
-                //     std::cout << "Thread id: " << std::this_thread::get_id() << " exit..." << std::endl;
-                //     return ;
-                // }
-            }
-
-            std::cout << "Thread id: " << std::this_thread::get_id() << " acquire task successfully..." << std::endl;
-            idleThreadSize_--;
-
-            // 从任务队列中获取任务
-            task = taskQue_.front();
-            taskQue_.pop();
-            taskSize_--;
-
-            if (taskSize_ > 0) {
-                notEmpty_.notify_all();
-            }
-
-            notFull_.notify_all();
-        }
+    return submitTask(std::move(sp), TaskPriority::Priority_Normal);
+}
 
-        // 当前线程执行该任务
-        if (task != nullptr) {
-            task->exec();
-        }
+// 按优先级和截止时间提交任务
+Result ThreadPool::submitTask(std::shared_ptr<Task> sp, TaskPriority priority, Deadline deadline) {
+    // 先绑定Result再入队，任务可能在返回之前就被执行
+    Result res(sp);
+    res.state_->pool_ = this;
 
-        idleThreadSize_++;
-        lastTime = std::chrono::high_resolution_clock().now();
+    // 被拒绝时job析构，把res标记为被拒绝
+    Job job = TaskJob(sp);
+    if (!pushTask(job, priority, deadline)) {
+        res.isValid_ = false;
     }
+    return res;
 }
 
+// 提交可以取消的任务  令牌在任务取出时检查，取消不需要在队列中查找任务
+Result ThreadPool::submitTask(std::shared_ptr<Task> sp, CancellationToken token) {
+    sp->token_ = std::move(token);
+    return submitTask(std::move(sp), TaskPriority::Priority_Normal);
+}
 
-/*
-线程类方法实现
-*/
-int Thread::genId_ = 0;
+// 不等待地提交任务
+Result ThreadPool::trySubmit(std::shared_ptr<Task> sp) {
+    Result res(sp);
+    res.state_->pool_ = this;
 
-Thread::Thread(ThreadFunc func) 
-    : func_(func),
-      threadId_(genId_++) {
+    Job job = TaskJob(sp);
+    if (!pushTask(job, std::chrono::milliseconds(0))) {
+        res.isValid_ = false;
+    }
+    return res;
 }
 
-Thread::~Thread() {    
-}
+// 批量提交任务至线程池
+std::vector<Result> ThreadPool::submitBatch(const std::vector<std::shared_ptr<Task>>& tasks) {
+    std::vector<Result> results;
+    std::vector<Job> jobs;
+    results.reserve(tasks.size());
+    jobs.reserve(tasks.size());
+
+    for (const auto& sp : tasks) {
+        Result res(sp);
+        res.state_->pool_ = this;
+        results.emplace_back(std::move(res));
+        jobs.emplace_back(TaskJob(sp));
+    }
 
-// 启动线程
-void Thread::start() {
-    std::thread t(func_, threadId_);
-    t.detach();
+    // 被拒绝的任务留在jobs中，析构时标记对应的Result
+    size_t pushed = pushBatch(jobs);
+    for (size_t i = pushed; i < tasks.size(); i++) {
+        results[i].isValid_ = false;
+    }
+    return results;
 }
 
-// 查询线程id
-int Thread::getId() const {
-    return threadId_;
+// 提交延续任务  作为内部作业不会被Overload_DropOldest丢弃，co_await的协程在其中恢复
+void ThreadPool::post(std::shared_ptr<Task> sp) {
+    Job job = TaskJob(std::move(sp));
+    if (!pushTask(job, TaskPriority::Priority_Normal, Deadline::max(), true)) {
+        job();
+    }
 }
 
+
 /*
 Result类方法实现
 */
 Result::Result(std::shared_ptr<Task> task, bool isValid)
-    : task_(task), 
+    : state_(std::allocate_shared<State>(PoolAllocator<State>())),
+      task_(task),
       isValid_(isValid) {
       task_->setResult(this);
 }
 
 Any Result::get() {
     if (!isValid_) {
-        return NULL;
+        return Any();
     }
-    sem_.wait();
-    return std::move(any_);
+    std::atomic_uint& status = state_->status_;
+    unsigned s = status.load(std::memory_order_acquire);
+    if (!(s & State::READY)) {
+        s = status.fetch_or(State::WAITING, std::memory_order_acq_rel) | State::WAITING;
+        while (!(s & State::READY)) {
+            status.wait(s, std::memory_order_acquire);
+            s = status.load(std::memory_order_acquire);
+        }
+    }
+    return std::move(state_->any_);
+}
+
+bool Result::ready() const {
+    return isValid_ && (state_->status_.load(std::memory_order_acquire) & State::READY);
+}
+
+bool Result::cancelled() const {
+    return isValid_ && (state_->status_.load(std::memory_order_acquire) & State::CANCELLED);
+}
+
+bool Result::rejected() const {
+    return !isValid_ || (state_->status_.load(std::memory_order_acquire) & State::REJECTED);
 }
 
 void Result::setVal(Any any) {
-    this->any_ = std::move(any);
-    sem_.post();
-}
\ No newline at end of file
+    state_->setVal(std::move(any));
+}
+
+// 延续任务  以前一个Result的返回值为参数执行用户函数
+class ThenTask : public Task {
+public:
+    ThenTask(std::function<Any(Any)> func, std::shared_ptr<Any> arg)
+        : func_(std::move(func)),
+          arg_(std::move(arg)) {
+    }
+
+    Any run() {
+        return func_(std::move(*arg_));
+    }
+
+private:
+    std::function<Any(Any)> func_;
+    std::shared_ptr<Any> arg_;
+};
+
+Result Result::then(std::function<Any(Any)> func) {
+    // 参数指向本Result的返回值，别名构造保证返回值在延续任务执行前不被释放
+    auto next = makeTask<ThenTask>(std::move(func), std::shared_ptr<Any>(state_, &state_->any_));
+    if (!isValid_) {
+        return Result(std::move(next), false);
+    }
+
+    // 返回值只能交给一个延续任务，第二次注册的延续任务不执行
+    if (state_->status_.fetch_or(State::CLAIMED, std::memory_order_acq_rel) & State::CLAIMED) {
+        return Result(std::move(next), false);
+    }
+
+    Result res(next);
+    res.state_->pool_ = state_->pool_;
+
+    // 先写入延续任务再设置标记；标记之前返回值已就绪则由本线程提交，否则由setVal提交
+    state_->next_ = next;
+    unsigned s = state_->status_.fetch_or(State::CHAINED, std::memory_order_acq_rel);
+    if (s & State::READY) {
+        state_->next_.reset();
+        state_->pool_->post(std::move(next));
+    }
+    return res;
+}
+
+Result::Awaiter Result::operator co_await() {
+    return Awaiter(*this);
+}
+
+Result::Awaiter::Awaiter(Result& res)
+    : res_(res),
+      chained_(false) {
+}
+
+// 无效的Result(提交失败)不挂起，直接得到空的返回值
+bool Result::Awaiter::await_ready() const {
+    return !res_.isValid_ || res_.ready();
+}
+
+// 返回值就绪后延续任务先取走返回值再恢复协程；恢复之后协程帧(含本对象)可能已经释放，不再访问成员
+// 已经注册过延续任务时不挂起
+bool Result::Awaiter::await_suspend(std::coroutine_handle<> h) {
+    chained_ = true;
+    Result next = res_.then([this, h](Any any) {
+        value_ = std::move(any);
+        h.resume();
+        return Any();
+    });
+    if (!next.isValid_) {
+        chained_ = false;
+        return false;
+    }
+    return true;
+}
+
+// 返回值已交给其他延续任务时结果为空
+Any Result::Awaiter::await_resume() {
+    if (chained_) {
+        return std::move(value_);
+    }
+    if (res_.isValid_ && (res_.state_->status_.load(std::memory_order_acquire) & State::CLAIMED)) {
+        return Any();
+    }
+    return res_.get();
+}
+
+void Result::State::setVal(Any any, unsigned flags) {
+    any_ = std::move(any);
+    unsigned s = status_.fetch_or(flags, std::memory_order_acq_rel);
+    if (s & WAITING) {
+        status_.notify_all();
+    }
+    if (s & CHAINED) {
+        std::shared_ptr<Task> next = std::move(next_);
+        pool_->post(std::move(next));
+    }
+}
@@ -10,127 +10,241 @@
 #include <condition_variable>
 #include <functional>
 #include <unordered_map>
+#include <coroutine>
+#include <new>
+#include <type_traits>
+
+#include "threadpool_base.h"
+#include "pool_allocator.h"
+#include "cancellation.h"
 
 // Any类型 可以接受任意的数据类型
+// 不超过INLINE_SIZE字节且可以无异常移动的数据(整数、std::string、std::vector等)直接存放在内部缓冲区中，
+// 更大的数据从内存块池分配；每种类型有一个操作表，操作表的地址即类型标记，取出数据时不需要RTTI
 class Any {
 public:
-    Any() = default;
-    ~Any() = default;
-    Any(Any&&) = default;  // 移动构造函数
-    Any& operator=(Any&&) = default;  // 移动赋值运算符
+    static constexpr size_t INLINE_SIZE = 32;
+
+    Any() noexcept : ops_(nullptr) {}
+
+    ~Any() {
+        reset();
+    }
+
+    Any(Any&& other) noexcept : ops_(other.ops_) {
+        if (ops_ != nullptr) {
+            ops_->move(other.buf_, buf_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Any& operator=(Any&& other) noexcept {
+        if (this != &other) {
+            reset();
+            ops_ = other.ops_;
+            if (ops_ != nullptr) {
+                ops_->move(other.buf_, buf_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
     Any(const Any&) = delete;
     Any& operator=(const Any&) = delete;
 
-    template<typename T>
-    Any(T data) : base_(std::make_unique<Drive<T>>(data)) {}
+    template<typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Any>>>
+    Any(T&& data) : ops_(nullptr) {
+        using D = std::decay_t<T>;
+        if constexpr (isInline<D>()) {
+            new (buf_) D(std::forward<T>(data));
+        } else {
+            *reinterpret_cast<D**>(buf_) = HeapOps<D>::create(std::forward<T>(data));
+        }
+        ops_ = opsOf<D>();
+    }
 
-    // 提取Any对象里面存储的data数据
+    // 提取Any对象里面存储的data数据  数据被移出而不是复制，类型不符(或为空)时抛出异常
     template<typename T>
     T cast_() {
-        Drive<T>* pd = dynamic_cast<Drive<T>*>(base_.get());
-        if (pd == nullptr) {
-            throw "type mismatch"; 
+        if (!is<T>()) {
+            throw "type mismatch";
         }
-        return pd->data_;
+        return std::move(*static_cast<T*>(ops_->get(buf_)));
     }
 
-private:
-    // 基类类型
-    class Base {
-    public:
-        virtual ~Base() = default;
-    private:
-
-    };
-
-    // 派生类类型
+    // 是否存放着T类型的数据
     template<typename T>
-    class Drive : public Base {
-    public:
-        Drive(T data) : data_(data) {}
-        T data_;
-    };
+    bool is() const {
+        return ops_ != nullptr && ops_ == opsOf<T>();
+    }
 
-    std::unique_ptr<Base> base_;  // 基类指针
-};
+    bool empty() const {
+        return ops_ == nullptr;
+    }
 
+private:
+    // 类型擦除后的操作表
+    struct Ops {
+        void* (*get)(void* buf);
+        void (*move)(void* from, void* to) noexcept;  // 移动到to并析构from
+        void (*destroy)(void* buf) noexcept;
+    };
 
-// 信号量类型
-class Semaphore {
-public:
-    Semaphore(int limits = 0) : resLimit_(limits) {}
-    ~Semaphore() = default;
-
-    // 移动构造函数
-    Semaphore(Semaphore&& other) noexcept
-        : resLimit_(other.resLimit_),
-          mutex_(),
-          cond_() {
+    template <typename D>
+    static constexpr bool isInline() {
+        return sizeof(D) <= INLINE_SIZE
+            && alignof(D) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<D>;
     }
 
-    // 移动赋值运算符
-    Semaphore& operator=(Semaphore&& other) noexcept {
-        if (this != &other) {
-            resLimit_ = other.resLimit_;
+    template <typename D>
+    struct InlineOps {
+        static void* get(void* buf) {
+            return buf;
         }
-        return *this;
-    }
+        static void move(void* from, void* to) noexcept {
+            new (to) D(std::move(*static_cast<D*>(from)));
+            static_cast<D*>(from)->~D();
+        }
+        static void destroy(void* buf) noexcept {
+            static_cast<D*>(buf)->~D();
+        }
+        static constexpr Ops ops = { &get, &move, &destroy };
+    };
 
-    void wait() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        cond_.wait(lock, [&]()->bool { return resLimit_ > 0; });
-        resLimit_--;
+    // 超过对齐要求的类型不经过内存块池
+    template <typename D>
+    struct HeapOps {
+        static constexpr bool POOLED = alignof(D) <= BlockPool::ALIGN;
+
+        template <typename T>
+        static D* create(T&& data) {
+            if constexpr (POOLED) {
+                void* p = BlockPool::allocate(sizeof(D));
+                try {
+                    return new (p) D(std::forward<T>(data));
+                } catch (...) {
+                    BlockPool::deallocate(p, sizeof(D));
+                    throw;
+                }
+            } else {
+                return new D(std::forward<T>(data));
+            }
+        }
+        static void* get(void* buf) {
+            return *static_cast<D**>(buf);
+        }
+        static void move(void* from, void* to) noexcept {
+            *static_cast<D**>(to) = *static_cast<D**>(from);
+        }
+        static void destroy(void* buf) noexcept {
+            D* p = *static_cast<D**>(buf);
+            if constexpr (POOLED) {
+                p->~D();
+                BlockPool::deallocate(p, sizeof(D));
+            } else {
+                delete p;
+            }
+        }
+        static constexpr Ops ops = { &get, &move, &destroy };
+    };
+
+    // 每种类型唯一的操作表，同时作为类型标记
+    template <typename D>
+    static const Ops* opsOf() {
+        if constexpr (isInline<D>()) {
+            return &InlineOps<D>::ops;
+        } else {
+            return &HeapOps<D>::ops;
+        }
     }
 
-    void post() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        resLimit_++;
-        cond_.notify_all();
+    void reset() noexcept {
+        if (ops_ != nullptr) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
+        }
     }
 
-private:
-    int resLimit_;
-    std::mutex mutex_;
-    std::condition_variable cond_;
+    alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE];
+    const Ops* ops_;
 };
 
 
 class Task;
+class ThreadPool;
 // Result类型  Result为Task执行完成后返回值类型
 class Result {
 public:
     Result(std::shared_ptr<Task> task, bool isValid = true);
     ~Result() = default;
 
-    // 移动构造函数
-    Result(Result&& other) noexcept
-        : any_(std::move(other.any_)),
-          sem_(std::move(other.sem_)),
-          task_(std::move(other.task_)),
-          isValid_(other.isValid_.load()) {
-    }
-
-    // 移动赋值运算符
-    Result& operator=(Result&& other) noexcept {
-        if (this != &other) {
-            any_ = std::move(other.any_);
-            sem_ = std::move(other.sem_);
-            task_ = std::move(other.task_);
-            isValid_ = other.isValid_.load();
-        }
-        return *this;
-    }
+    Result(Result&&) = default;
+    Result& operator=(Result&&) = default;
 
     // 
     void setVal(Any any_);
 
-    // 获取Task的返回值
+    // 获取Task的返回值  返回值已就绪时不加锁直接返回，否则在原子变量上等待(futex)
     Any get();
+
+    // 返回值是否已经就绪
+    bool ready() const;
+
+    // 任务是否被线程池拒绝而没有执行(提交时被过载策略拒绝、线程池已关闭，或在队列中被丢弃)
+    // 被拒绝的任务get()返回空的Any，已注册的延续任务照常执行，参数为空的Any
+    bool rejected() const;
+
+    // 任务是否被取消(令牌在开始前取消，或run()中抛出TaskCancelled)  被取消的任务get()返回空的Any
+    bool cancelled() const;
+
+    // 注册延续任务  返回值就绪后由线程池执行func，func的参数为本Result的返回值
+    // 不会有线程阻塞等待；注册后本Result的返回值交给func，不能再调用get()
+    // 返回值只能交给一个延续任务(co_await同样占用)，再次注册时func不会执行，返回被拒绝的Result
+    Result then(std::function<Any(Any)> func);
+
+    // 协程中co_await result  返回值就绪后由线程池中执行延续任务的线程恢复协程，等待期间不占用线程
+    // 结果为返回值Any；与then()相同，等待之后不能再调用get()；已经注册了延续任务时不挂起，结果为空的Any
+    class Awaiter {
+    public:
+        explicit Awaiter(Result& res);
+        bool await_ready() const;
+        bool await_suspend(std::coroutine_handle<> h);
+        Any await_resume();
+
+    private:
+        Result& res_;
+        Any value_;
+        bool chained_;
+    };
+
+    Awaiter operator co_await();
+
 private:
-    Any any_;
-    Semaphore sem_;
+    // 返回值状态  由Result和Task共同持有，Task可能在Result返回给用户之前就已执行完毕
+    struct State {
+        static const unsigned READY = 1;  // 返回值已就绪
+        static const unsigned WAITING = 2;  // 有线程在get()中等待
+        static const unsigned CHAINED = 4;  // 已注册延续任务
+        static const unsigned REJECTED = 8;  // 任务没有执行
+        static const unsigned CANCELLED = 16;  // 任务被取消
+        static const unsigned CLAIMED = 32;  // 返回值已交给延续任务(then或co_await)
+
+        Any any_;
+        std::atomic_uint status_{0};
+        std::shared_ptr<Task> next_;  // 延续任务
+        ThreadPool* pool_ = nullptr;  // 执行延续任务的线程池
+
+        void setVal(Any any, unsigned flags = READY);
+    };
+
+    std::shared_ptr<State> state_;
     std::shared_ptr<Task> task_;
-    std::atomic_bool isValid_;
+    bool isValid_;
+
+    friend class Task;
+    friend class ThreadPool;
 };
 
 
@@ -143,86 +257,60 @@ public:
     virtual Any run() = 0;
 
     void setResult(Result* res);
-    void exec();
-
-private:
-    Result* res_;
-};
-
 
-// 线程类型
-class Thread {
-public:
-    using ThreadFunc = std::function<void(int)>;
-
-    Thread(ThreadFunc func);
-    ~Thread();
+    // 执行任务  令牌已取消时不调用run()
+    void exec();
 
-    // 启动线程
-    void start();
+    // 任务没有执行就被丢弃，把Result标记为被拒绝
+    void reject();
 
-    // 查询线程id
-    int getId() const;
+    // 提交时传入的令牌是否已经取消  run()中轮询，或用throwIfCancelled()提前结束
+    bool isCancelled() const;
+    void throwIfCancelled() const;
 
 private:
-    ThreadFunc func_;
-    static int genId_;
-    int threadId_;
+    std::shared_ptr<Result::State> res_;
+    CancellationToken token_;
+
+    friend class ThreadPool;
 };
 
 
-// 线程池工作模式
-enum class PoolMode {
-    Mode_Fixed,
-    Mode_Cached,
-};
+// 创建任务对象  对象和引用计数一起从线程本地的内存块池分配，反复提交任务时不需要分配堆内存
+//   pool.submitTask(makeTask<MyTask>(1, 100));
+template <typename T, typename... Args>
+std::shared_ptr<T> makeTask(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
 
 
 // 线程池类型
-class ThreadPool {
+class ThreadPool : public ThreadPoolBase {
 public:
     ThreadPool();
-    ~ThreadPool();
+    ~ThreadPool() = default;
 
-    // 开启线程池
-    void start(size_t initThreadSize = std::thread::hardware_concurrency()); 
-
-    // 设置线程池的工作模式
-    void setMode(PoolMode mode);
+    // 提交任务至线程池  任务队列已满时按过载策略处理，任务被拒绝时返回的Result的rejected()为true
+    Result submitTask(std::shared_ptr<Task> sp);
 
-    // 设置线程数量上限(Cached模式下)
-    void setThreadSizeThreshold(size_t thread_Threshold);
+    // 按优先级和截止时间提交任务，同一优先级内截止时间早的先执行
+    Result submitTask(std::shared_ptr<Task> sp, TaskPriority priority, Deadline deadline = Deadline::max());
 
-    // 设置线程池的任务队列容量上限
-    void setTaskQueThreshold(size_t task_Threshold);
+    // 提交可以取消的任务  token在任务开始前取消时不执行，返回的Result的cancelled()为true
+    Result submitTask(std::shared_ptr<Task> sp, CancellationToken token);
 
-    // 提交任务至线程池
-    Result submitTask(std::shared_ptr<Task> sp);
+    // 不等待地提交任务  任务队列已满或线程池已关闭时不按过载策略处理，直接返回被拒绝的Result
+    Result trySubmit(std::shared_ptr<Task> sp);
 
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
+    // 批量提交任务至线程池  整批任务只加一次锁、只唤醒需要的线程数量
+    // 返回与每个任务一一对应的Result，被过载策略拒绝的任务对应被拒绝的Result
+    std::vector<Result> submitBatch(const std::vector<std::shared_ptr<Task>>& tasks);
 
 private:
-    PoolMode poolMode_;  // 线程池工作模式 
-    std::atomic_bool isRunning_;  // 线程池是否已经启动
-
-    std::unordered_map<int, std::unique_ptr<Thread>> threads_;  // 线程列表
-    size_t initThreadSize_;  // 初始线程数量
-    size_t threadSizeThreshold_;  // 线程数量上限(Cached模式下)
-    std::atomic_int idleThreadSize_;  // 空闲线程数量
-    std::atomic_int curThreadSize_;  // 当前线程数量
-
-    std::queue<std::shared_ptr<Task>> taskQue_;  // 任务队列
-    std::atomic_uint taskSize_;  // 任务数量
-    size_t taskQueThreshold_;  // 任务队列容量上限
-
-    std::mutex taskQueMutex_;  // 保证任务队列的线程安全
-    std::condition_variable notFull_;
-    std::condition_variable notEmpty_;
-    std::condition_variable exitCond_;  // 等带线程资源全部回收 
-
-    void threadFuc(int thread_id);  // 线程执行函数
-    bool checkState() const;  // 查询线程池运行状态
+    // 执行已经绑定了Result的任务(延续任务)，队列已满时在当前线程执行
+    void post(std::shared_ptr<Task> sp);
+
+    friend class Result;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,2257 @@
+#ifndef THREADPOOL_BASE_H
+#define THREADPOOL_BASE_H
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include <algorithm>
+#include <limits>
+#include <ctime>
+#include <coroutine>
+
+#include "workstealing_queue.h"
+#include "mpmc_queue.h"
+#include "ring_deque.h"
+#include "task_func.h"
+#include "tracer.h"
+#include "pool_stats.h"
+#include "priority_task_queue.h"
+#include "cpu_topology.h"
+#include "timer_wheel.h"
+#include "pool_allocator.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 调试日志  编译时定义THREADPOOL_DEBUG才输出，默认不产生任何代码
+#ifdef THREADPOOL_DEBUG
+#define THREADPOOL_LOG(expr) do { std::cout << expr << std::endl; } while (0)
+#else
+#define THREADPOOL_LOG(expr) do {} while (0)
+#endif
+
+const size_t THREAD_SIZE_THRESHOLD = 100;
+const int THREAD_MAX_IDEL_TIME = 10;  // Cached模式下多余线程的默认空闲回收时间(秒)
+const int TARGET_QUEUE_WAIT = 1000;  // Cached模式下任务的默认目标等待时间(微秒)
+const size_t TASK_POP_BATCH = 8;  // 线程每次从全局队列最多取走的任务数量
+const size_t SPIN_BUDGET = 1000;  // 线程休眠之前默认空转检查任务的次数
+const int TASK_AGING_TIME = 100;  // 低一级优先级的任务等待超过该时间(毫秒)后先于高一级执行
+const int SUBMIT_BLOCK_TIME = 1000;  // Overload_Block策略下提交者默认的最长等待时间(毫秒)
+const int HELP_SPINS = 64;  // 等待辅助组件的线程没有任务可帮忙时，在计数器上休眠之前让出CPU的次数
+
+
+// 线程类型
+class Thread {
+public:
+    using ThreadFunc = std::function<void(int)>;
+
+    Thread(ThreadFunc func)
+        : func_(func),
+          threadId_(genId_++) {
+    }
+
+    // 线程池总是先join再释放线程对象，这里只防止异常路径上析构可joinable的std::thread
+    ~Thread() {
+        if (thread_.joinable()) {
+            thread_.detach();
+        }
+    }
+
+    // 启动线程
+    void start() {
+        thread_ = std::thread(func_, threadId_);
+    }
+
+    // 等待线程结束
+    void join() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // 查询线程id
+    int getId() const {
+        return threadId_;
+    }
+
+private:
+    ThreadFunc func_;
+    std::thread thread_;
+    static inline std::atomic_int genId_{0};  // 多个线程池可能同时创建线程
+    int threadId_;
+};
+
+
+// 线程池工作模式
+enum class PoolMode {
+    Mode_Fixed,
+    Mode_Cached,
+};
+
+
+// 任务队列的调度方式
+enum class QueueMode {
+    Queue_Global,  // 所有线程共用一个全局任务队列
+    Queue_WorkStealing,  // 每个线程一个本地队列，空闲线程从其他线程窃取任务
+    Queue_LockFree,  // 全局任务队列使用无锁环形队列，容量为任务队列容量上限
+};
+
+
+// 关闭线程池时对队列中剩余任务的处理方式
+enum class ShutdownMode {
+    Shutdown_Drain,  // 执行完队列中的任务再退出，超时后剩余的任务按Shutdown_Discard处理
+    Shutdown_Discard,  // 不再执行队列中的任务，交还给调用者
+};
+
+
+// 任务队列已满时提交任务的处理策略
+enum class OverloadPolicy {
+    Overload_Block,  // 等待队列空余，超过设置的等待时间后拒绝(默认)
+    Overload_Fail,  // 立即拒绝
+    Overload_CallerRuns,  // 在提交者的线程中直接执行，提交速度自然受限于执行速度
+    Overload_DropOldest,  // 丢弃队列中最早的任务(最低优先级中)，放入新任务
+};
+
+
+// 任务优先级  同一优先级内有截止时间的任务按截止时间先后执行
+enum class TaskPriority {
+    Priority_High,  // 延迟敏感的任务，优先于本地队列和无锁队列中的普通任务
+    Priority_Normal,  // 默认优先级
+    Priority_Low,  // 后台任务
+};
+
+
+// 线程休眠时等待的事件  用法与std::binary_semaphore相同
+// libstdc++的try_acquire_until等待较久之后按退避间隔轮询，release后可能几十毫秒才返回，
+// 按定时器休眠的线程需要及时唤醒，所以Linux下直接用futex，其他平台用条件变量
+class WakeupEvent {
+public:
+#ifdef __linux__
+    // 有线程在等待时才需要系统调用唤醒
+    void release() {
+        if (state_.exchange(SIGNALED, std::memory_order_release) == WAITING) {
+            syscall(SYS_futex, &state_, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+        }
+    }
+
+    void acquire() {
+        while (!tryAcquireUntil(std::chrono::steady_clock::time_point::max())) {
+        }
+    }
+
+    // 到达deadline仍没有被release时返回false
+    bool tryAcquireUntil(std::chrono::steady_clock::time_point deadline) {
+        for (;;) {
+            uint32_t state = SIGNALED;
+            if (state_.compare_exchange_strong(state, EMPTY, std::memory_order_acquire)) {
+                return true;
+            }
+            if (state == EMPTY && !state_.compare_exchange_strong(state, WAITING, std::memory_order_relaxed)) {
+                continue;
+            }
+            timespec timeout;
+            timespec* ptimeout = nullptr;
+            if (deadline != std::chrono::steady_clock::time_point::max()) {
+                auto left = deadline - std::chrono::steady_clock::now();
+                if (left <= std::chrono::steady_clock::duration::zero()) {
+                    return false;
+                }
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+                timeout.tv_sec = ns / 1000000000;
+                timeout.tv_nsec = ns % 1000000000;
+                ptimeout = &timeout;
+            }
+            syscall(SYS_futex, &state_, FUTEX_WAIT_PRIVATE, WAITING, ptimeout, nullptr, 0);
+        }
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t SIGNALED = 1;
+    static constexpr uint32_t WAITING = 2;  // 有线程在futex上等待(或等待超时后留下的标记，只多一次唤醒调用)
+
+    std::atomic<uint32_t> state_{EMPTY};
+#else
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            signaled_ = true;
+        }
+        cond_.notify_one();
+    }
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [&]()->bool { return signaled_; });
+        signaled_ = false;
+    }
+
+    bool tryAcquireUntil(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cond_.wait_until(lock, deadline, [&]()->bool { return signaled_; })) {
+            return false;
+        }
+        signaled_ = false;
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool signaled_ = false;
+#endif
+};
+
+
+// 辅助组件(并行算法、任务组、strand等)尚未完成的作业计数  等待者用ThreadPoolBase::helpUntil等待归零
+// 计数归零之后等待者随时可能返回并销毁组件，因此最后一个作业在锁内减少计数并通知，等待者返回前获取同一把锁
+class CompletionCounter {
+public:
+    explicit CompletionCounter(size_t count = 0)
+        : count_(count) {
+    }
+
+    CompletionCounter(const CompletionCounter&) = delete;
+    CompletionCounter& operator=(const CompletionCounter&) = delete;
+
+    // 增加n个作业，返回增加之前的数量
+    size_t add(size_t n = 1) {
+        return count_.fetch_add(n, std::memory_order_acq_rel);
+    }
+
+    // 完成一个作业，返回是否为最后一个；返回true之后调用者不能再访问组件
+    bool done() {
+        size_t n = count_.load(std::memory_order_relaxed);
+        while (n > 1) {
+            if (count_.compare_exchange_weak(n, n - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return false;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            count_.notify_all();
+            return true;
+        }
+        return false;
+    }
+
+    size_t count() const {
+        return count_.load(std::memory_order_acquire);
+    }
+
+    // 计数不再等于n时返回(可能虚假返回)
+    void wait(size_t n) const {
+        count_.wait(n, std::memory_order_acquire);
+    }
+
+    // 等待最后一个作业通知完毕，之后可以销毁组件
+    void sync() {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+
+private:
+    std::atomic<size_t> count_;
+    std::mutex mutex_;
+};
+
+
+// 线程池的公共部分  负责线程管理、任务队列和线程执行函数
+// 不同的任务提交接口(Task/Result 和 future)由派生类提供
+class ThreadPoolBase {
+public:
+    using Job = TaskFunc;
+    using Deadline = std::chrono::steady_clock::time_point;  // 任务的截止时刻
+
+    ThreadPoolBase(size_t taskQueThreshold)
+        : poolMode_(PoolMode::Mode_Fixed),
+          queueMode_(QueueMode::Queue_Global),
+          affinity_(AffinityPolicy::Affinity_None),
+          isRunning_(false),
+          isStopped_(false),
+          isPaused_(false),
+          isDiscarding_(false),
+          retireRequests_(0),
+          blockedSize_(0),
+          compensating_(0),
+          initThreadSize_(0),
+          threadSizeThreshold_(THREAD_SIZE_THRESHOLD),
+          threadSizeMin_(std::numeric_limits<size_t>::max()),
+          keepAliveTime_(std::chrono::seconds(THREAD_MAX_IDEL_TIME)),
+          targetQueueWait_(TARGET_QUEUE_WAIT),
+          idleThreadSize_(0),
+          curThreadSize_(0),
+          parkedSize_(0),
+          spinningSize_(0),
+          spinBudget_(defaultThreadSize() > 1 ? SPIN_BUDGET : 0),
+          taskQue_(uint64_t(TASK_AGING_TIME) * 1000000),
+          agingTime_(TASK_AGING_TIME),
+          urgentTaskSize_(0),
+          lowAgedAt_(NO_DEADLINE),
+          taskSize_(0),
+          globalTaskSize_(0),
+          taskQueThreshold_(taskQueThreshold),
+          waitSubmitSize_(0),
+          queueHighWater_(0),
+          threadsSpawned_(0),
+          threadsRetired_(0),
+          threadsCompensated_(0),
+          submitTimeouts_(0),
+          submitRejected_(0),
+          callerRuns_(0),
+          tasksDropped_(0),
+          overloadPolicy_(OverloadPolicy::Overload_Block),
+          blockTime_(SUBMIT_BLOCK_TIME),
+          sizerParked_(false),
+          sizerWake_(false),
+          timers_(std::make_shared<TimerQueue>()),
+          nextTimerNs_(TimerQueue::NO_TIMER),
+          timekeeper_(NO_SLOT),
+          keeperDeadlineNs_(TimerQueue::NO_TIMER) {
+        timers_->epochNs_ = nowNs();
+    }
+
+    // 执行完队列中的任务，等待所有线程退出
+    ~ThreadPoolBase() {
+        shutdown(ShutdownMode::Shutdown_Drain);
+    }
+
+    // 默认线程数量  进程可用的CPU数量(受taskset和cpuset限制)，并且不超过cgroup的CPU配额
+    static size_t defaultThreadSize() {
+        static const size_t size = CpuTopology::detect().defaultThreadSize();
+        return size;
+    }
+
+    // 开启线程池
+    void start(size_t initThreadSize = defaultThreadSize()) {
+        // 设置线程池运行状态
+        isRunning_ = true;
+
+        // 初始化线程数量  线程数量下限默认等于初始线程数量，设置了更大的下限时按下限启动
+        if (threadSizeMin_ == std::numeric_limits<size_t>::max()) {
+            threadSizeMin_ = initThreadSize;
+        }
+        initThreadSize_ = std::max(initThreadSize, poolMode_ == PoolMode::Mode_Cached ? threadSizeMin_.load() : 0);
+        curThreadSize_ = initThreadSize_;
+
+        // 每个线程占用一个工作槽位，按线程数量上限预留，扩充和resize时槽位地址保持不变
+        size_t slotSize = std::max(initThreadSize_, threadSizeThreshold_);
+        for (size_t i = 0; i < slotSize; i++) {
+            slots_.emplace_back(std::make_unique<WorkerSlot>());
+        }
+        parked_.reserve(slotSize);
+        placeSlots();
+
+        // 无锁模式下按当前的任务队列容量上限创建环形队列，之前提交的任务留在全局队列中
+        if (queueMode_ == QueueMode::Queue_LockFree) {
+            ringQue_ = std::make_unique<MPMCQueue<QueuedJob>>(taskQueThreshold_);
+        }
+
+        // 创建线程对象
+        std::vector<int> ids;
+        for (size_t i = 0; i < initThreadSize_; i++) {
+            ids.push_back(createThread(i));
+        }
+        // 启动所有线程
+        for (int id : ids) {
+            startThread(threads_[id].get());
+            idleThreadSize_++;
+        }
+
+        // Cached模式下由单独的控制线程负责创建新线程
+        if (poolMode_ == PoolMode::Mode_Cached) {
+            sizer_ = std::thread(&ThreadPoolBase::sizerFuc, this);
+        }
+    }
+
+    // 运行时调整线程数量  增加时立即创建线程，减少时多余的线程执行完当前任务后退出，本地队列中的任务转入全局队列
+    // 线程数量不超过线程数量上限(start时按上限预留工作槽位)；Cached模式下同时把线程数量下限设为n
+    void resize(size_t n) {
+        if (!isRunning_) {
+            return ;
+        }
+        std::vector<Thread*> created;
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            n = std::min(std::max<size_t>(n, 1), slots_.size());
+            if (poolMode_ == PoolMode::Mode_Cached) {
+                threadSizeMin_ = n;
+            }
+            size_t current = size_t(std::max(curThreadSize_.load(), 0));
+            size_t retiring = retireRequests_;
+            size_t target = current - retiring;  // 不含已经要求退出的线程和为阻塞区间补充的线程
+            target -= std::min(compensating_, target);
+            if (n < target) {
+                retireRequests_ += target - n;
+            } else if (n > target) {
+                // 先撤销尚未执行的退出请求，再创建新线程
+                size_t cancel = std::min(retiring, n - target);
+                retireRequests_ -= cancel;
+                for (size_t i = target + cancel; i < n; i++) {
+                    size_t slot = freeSlot();
+                    if (slot >= slots_.size()) {
+                        break;
+                    }
+                    int thread_id = createThread(slot);
+                    created.push_back(threads_[thread_id].get());
+                    curThreadSize_++;
+                    idleThreadSize_++;
+                }
+            }
+        }
+        for (Thread* t : created) {
+            startThread(t);
+        }
+        if (retireRequests_ > 0) {
+            wakeAll();
+            std::lock_guard<std::mutex> lock(pauseMutex_);
+            pauseCond_.notify_all();
+        }
+        if (currentPool_ != this) {
+            reapThreads();
+        }
+    }
+
+    // 暂停取出任务  正在执行的任务不受影响，之后提交的任务留在队列中，直到resume
+    // 暂停期间辅助组件(任务组、并行算法等)的作业不放入队列，在提交者的线程中执行
+    void pause() {
+        isPaused_ = true;
+    }
+
+    // 恢复取出任务
+    void resume() {
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex_);
+            isPaused_ = false;
+            pauseCond_.notify_all();
+        }
+        notifyWaiting(taskSize_);
+        requestThreads();
+    }
+
+    // 关闭线程池，等待所有线程退出并join，返回没有执行的任务
+    // Shutdown_Drain最多等待timeout让线程执行完队列中的任务，超时后其余任务不再执行；
+    // 之后只等待正在执行的任务结束，关闭的耗时不超过timeout加上最长的单个任务
+    // 辅助组件(任务组、strand、I/O反应器等)的作业不会放弃，仍由工作线程执行完，不计入上面的耗时上限
+    // 关闭后提交任务都会失败，线程池不能再次start；重复调用时返回空
+    std::vector<Job> shutdown(ShutdownMode mode = ShutdownMode::Shutdown_Drain,
+                              std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) {
+        std::vector<Job> discarded;
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            if (isStopped_) {
+                return discarded;
+            }
+            isStopped_ = true;
+            isRunning_ = false;
+            notFull_.notify_all();
+        }
+        clearTimers();
+        {
+            std::lock_guard<std::mutex> lock(sizerMutex_);
+            sizerCond_.notify_all();
+        }
+        if (sizer_.joinable()) {
+            sizer_.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(pauseMutex_);
+            isPaused_ = false;
+            pauseCond_.notify_all();
+        }
+
+        if (mode == ShutdownMode::Shutdown_Discard) {
+            discardTasks(discarded);
+        }
+
+        // 唤醒所有休眠的线程，执行完剩余任务(或放弃剩余任务)后退出
+        wakeAll();
+        {
+            std::unique_lock<std::mutex> lock(taskQueMutex_);
+            auto exited = [&]()->bool { return threads_.size() == 0; };
+            if (timeout == std::chrono::milliseconds::max()) {
+                exitCond_.wait(lock, exited);
+            } else if (!exitCond_.wait_for(lock, timeout, exited)) {
+                lock.unlock();
+                discardTasks(discarded);
+                wakeAll();
+                lock.lock();
+                exitCond_.wait(lock, exited);
+            }
+        }
+        reapThreads();
+
+        // 没有启动过的线程池或者并发提交留下的任务，内部作业在当前线程执行
+        std::vector<QueuedJob> internal;
+        collectTasks(discarded, internal);
+        for (QueuedJob& task : internal) {
+            uint64_t execNs = runTask(externalCounters_, task);
+            externalCounters_.addBusy(execNs);
+        }
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            for (Job& job : discardedLate_) {
+                discarded.push_back(std::move(job));
+            }
+            discardedLate_.clear();
+        }
+        return discarded;
+    }
+
+    // 设置线程的CPU绑定策略  Affinity_Explicit时按cpus依次绑定，线程多于CPU时循环使用
+    // 绑定后窃取任务和唤醒线程时优先选择共享末级缓存(其次是同一NUMA节点)的线程
+    void setAffinity(AffinityPolicy policy, std::vector<int> cpus = {}) {
+        if (checkState()) {
+            return ;
+        }
+        affinity_ = policy;
+        affinityCpus_ = std::move(cpus);
+    }
+
+    // 每个工作槽位的线程绑定的逻辑CPU，没有绑定时为-1
+    std::vector<int> workerCpus() const {
+        std::vector<int> cpus;
+        for (const auto& slot : slots_) {
+            cpus.push_back(slot->cpu_);
+        }
+        return cpus;
+    }
+
+    // 设置线程池的工作模式
+    void setMode(PoolMode mode) {
+        if (checkState()) {
+            return ;
+        }
+        poolMode_ = mode;
+    }
+
+    // 设置任务队列的调度方式
+    void setQueueMode(QueueMode mode) {
+        if (checkState()) {
+            return ;
+        }
+        queueMode_ = mode;
+    }
+
+    // 设置线程数量上限  start时按它预留工作槽位，resize和阻塞区间补充的线程在所有模式下都不超过它，
+    // Cached模式下同时限制按积压扩充的线程(Fixed模式下不再忽略这个设置)
+    void setThreadSizeThreshold(size_t thread_Threshold) {
+        if (checkState()) {
+            return ;
+        }
+        threadSizeThreshold_ = thread_Threshold;
+    }
+
+    // 设置线程数量下限(Cached模式下)  空闲线程不会回收到下限以下，默认等于初始线程数量
+    void setThreadSizeMin(size_t threadSizeMin) {
+        if (checkState()) {
+            return ;
+        }
+        threadSizeMin_ = threadSizeMin;
+    }
+
+    // 设置多余线程的空闲回收时间(Cached模式下)
+    void setKeepAliveTime(std::chrono::milliseconds keepAlive) {
+        if (checkState()) {
+            return ;
+        }
+        keepAliveTime_ = keepAlive;
+    }
+
+    // 设置任务的目标等待时间(Cached模式下)  最近完成的任务等待时间超过它且有积压时才创建新线程
+    void setTargetQueueWait(std::chrono::microseconds wait) {
+        if (checkState()) {
+            return ;
+        }
+        targetQueueWait_ = wait;
+    }
+
+    // 设置线程休眠之前空转检查任务的次数  空转期间新任务不需要唤醒线程，为0时没有任务立即休眠
+    // 默认在多核机器上为SPIN_BUDGET，单核机器上为0
+    void setSpinBudget(size_t spinBudget) {
+        if (checkState()) {
+            return ;
+        }
+        spinBudget_ = spinBudget;
+    }
+
+    // 设置优先级老化时间  低一级的任务等待超过该时间后先于高一级的任务执行，低两级为两倍，以此类推
+    void setAgingTime(std::chrono::milliseconds agingTime) {
+        if (checkState()) {
+            return ;
+        }
+        agingTime_ = agingTime;
+        taskQue_.setAgingTime(std::chrono::duration_cast<std::chrono::nanoseconds>(agingTime).count());
+    }
+
+    // 设置任务队列已满时的处理策略  blockTime为Overload_Block策略下提交者的最长等待时间
+    void setOverloadPolicy(OverloadPolicy policy,
+                           std::chrono::milliseconds blockTime = std::chrono::milliseconds(SUBMIT_BLOCK_TIME)) {
+        if (checkState()) {
+            return ;
+        }
+        overloadPolicy_ = policy;
+        blockTime_ = blockTime;
+    }
+
+    // 设置线程池的任务队列容量上限，按全局队列、本地队列和环形队列中的任务总数计算(无锁模式下需在start之前设置)
+    void setTaskQueThreshold(size_t task_Threshold) {
+        taskQueThreshold_ = task_Threshold;
+    }
+
+    // 设置定时任务的精度(时间轮每个刻度的长度，需在start之前设置)  任务在到期后的第一个刻度触发，默认1毫秒
+    void setTimerResolution(std::chrono::microseconds resolution) {
+        if (checkState()) {
+            return ;
+        }
+        std::lock_guard<std::mutex> lock(timers_->mutex_);
+        timers_->resolutionNs_ = std::max<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(resolution).count(), 1);
+    }
+
+    // 在time时刻把func提交到线程池  定时器由工作线程维护，不为定时任务创建或占用线程
+    // 返回的句柄用于取消；线程池关闭时尚未到期的定时任务不再执行；func抛出的异常不会被捕获
+    template <typename Func>
+    TimerHandle submitAt(Deadline time, Func&& func) {
+        return addTimer(toNs(time), 0, TaskFunc(std::forward<Func>(func)));
+    }
+
+    template <typename Func, typename Rep, typename Period>
+    TimerHandle submitAfter(std::chrono::duration<Rep, Period> delay, Func&& func) {
+        return addTimer(nowNs() + toNs(delay), 0, TaskFunc(std::forward<Func>(func)));
+    }
+
+    // 每隔period执行一次func，第一次在period之后  下一次从本次的到期时刻算起，执行时间超过周期时跳过错过的次数，同一个定时任务不会并发执行
+    template <typename Func, typename Rep, typename Period>
+    TimerHandle submitEvery(std::chrono::duration<Rep, Period> period, Func&& func) {
+        uint64_t periodNs = std::max<uint64_t>(toNs(period), 1);
+        return addTimer(nowNs() + periodNs, periodNs, TaskFunc(std::forward<Func>(func)));
+    }
+
+    ThreadPoolBase(const ThreadPoolBase&) = delete;
+    ThreadPoolBase& operator=(const ThreadPoolBase&) = delete;
+
+    // 当前线程数量
+    size_t threadSize() const {
+        return curThreadSize_;
+    }
+
+    // co_await pool.schedule()  把当前协程交给线程池，由工作线程恢复执行，挂起期间不占用线程
+    // 恢复协程的作业不受任务队列上限限制，总是放入队列；只有线程池已关闭时不挂起，协程在当前线程继续执行
+    class ScheduleAwaiter {
+    public:
+        ScheduleAwaiter(ThreadPoolBase& pool, TaskPriority priority)
+            : pool_(pool),
+              priority_(priority) {
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            Job job = [h]() { h.resume(); };
+            return pool_.pushInternal(job, priority_);
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        ThreadPoolBase& pool_;
+        TaskPriority priority_;
+    };
+
+    ScheduleAwaiter schedule(TaskPriority priority = TaskPriority::Priority_Normal) {
+        return ScheduleAwaiter(*this, priority);
+    }
+
+    // 提交辅助组件(任务组、并行算法、strand、I/O反应器等)的作业  任务队列已满时不等待，返回false且job保持不变，由调用者自行处理
+    // 这些作业不会被Overload_DropOldest丢弃，Shutdown_Discard时也照常执行，否则组件等待的计数永远不会归零
+    // 线程池尚未启动、已暂停或已关闭时也返回false，由调用者在当前线程执行，等待的组件不会因为没有线程取任务而卡住
+    bool tryPost(Job& job) {
+        if (!isRunning_ || isPaused_) {
+            return false;
+        }
+        return pushTask(job, std::chrono::milliseconds(0), TaskPriority::Priority_Normal, Deadline::max(), true);
+    }
+
+    // 在当前线程执行一个等待中的任务(本地队列、全局队列或窃取)，没有任务时返回false
+    // 等待子任务完成的线程用它帮忙执行任务，而不是阻塞
+    bool runPendingTask() {
+        if (slots_.empty()) {
+            return false;
+        }
+        QueuedJob task;
+        size_t slot = currentPool_ == this ? currentSlot_ : slots_.size();
+        if (!tryAcquireTask(slot, task)) {
+            return false;
+        }
+        if (slot < slots_.size()) {
+            // 工作线程在执行任务的过程中帮忙，忙碌时间已计入外层任务
+            runTask(slots_[slot]->counters_, task);
+        } else {
+            uint64_t execNs = runTask(externalCounters_, task);
+            externalCounters_.addBusy(execNs);
+        }
+        return true;
+    }
+
+    // 等待辅助组件的计数归零，期间先执行own()提供的组件自己的任务(没有时返回false)，再执行线程池中的任务
+    // 都没有时先让出CPU，再在计数器上等待；返回时最后一个作业已通知完毕，可以销毁组件
+    template <typename Work>
+    void helpUntil(CompletionCounter& counter, Work&& own) {
+        int spins = 0;
+        for (;;) {
+            size_t n = counter.count();
+            if (n == 0) {
+                break;
+            }
+            if (own() || runPendingTask()) {
+                spins = 0;
+            } else if (++spins < HELP_SPINS) {
+                std::this_thread::yield();
+            } else {
+                counter.wait(n);
+            }
+        }
+        counter.sync();
+    }
+
+    void helpUntil(CompletionCounter& counter) {
+        helpUntil(counter, []() { return false; });
+    }
+
+    // 阻塞区间  任务中不可避免的阻塞调用(旧的数据库客户端、文件锁等)放在其中，进入时立即补充一个线程，
+    // 保持不阻塞的线程数量不变；离开时多出一个线程，由最先到达任务间隙的线程退出
+    // 只在本线程池的工作线程中生效，嵌套时只计最外层；补充的线程数量受预留的工作槽位(线程数量上限)限制
+    // 进入时可能创建一个系统线程，适合毫秒级以上的阻塞
+    //   ThreadPool::BlockingScope scope(pool);
+    //   db.query(sql);
+    class BlockingScope {
+    public:
+        explicit BlockingScope(ThreadPoolBase& pool)
+            : pool_(pool.beginBlocking() ? &pool : nullptr) {
+        }
+
+        // 使用当前工作线程所属的线程池，不在工作线程中时什么也不做
+        BlockingScope()
+            : pool_(currentPool_ != nullptr && currentPool_->beginBlocking() ? currentPool_ : nullptr) {
+        }
+
+        ~BlockingScope() {
+            if (pool_ != nullptr) {
+                pool_->endBlocking();
+            }
+        }
+
+        BlockingScope(const BlockingScope&) = delete;
+        BlockingScope& operator=(const BlockingScope&) = delete;
+
+    private:
+        ThreadPoolBase* pool_;
+    };
+
+    // 在阻塞区间中执行func，返回func的返回值
+    template <typename Func>
+    auto blocking(Func&& func) -> decltype(func()) {
+        BlockingScope scope(*this);
+        return std::forward<Func>(func)();
+    }
+
+    // 获取运行统计的快照  统计一直开启，每个任务只在提交、开始和结束时各读一次时钟
+    PoolStats stats() const {
+        PoolStats stats;
+        stats.workers_.reserve(slots_.size());
+        for (const auto& slot : slots_) {
+            stats.workers_.push_back(slot->counters_.snapshot());
+            stats.total_.merge(stats.workers_.back());
+        }
+        stats.external_ = externalCounters_.snapshot();
+        stats.total_.merge(stats.external_);
+
+        stats.threadSize_ = std::max(curThreadSize_.load(), 0);
+        stats.idleThreadSize_ = std::max(idleThreadSize_.load(), 0);
+        stats.blockedThreadSize_ = blockedSize_;
+        stats.taskSize_ = taskSize_;
+        stats.queueHighWater_ = queueHighWater_;
+        stats.threadsSpawned_ = threadsSpawned_;
+        stats.threadsRetired_ = threadsRetired_;
+        stats.threadsCompensated_ = threadsCompensated_;
+        stats.submitTimeouts_ = submitTimeouts_;
+        stats.submitRejected_ = submitRejected_;
+        stats.callerRuns_ = callerRuns_;
+        stats.tasksDropped_ = tasksDropped_;
+        return stats;
+    }
+
+    // 开启调度事件记录，每个线程最多保留eventsPerThread个最近的事件(需在start之前设置)
+    void enableTrace(size_t eventsPerThread = 65536) {
+        if (checkState()) {
+            return ;
+        }
+        tracer_ = std::make_unique<Tracer>(eventsPerThread);
+    }
+
+    // 以Chrome trace-event JSON格式输出记录的事件，没有开启记录时返回false
+    bool dumpTrace(std::ostream& os) {
+        if (!tracer_) {
+            return false;
+        }
+        tracer_->dump(os);
+        return true;
+    }
+
+protected:
+    // 按过载策略将任务放入任务队列  任务被拒绝(或线程池已关闭)时返回false且job保持不变
+    // Overload_CallerRuns策略下任务可能已在当前线程执行完毕，同样返回true
+    // internal为true时是线程池或辅助组件内部的作业(协程恢复、延续任务等)，不会被丢弃
+    bool pushTask(Job& job, TaskPriority priority = TaskPriority::Priority_Normal, Deadline deadline = Deadline::max(),
+                  bool internal = false) {
+        switch (overloadPolicy_) {
+        case OverloadPolicy::Overload_Block:
+            return pushTask(job, blockTime_, priority, deadline, internal);
+        case OverloadPolicy::Overload_Fail:
+            if (pushTask(job, std::chrono::milliseconds(0), priority, deadline, internal)) {
+                return true;
+            }
+            break;
+        case OverloadPolicy::Overload_CallerRuns:
+            if (pushTask(job, std::chrono::milliseconds(0), priority, deadline, internal)) {
+                return true;
+            }
+            if (!isStopped_) {
+                runInline(job);
+                return true;
+            }
+            break;
+        case OverloadPolicy::Overload_DropOldest:
+            if (pushTask(job, std::chrono::milliseconds(0), priority, deadline, internal)) {
+                return true;
+            }
+            if (pushDropOldest(job, priority, deadline, internal)) {
+                return true;
+            }
+            break;
+        }
+        if (!isStopped_) {
+            submitRejected_++;
+        }
+        return false;
+    }
+
+    // 将任务放入任务队列，任务队列已满时最多等待timeout；失败时返回false且job保持不变
+    // 指定了优先级或截止时间的任务总是放入全局的多级队列，普通任务走各调度方式的快速路径
+    bool pushTask(Job& job, std::chrono::milliseconds timeout,
+                  TaskPriority priority = TaskPriority::Priority_Normal, Deadline deadline = Deadline::max(),
+                  bool internal = false) {
+        if (isStopped_) {
+            return false;
+        }
+        uint64_t now = nowNs();
+        bool plain = priority == TaskPriority::Priority_Normal && deadline == Deadline::max();
+        if (!plain) {
+            return pushGlobal(job, timeout, now, priority, deadline, internal);
+        }
+
+        // 工作窃取模式下，线程池内部线程提交的任务直接放入该线程的本地队列
+        // 本地队列同样计入任务队列上限，已满时与外部线程一样放入全局队列，按过载策略等待或拒绝
+        if (queueMode_ == QueueMode::Queue_WorkStealing && currentPool_ == this && reserveTasks(1) == 1) {
+            slots_[currentSlot_]->taskQue_.push(QueuedJob{std::move(job), now, internal});
+            enqueued();
+
+            // 有线程在等待时唤醒一个来窃取
+            notifyWaiting();
+            requestThreads();
+            return true;
+        }
+
+        // 无锁模式下只有环形队列已满时才进入等待，start之前(还没有创建环形队列)放入全局队列
+        // Overload_DropOldest从环形队列的队首丢弃任务，内部作业改为放入全局队列，丢弃时可以跳过
+        if (queueMode_ == QueueMode::Queue_LockFree && ringQue_
+            && !(internal && overloadPolicy_ == OverloadPolicy::Overload_DropOldest)) {
+            if (!pushRing(job, now, internal)) {
+                std::unique_lock<std::mutex> lock(taskQueMutex_);
+                waitSubmitSize_++;
+                bool ok = false;
+                notFull_.wait_for(lock, timeout, [&]()->bool { return isStopped_ || (ok = pushRing(job, now, internal)); });
+                waitSubmitSize_--;
+                if (!ok) {
+                    if (timeout.count() > 0 && !isStopped_) {
+                        submitTimeouts_++;
+                    }
+                    return false;
+                }
+            }
+            enqueued();
+            notifyWaiting();
+            requestThreads();
+            return true;
+        }
+
+        return pushGlobal(job, timeout, now, priority, deadline, internal);
+    }
+
+    // 放入全局队列，任务数量(包括本地队列和环形队列中的任务)达到上限时最多等待timeout
+    // dropped不为空时不等待，而是取出最早的(非内部)任务放入dropped腾出位置，由调用者在锁外析构
+    // 全局队列中没有可丢弃的任务时从本地队列中丢弃
+    bool pushGlobal(Job& job, std::chrono::milliseconds timeout, uint64_t now, TaskPriority priority, Deadline deadline,
+                    bool internal = false, Job* dropped = nullptr) {
+        uint64_t deadlineNs = deadline == Deadline::max() ? NO_DEADLINE
+            : std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+
+        // 获取锁
+        std::unique_lock<std::mutex> lock(taskQueMutex_);
+
+        bool hints = priority != TaskPriority::Priority_Normal || deadlineNs != NO_DEADLINE;
+        QueuedJob oldest;
+        if (dropped != nullptr && !isStopped_ && taskSize_ >= taskQueThreshold_) {
+            bool global = taskQue_.popOldest(oldest, [](const QueuedJob& q) { return !q.internal_; });
+            if (global || dropLocal(oldest)) {
+                *dropped = std::move(oldest.job_);
+                taskSize_--;
+                if (global) {
+                    globalTaskSize_--;
+                }
+                tasksDropped_++;
+                hints = true;
+            }
+        }
+
+        // 线程通信 等待任务队列空余
+        waitSubmitSize_++;
+        bool ok = notFull_.wait_for(lock, timeout, [&]()->bool { return isStopped_ || taskSize_ < taskQueThreshold_; });
+        waitSubmitSize_--;
+        if (!ok || isStopped_) {
+            if (isStopped_) {
+                return false;
+            }
+            if (timeout.count() > 0) {
+                submitTimeouts_++;
+            }
+            return false;
+        }
+
+        // 任务队列空余，将任务加入队列
+        taskQue_.push(QueuedJob{std::move(job), now, internal}, size_t(priority), deadlineNs);
+        taskSize_++;
+        globalTaskSize_++;
+        if (hints) {
+            updateHints();
+        }
+        enqueued();
+        lock.unlock();
+
+        // 只唤醒一个休眠的线程
+        notifyWaiting();
+
+        // Cached模式下，任务数量超出空闲线程时交给控制线程判断是否需要创建新线程
+        requestThreads();
+        return true;
+    }
+
+    // 放入全局队列，不检查任务队列上限，只在线程池已关闭时返回false且job保持不变
+    // 用于恢复协程等不能被拒绝、也不能在提交者线程中执行的内部作业
+    bool pushInternal(Job& job, TaskPriority priority) {
+        std::unique_lock<std::mutex> lock(taskQueMutex_);
+        if (isStopped_) {
+            return false;
+        }
+        taskQue_.push(QueuedJob{std::move(job), nowNs(), true}, size_t(priority), NO_DEADLINE);
+        taskSize_++;
+        globalTaskSize_++;
+        if (priority != TaskPriority::Priority_Normal) {
+            updateHints();
+        }
+        enqueued();
+        lock.unlock();
+        notifyWaiting();
+        requestThreads();
+        return true;
+    }
+
+    // 按过载策略批量放入任务队列  返回被接受(放入队列或在当前线程执行)的任务数量，
+    // jobs中前面这些任务已被取走，其余被拒绝的任务保持不变
+    size_t pushBatch(std::vector<Job>& jobs) {
+        bool block = overloadPolicy_ == OverloadPolicy::Overload_Block;
+        size_t pushed = pushBatch(jobs, block ? blockTime_ : std::chrono::milliseconds(0));
+        if (block || isStopped_) {
+            return pushed;
+        }
+        for (; pushed < jobs.size(); pushed++) {
+            if (overloadPolicy_ == OverloadPolicy::Overload_CallerRuns) {
+                runInline(jobs[pushed]);
+            } else if (overloadPolicy_ != OverloadPolicy::Overload_DropOldest
+                       || !pushDropOldest(jobs[pushed], TaskPriority::Priority_Normal, Deadline::max())) {
+                break;
+            }
+        }
+        if (!isStopped_) {
+            submitRejected_ += jobs.size() - pushed;
+        }
+        return pushed;
+    }
+
+    // 批量放入任务队列  整批只加一次锁、只做一次线程扩充判断，并且只唤醒需要的线程数量
+    // 任务队列已满时最多等待timeout，等待超时则停止；返回成功放入的任务数量，jobs中前面这些任务已被取走
+    size_t pushBatch(std::vector<Job>& jobs, std::chrono::milliseconds timeout) {
+        size_t count = jobs.size();
+        if (count == 0 || isStopped_) {
+            return 0;
+        }
+        uint64_t now = nowNs();
+
+        // 线程池内部线程提交的批量任务在任务队列上限之内放入本地队列，其余的放入全局队列
+        size_t pushed = 0;
+        if (queueMode_ == QueueMode::Queue_WorkStealing && currentPool_ == this) {
+            pushed = reserveTasks(count);
+            for (size_t i = 0; i < pushed; i++) {
+                slots_[currentSlot_]->taskQue_.push(QueuedJob{std::move(jobs[i]), now});
+            }
+            if (pushed > 0) {
+                enqueued();
+                notifyWaiting(pushed);
+                requestThreads();
+            }
+            if (pushed == count) {
+                return count;
+            }
+        }
+
+        if (queueMode_ == QueueMode::Queue_LockFree && ringQue_) {
+            while (pushed < count && pushRing(jobs[pushed], now)) {
+                pushed++;
+            }
+            size_t notified = 0;
+            if (pushed < count) {
+                // 环形队列已满，先唤醒线程消费再等待空余
+                notifyWaiting(pushed);
+                notified = pushed;
+                std::unique_lock<std::mutex> lock(taskQueMutex_);
+                waitSubmitSize_++;
+                bool ok = true;
+                while (pushed < count && ok) {
+                    ok = false;
+                    notFull_.wait_for(lock, timeout, [&]()->bool { return isStopped_ || (ok = pushRing(jobs[pushed], now)); });
+                    if (!ok) {
+                        break;
+                    }
+                    pushed++;
+                    while (pushed < count && pushRing(jobs[pushed], now)) {
+                        pushed++;
+                    }
+                    notifyWaiting(pushed - notified);
+                    notified = pushed;
+                }
+                waitSubmitSize_--;
+            }
+            if (pushed < count && timeout.count() > 0 && !isStopped_) {
+                submitTimeouts_ += count - pushed;
+            }
+            enqueued();
+            notifyWaiting(pushed - notified);
+            requestThreads();
+            return pushed;
+        }
+
+        // 获取锁
+        std::unique_lock<std::mutex> lock(taskQueMutex_);
+        size_t n = 0;
+        waitSubmitSize_++;
+        while (pushed < count) {
+            if (!notFull_.wait_for(lock, timeout, [&]()->bool { return isStopped_ || taskSize_ < taskQueThreshold_; })
+                || isStopped_) {
+                if (timeout.count() > 0 && !isStopped_) {
+                    submitTimeouts_ += count - pushed;
+                }
+                break;
+            }
+            n = 0;
+            while (pushed < count && taskSize_ < taskQueThreshold_) {
+                taskQue_.push(QueuedJob{std::move(jobs[pushed++]), now}, size_t(TaskPriority::Priority_Normal));
+                taskSize_++;
+                n++;
+            }
+            globalTaskSize_ += n;
+
+            // 任务队列已满，先唤醒线程消费
+            if (pushed < count) {
+                notifyWaiting(n);
+                n = 0;
+            }
+        }
+        waitSubmitSize_--;
+
+        enqueued();
+        lock.unlock();
+
+        // 只唤醒与新任务数量相当的线程
+        notifyWaiting(n);
+
+        requestThreads();
+        return pushed;
+    }
+
+private:
+    // 队列中的任务  记录提交时刻，用于统计等待时间
+    struct QueuedJob {
+        Job job_;
+        uint64_t enqueueTime_ = 0;
+        bool internal_ = false;  // 线程池或辅助组件内部的作业，不会被丢弃
+    };
+
+    // 工作槽位  保存线程的本地任务队列和运行计数，避免与其他线程伪共享
+    struct alignas(64) WorkerSlot {
+        WorkStealingQueue<QueuedJob> taskQue_;  // 本地任务队列
+        WakeupEvent wakeup_;  // 线程休眠时在此等待，每次登记休眠最多被release一次
+        bool active_ = false;  // 是否有线程占用(由taskQueMutex_保护)
+        int cpu_ = -1;  // 绑定的逻辑CPU，-1为不绑定
+        int domain_ = -1;  // 所在的末级缓存，-1为未知
+        std::vector<size_t> stealOrder_;  // 窃取时依次检查的槽位，同一缓存、同一节点的在前
+        WorkerCounters counters_;  // 运行计数(线程退出后保留)
+    };
+
+    PoolMode poolMode_;  // 线程池工作模式
+    QueueMode queueMode_;  // 任务队列调度方式
+    AffinityPolicy affinity_;  // 线程的CPU绑定策略
+    std::vector<int> affinityCpus_;  // Affinity_Explicit的CPU列表
+    std::atomic_bool isRunning_;  // 线程池是否已经启动
+    std::atomic_bool isStopped_;  // 是否已经关闭，关闭后提交任务失败
+    std::atomic_bool isPaused_;  // 是否暂停取出任务
+    std::atomic_bool isDiscarding_;  // 关闭时是否放弃队列中剩余的任务
+    std::atomic<size_t> retireRequests_;  // resize(或阻塞区间结束)要求退出、尚未退出的线程数量
+    std::atomic<size_t> blockedSize_;  // 处于阻塞区间的线程数量(由taskQueMutex_保护写入)
+    size_t compensating_;  // 为阻塞区间补充、尚未要求退出的线程数量(由taskQueMutex_保护)
+
+    std::unordered_map<int, std::unique_ptr<Thread>> threads_;  // 线程列表
+    std::vector<std::unique_ptr<Thread>> exited_;  // 已经退出、尚未join的线程
+    std::vector<std::unique_ptr<WorkerSlot>> slots_;  // 工作槽位
+    std::atomic<size_t> usedSlots_{0};  // 使用过的槽位数量上界，窃取时只检查这些槽位
+    size_t initThreadSize_;  // 初始线程数量
+    size_t threadSizeThreshold_;  // 线程数量上限(预留的工作槽位数量)
+    std::atomic<size_t> threadSizeMin_;  // 线程数量下限(Cached模式下，resize时修改)
+    std::chrono::milliseconds keepAliveTime_;  // 多余线程的空闲回收时间(Cached模式下)
+    std::chrono::microseconds targetQueueWait_;  // 任务的目标等待时间(Cached模式下)
+    std::atomic_int idleThreadSize_;  // 空闲线程数量
+    std::atomic_int curThreadSize_;  // 当前线程数量
+    std::atomic_int parkedSize_;  // 休眠的线程数量
+    std::atomic_int spinningSize_;  // 正在空转等待任务的线程数量
+    size_t spinBudget_;  // 线程休眠之前空转检查任务的次数
+
+    static constexpr uint64_t NO_DEADLINE = PriorityTaskQueue<QueuedJob, 3>::NO_DEADLINE;
+
+    PriorityTaskQueue<QueuedJob, 3> taskQue_;  // 全局任务队列(按TaskPriority分级)
+    std::chrono::milliseconds agingTime_;  // 优先级老化时间
+    std::atomic<size_t> urgentTaskSize_;  // 全局队列中的高优先级任务和带截止时间的普通任务数量
+    std::atomic<uint64_t> lowAgedAt_;  // 全局队列中最早的低优先级任务开始老化的时刻
+    std::atomic_uint taskSize_;  // 任务数量(全局队列和所有本地队列)
+    std::atomic_uint globalTaskSize_;  // 全局队列中的任务数量
+    size_t taskQueThreshold_;  // 任务队列容量上限(全局队列、本地队列和环形队列中的任务总数)
+    std::unique_ptr<MPMCQueue<QueuedJob>> ringQue_;  // 无锁环形任务队列(Queue_LockFree模式)
+    std::atomic_int waitSubmitSize_;  // 在notFull_上等待的提交者数量
+
+    WorkerCounters externalCounters_{true};  // 线程池外部线程帮忙执行任务的运行计数(多个线程共用)
+    std::atomic_uint queueHighWater_;  // 任务数量的历史最大值
+    std::atomic<uint64_t> threadsSpawned_;  // Cached模式下扩充创建的线程数量
+    std::atomic<uint64_t> threadsRetired_;  // Cached模式下空闲超时退出的线程数量
+    std::atomic<uint64_t> threadsCompensated_;  // 为阻塞区间补充创建的线程数量
+    std::atomic<uint64_t> submitTimeouts_;  // 提交超时失败的任务数量
+    std::atomic<uint64_t> submitRejected_;  // 队列已满被立即拒绝的任务数量
+    std::atomic<uint64_t> callerRuns_;  // 队列已满在提交者线程中执行的任务数量
+    std::atomic<uint64_t> tasksDropped_;  // 为新任务腾出位置而丢弃的任务数量
+    std::vector<Job> discardedLate_;  // 放弃剩余任务之后工作线程取出的普通任务，由shutdown交还给调用者(由taskQueMutex_保护)
+    OverloadPolicy overloadPolicy_;  // 任务队列已满时的处理策略
+    std::chrono::milliseconds blockTime_;  // Overload_Block策略下提交者的最长等待时间
+
+    std::mutex taskQueMutex_;  // 保证任务队列的线程安全
+    std::condition_variable notFull_;
+    std::condition_variable exitCond_;  // 等带线程资源全部回收
+    std::mutex startMutex_;  // 启动线程与join已退出的线程互斥
+
+    std::mutex pauseMutex_;
+    std::condition_variable pauseCond_;  // 暂停期间线程在此等待
+
+    std::mutex parkMutex_;  // 保护parked_
+    std::vector<size_t> parked_;  // 休眠线程的槽位，后休眠的先唤醒(缓存更热)
+
+    std::thread sizer_;  // 线程数量控制线程(Cached模式下)
+    std::mutex sizerMutex_;
+    std::condition_variable sizerCond_;
+    std::atomic_bool sizerParked_;  // 控制线程没有积压可处理，正在等待唤醒
+    bool sizerWake_;  // 提交者请求控制线程检查(由sizerMutex_保护)
+
+    std::unique_ptr<Tracer> tracer_;  // 调度事件记录(默认关闭)
+
+    static constexpr size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+    std::shared_ptr<TimerQueue> timers_;  // 定时任务的时间轮
+    std::atomic<uint64_t> nextTimerNs_;  // 时间轮下一次需要处理的时刻(由timers_->mutex_保护写入)
+    std::atomic<size_t> timekeeper_;  // 休眠到下一次处理定时器的线程槽位，只有一个(由parkMutex_保护写入)
+    std::atomic<uint64_t> keeperDeadlineNs_;  // 该线程休眠到的时刻
+
+    static inline thread_local ThreadPoolBase* currentPool_ = nullptr;  // 当前线程所属的线程池
+    static inline thread_local size_t currentSlot_ = 0;  // 当前线程占用的工作槽位
+    static inline thread_local size_t blockingDepth_ = 0;  // 当前线程嵌套的阻塞区间层数
+
+    // 创建占用指定槽位的线程对象(不启动)
+    int createThread(size_t slot) {
+        slots_[slot]->active_ = true;
+        if (slot >= usedSlots_) {
+            usedSlots_.store(slot + 1, std::memory_order_release);
+        }
+        auto ptr = std::make_unique<Thread>([this, slot](int thread_id) { threadFuc(thread_id, slot); });
+        int thread_id = ptr->getId();
+        threads_.emplace(thread_id, std::move(ptr));
+        return thread_id;
+    }
+
+    // 按任务数量超出空闲线程的部分创建新线程，最多limit个，调用者需持有taskQueMutex_
+    // 返回新建的线程对象，由调用者释放锁之后再启动，创建系统线程时不阻塞提交者
+    std::vector<Thread*> growThreads(size_t limit) {
+        std::vector<Thread*> created;
+        while (created.size() < limit && taskSize_ > unsigned(std::max(idleThreadSize_.load(), 0)) && curThreadSize_ < int(threadSizeThreshold_)) {
+            size_t slot = freeSlot();
+            if (slot >= slots_.size()) {
+                break;
+            }
+            int thread_id = createThread(slot);
+            THREADPOOL_LOG("---Create new thread---");
+            trace(Tracer::Event::Spawn, thread_id);
+            created.push_back(threads_[thread_id].get());
+            curThreadSize_++;
+            idleThreadSize_++;
+            threadsSpawned_++;
+        }
+        return created;
+    }
+
+    // 当前工作线程进入阻塞区间  补充一个线程，有尚未执行的退出请求时撤销一个代替创建；不是本线程池的工作线程时返回false
+    bool beginBlocking() {
+        if (currentPool_ != this) {
+            return false;
+        }
+        if (blockingDepth_++ > 0) {
+            return true;
+        }
+        // 反正马上要阻塞，顺便join之前退出的线程，频繁进出阻塞区间时不积累线程对象
+        reapThreads();
+        Thread* created = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            blockedSize_++;
+            if (isRunning_ && compensating_ < blockedSize_) {
+                if (retireRequests_ > 0) {
+                    retireRequests_--;
+                    compensating_++;
+                } else {
+                    size_t slot = freeSlot();
+                    if (slot < slots_.size()) {
+                        int thread_id = createThread(slot);
+                        trace(Tracer::Event::Spawn, thread_id);
+                        created = threads_[thread_id].get();
+                        curThreadSize_++;
+                        idleThreadSize_++;
+                        compensating_++;
+                        threadsCompensated_++;
+                    }
+                }
+            }
+        }
+        if (created != nullptr) {
+            startThread(created);
+        } else if (taskSize_ > 0) {
+            // 本线程不再取任务，交给休眠的线程
+            notifyWaiting();
+        }
+        return true;
+    }
+
+    // 离开阻塞区间  要求一个线程退出，唤醒一个休眠的线程来响应，没有休眠的线程时由最先执行完任务的线程响应
+    void endBlocking() {
+        if (--blockingDepth_ > 0) {
+            return ;
+        }
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            blockedSize_--;
+            if (compensating_ <= blockedSize_) {
+                return ;
+            }
+            compensating_--;
+            // Cached模式下补充的线程可能已经空闲超时退出，不低于线程数量下限
+            if (!isRunning_ || (poolMode_ == PoolMode::Mode_Cached
+                    && size_t(std::max(curThreadSize_.load(), 0)) <= threadSizeMin_ + retireRequests_)) {
+                return ;
+            }
+            retireRequests_++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(parkMutex_);
+            if (!parked_.empty()) {
+                size_t slot = parked_.back();
+                parked_.pop_back();
+                parkedSize_--;
+                slots_[slot]->wakeup_.release();
+            }
+        }
+        if (isPaused_) {
+            std::lock_guard<std::mutex> lock(pauseMutex_);
+            pauseCond_.notify_all();
+        }
+    }
+
+    // 是否有超出空闲线程的积压任务且还能创建新线程
+    bool needThreads() const {
+        return !isPaused_ && taskSize_ > unsigned(std::max(idleThreadSize_.load(), 0)) && curThreadSize_ < int(threadSizeThreshold_);
+    }
+
+    // Cached模式下有积压任务时唤醒休眠的控制线程，控制线程在运行时只检查两个计数
+    void requestThreads() {
+        if (poolMode_ == PoolMode::Mode_Cached && sizerParked_ && needThreads()) {
+            std::lock_guard<std::mutex> lock(sizerMutex_);
+            sizerWake_ = true;
+            sizerCond_.notify_one();
+        }
+    }
+
+    // 所有线程的运行计数之和
+    WorkerStats totalStats() const {
+        WorkerStats total = externalCounters_.snapshot();
+        for (const auto& slot : slots_) {
+            total.merge(slot->counters_.snapshot());
+        }
+        return total;
+    }
+
+    // 线程数量控制线程(Cached模式下)
+    // 有积压任务时每隔一个目标等待时间采样一次：最近开始执行的任务的等待时间、完成的任务数量和进程占用的CPU时间
+    // 等待时间的90分位超过目标(或者没有任务开始执行)且CPU没有跑满时创建新线程，每次最多增加当前线程数的一半；
+    // CPU已经跑满时再加线程只会增加切换开销；扩充后吞吐量没有明显提高时，之后的扩充间隔加倍
+    // 没有积压时一直休眠，由提交者唤醒，不做周期性轮询
+    void sizerFuc() {
+        // 采样周期太短时CPU时间的误差很大，至少取10毫秒
+        const auto interval = std::max<std::chrono::microseconds>(targetQueueWait_, std::chrono::milliseconds(10));
+        const uint64_t targetNs = std::chrono::duration_cast<std::chrono::nanoseconds>(targetQueueWait_).count();
+        const double cores = double(defaultThreadSize());
+        WorkerStats last = totalStats();
+        uint64_t lastTime = nowNs();
+        std::clock_t lastCpu = std::clock();
+        double grownRate = -1;  // 上次扩充前的吞吐量，小于0表示上一轮没有扩充
+        size_t backoff = 1;  // 两次扩充之间至少间隔的采样次数
+        size_t sinceGrow = 0;
+
+        while (isRunning_) {
+            {
+                std::unique_lock<std::mutex> lock(sizerMutex_);
+                if (!needThreads()) {
+                    // 先标记休眠再检查积压，与提交者先计数再检查标记配对，不会错过唤醒
+                    sizerParked_ = true;
+                    sizerCond_.wait(lock, [&]()->bool { return !isRunning_ || sizerWake_ || needThreads(); });
+                    sizerParked_ = false;
+                    sizerWake_ = false;
+                    last = totalStats();
+                    lastTime = nowNs();
+                    lastCpu = std::clock();
+                    grownRate = -1;
+                    backoff = 1;
+                }
+                sizerCond_.wait_for(lock, interval, [&]()->bool { return !isRunning_; });
+            }
+            if (!isRunning_) {
+                break;
+            }
+
+            reapThreads();
+
+            // 本次采样周期内开始执行的任务
+            WorkerStats cur = totalStats();
+            uint64_t curTime = nowNs();
+            std::clock_t curCpu = std::clock();
+            uint64_t tasks = cur.tasksExecuted_ - last.tasksExecuted_;
+            LatencyHistogram wait = cur.queueWait_;
+            for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+                wait.counts_[i] -= last.queueWait_.counts_[i];
+            }
+            double elapsed = std::max<uint64_t>(curTime - lastTime, 1) / 1e9;
+            double rate = tasks / elapsed;
+            double cpuBusy = double(curCpu - lastCpu) / CLOCKS_PER_SEC / elapsed;  // 平均占用的CPU核数
+            last = cur;
+            lastTime = curTime;
+            lastCpu = curCpu;
+            sinceGrow++;
+
+            if (grownRate >= 0) {
+                backoff = rate > grownRate * 1.1 ? 1 : std::min<size_t>(backoff * 2, 64);
+                grownRate = -1;
+            }
+
+            bool stalled = tasks == 0;
+            if (!needThreads() || !(stalled || wait.percentile(0.9) > targetNs) || cpuBusy >= cores * 0.8
+                || (!stalled && sinceGrow < backoff)) {
+                continue;
+            }
+
+            std::vector<Thread*> created;
+            {
+                std::unique_lock<std::mutex> lock(taskQueMutex_);
+                if (!isRunning_) {
+                    break;
+                }
+                created = growThreads(std::max(curThreadSize_.load() / 2, 1));
+            }
+            for (Thread* t : created) {
+                startThread(t);
+            }
+            grownRate = rate;
+            sinceGrow = 0;
+        }
+    }
+
+    // 为count个新任务唤醒休眠的线程，每个任务最多唤醒一个
+    // 正在空转的线程会自己取到任务，不需要唤醒；调用者已先增加taskSize_，与休眠前的再次检查配对
+    void notifyWaiting(size_t count = 1) {
+        size_t spinning = std::max(spinningSize_.load(), 0);
+        count = count > spinning ? count - spinning : 0;
+        while (count > 0 && parkedSize_ > 0) {
+            size_t slot;
+            {
+                std::lock_guard<std::mutex> lock(parkMutex_);
+                if (parked_.empty()) {
+                    return ;
+                }
+                auto it = parked_.end() - 1;
+                if (currentPool_ == this && slots_[currentSlot_]->domain_ >= 0) {
+                    // 工作线程提交的任务在它的本地队列中，优先唤醒共享缓存的线程来窃取
+                    auto near = std::find_if(parked_.rbegin(), parked_.rend(), [&](size_t s) {
+                        return slots_[s]->domain_ == slots_[currentSlot_]->domain_;
+                    });
+                    if (near != parked_.rend()) {
+                        it = near.base() - 1;
+                    }
+                }
+                slot = *it;
+                parked_.erase(it);
+                parkedSize_--;
+            }
+            slots_[slot]->wakeup_.release();
+            count--;
+        }
+    }
+
+    // 没有任务时先空转检查spinBudget_次，期间出现任务则直接取走，省去休眠和唤醒的开销
+    bool spinForTask(size_t slot, QueuedJob& task) {
+        if (spinBudget_ == 0) {
+            return false;
+        }
+        spinningSize_++;
+        bool found = false;
+        for (size_t i = 0; i < spinBudget_ && isRunning_; i++) {
+            if (taskSize_ > 0 && tryAcquireTask(slot, task)) {
+                found = true;
+                break;
+            }
+            cpuRelax();
+        }
+        spinningSize_--;
+
+        // 提交者可能因为本线程在空转而没有唤醒其他线程，剩余的任务由本线程代为唤醒
+        if (found && taskSize_ > 0) {
+            notifyWaiting();
+        }
+        return found;
+    }
+
+    // 登记为休眠线程并在本槽位的信号量上等待，直到被唤醒或到达deadline
+    // 超时返回false；被唤醒或登记后发现有任务(或线程池退出)时返回true
+    // 有定时任务且没有其他线程负责时，由本线程最多休眠到下一次处理定时器的时刻，到时返回true
+    bool park(size_t slot, std::chrono::steady_clock::time_point deadline) {
+        bool keeper = false;
+        bool timerBound = false;  // 休眠的时刻由定时器决定
+        {
+            std::lock_guard<std::mutex> lock(parkMutex_);
+            parked_.push_back(slot);
+            parkedSize_++;
+            // 提交定时任务时先更新nextTimerNs_再在parkMutex_下检查负责的线程，两边至少有一方能看到对方
+            uint64_t next = nextTimerNs_.load();
+            if (next != TimerQueue::NO_TIMER && timekeeper_ == NO_SLOT) {
+                keeper = true;
+                timekeeper_ = slot;
+                keeperDeadlineNs_ = next;
+                auto timerDeadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(next));
+                if (timerDeadline < deadline) {
+                    deadline = timerDeadline;
+                    timerBound = true;
+                }
+            }
+        }
+        if (!keeper) {
+            return waitParked(slot, deadline);
+        }
+
+        bool woken = waitParked(slot, deadline);
+        // 因定时器到时醒来的线程自己处理定时器，其他原因(有任务、空闲回收、提前的定时任务)交给另一个休眠的线程
+        leaveTimekeeper(slot, woken || !timerBound);
+        return woken || timerBound;
+    }
+
+    // park的等待部分  调用者已登记到parked_
+    bool waitParked(size_t slot, std::chrono::steady_clock::time_point deadline) {
+        WorkerSlot& self = *slots_[slot];
+
+        // 登记之后再检查一次，提交者先增加taskSize_再检查parkedSize_，两边至少有一方能看到对方
+        bool woken = taskSize_ > 0 || !isRunning_ || retireRequests_ > 0;
+        if (!woken) {
+            trace(Tracer::Event::Park);
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                self.wakeup_.acquire();
+                woken = true;
+            } else {
+                woken = self.wakeup_.tryAcquireUntil(deadline);
+            }
+            trace(Tracer::Event::Unpark);
+            if (woken) {
+                return true;
+            }
+        }
+
+        // 没有被唤醒就要离开，撤销登记；已经被唤醒者取走时对方一定会release，需要消耗掉
+        {
+            std::lock_guard<std::mutex> lock(parkMutex_);
+            auto it = std::find(parked_.begin(), parked_.end(), slot);
+            if (it != parked_.end()) {
+                parked_.erase(it);
+                parkedSize_--;
+                return woken;
+            }
+        }
+        self.wakeup_.acquire();
+        return true;
+    }
+
+    // 不再负责定时器  handoff时如果还有定时任务，唤醒另一个休眠的线程接替
+    void leaveTimekeeper(size_t slot, bool handoff) {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        if (timekeeper_ == slot) {
+            timekeeper_ = NO_SLOT;
+        }
+        if (handoff && nextTimerNs_ != TimerQueue::NO_TIMER && !parked_.empty()) {
+            size_t other = parked_.back();
+            parked_.pop_back();
+            parkedSize_--;
+            slots_[other]->wakeup_.release();
+        }
+    }
+
+    // 下一次处理定时器的时刻提前后，唤醒负责的线程按新的时刻休眠；没有负责的线程时唤醒一个休眠的线程
+    void expediteTimers(uint64_t next) {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        size_t target = timekeeper_;
+        if (target == NO_SLOT) {
+            if (parked_.empty()) {
+                // 所有线程都在执行任务，由它们在两个任务之间处理
+                return ;
+            }
+            target = parked_.back();
+        } else if (next >= keeperDeadlineNs_) {
+            return ;
+        }
+        auto it = std::find(parked_.begin(), parked_.end(), target);
+        if (it != parked_.end()) {
+            parked_.erase(it);
+            parkedSize_--;
+            slots_[target]->wakeup_.release();
+        }
+    }
+
+    static uint64_t toNs(Deadline time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    template <typename Rep, typename Period>
+    static uint64_t toNs(std::chrono::duration<Rep, Period> d) {
+        return d.count() <= 0 ? 0 : uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    TimerHandle addTimer(uint64_t dueNs, uint64_t periodNs, TaskFunc func) {
+        auto node = std::allocate_shared<TimerQueue::Node>(PoolAllocator<TimerQueue::Node>());
+        node->func_ = std::move(func);
+        node->dueNs_ = dueNs;
+        node->periodNs_ = periodNs;
+        node->queue_ = timers_;
+        TimerHandle handle(node);
+        scheduleTimer(std::move(node));
+        return handle;
+    }
+
+    // 把定时器放入时间轮，已经到期时直接提交；线程池已关闭或定时器已取消时丢弃
+    void scheduleTimer(std::shared_ptr<TimerQueue::Node> node) {
+        uint64_t next = TimerQueue::NO_TIMER;
+        {
+            std::lock_guard<std::mutex> lock(timers_->mutex_);
+            if (isStopped_ || node->state_ == TimerQueue::Cancelled) {
+                return ;
+            }
+            node->due_ = timers_->toTick(node->dueNs_);
+            if (timers_->wheel_.insert(node.get())) {
+                node->self_ = node;
+                next = timers_->toNs(timers_->wheel_.nextTick());
+                if (next >= nextTimerNs_) {
+                    return ;
+                }
+                nextTimerNs_ = next;
+                node = nullptr;
+            }
+        }
+        if (node) {
+            postTimer(std::move(node));
+        } else {
+            expediteTimers(next);
+        }
+    }
+
+    // 推进时间轮，把到期的定时任务提交到任务队列  其他线程正在处理时直接返回
+    void serviceTimers() {
+        std::unique_lock<std::mutex> lock(timers_->mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return ;
+        }
+        TimerWheel::Link expired;
+        TimerWheel::initList(expired);
+        timers_->wheel_.advance(timers_->elapsedTicks(nowNs()), expired);
+        nextTimerNs_ = timers_->toNs(timers_->wheel_.nextTick());
+        std::shared_ptr<TimerQueue::Node> fired = takeTimers(expired);
+        lock.unlock();
+
+        while (fired) {
+            std::shared_ptr<TimerQueue::Node> next = std::move(fired->firedNext_);
+            postTimer(std::move(fired));
+            fired = std::move(next);
+        }
+    }
+
+    // 把链表中的节点移出，串成单链表返回，调用者需持有timers_->mutex_
+    static std::shared_ptr<TimerQueue::Node> takeTimers(TimerWheel::Link& list) {
+        std::shared_ptr<TimerQueue::Node> head;
+        TimerQueue::Node* tail = nullptr;
+        while (!TimerWheel::empty(list)) {
+            auto* node = static_cast<TimerQueue::Node*>(list.next_);
+            TimerWheel::unlink(node);
+            std::shared_ptr<TimerQueue::Node> ref = std::move(node->self_);
+            if (tail == nullptr) {
+                head = std::move(ref);
+            } else {
+                tail->firedNext_ = std::move(ref);
+            }
+            tail = node;
+        }
+        return head;
+    }
+
+    // 提交到期的定时任务  以到期时刻为截止时间放入全局队列，先于本地队列中的普通任务执行
+    // 任务队列已满时放回时间轮，下一个刻度再提交；不在当前线程执行，否则周期任务会层层嵌套
+    void postTimer(std::shared_ptr<TimerQueue::Node> node) {
+        Deadline due{std::chrono::nanoseconds(node->dueNs_)};
+        Job job = [this, node]() mutable { runTimer(std::move(node)); };
+        if (pushTask(job, std::chrono::milliseconds(0), TaskPriority::Priority_Normal, due, true)) {
+            return ;
+        }
+        job = nullptr;
+        uint64_t next;
+        {
+            std::lock_guard<std::mutex> lock(timers_->mutex_);
+            if (isStopped_ || node->state_ == TimerQueue::Cancelled) {
+                return ;
+            }
+            node->due_ = timers_->wheel_.current() + 1;
+            timers_->wheel_.insert(node.get());
+            node->self_ = std::move(node);
+            next = timers_->toNs(timers_->wheel_.nextTick());
+            if (next >= nextTimerNs_) {
+                return ;
+            }
+            nextTimerNs_ = next;
+        }
+        expediteTimers(next);
+    }
+
+    // 执行定时任务  周期任务执行完后安排下一次；Shutdown_Discard之后与队列中的其他任务一样不再执行
+    void runTimer(std::shared_ptr<TimerQueue::Node> node) {
+        if (isDiscarding_) {
+            return ;
+        }
+        if (node->periodNs_ == 0) {
+            int expected = TimerQueue::Pending;
+            if (node->state_.compare_exchange_strong(expected, TimerQueue::Done)) {
+                TaskFunc func = std::move(node->func_);
+                func();
+            }
+            return ;
+        }
+        if (node->state_ != TimerQueue::Pending) {
+            return ;
+        }
+        node->func_();
+        uint64_t now = nowNs();
+        uint64_t next = node->dueNs_ + node->periodNs_;
+        if (next <= now) {
+            next += ((now - next) / node->periodNs_ + 1) * node->periodNs_;
+        }
+        node->dueNs_ = next;
+        scheduleTimer(std::move(node));
+    }
+
+    // 关闭时丢弃尚未到期的定时任务，任务在锁外析构
+    void clearTimers() {
+        std::shared_ptr<TimerQueue::Node> dropped;
+        {
+            std::lock_guard<std::mutex> lock(timers_->mutex_);
+            TimerWheel::Link all;
+            TimerWheel::initList(all);
+            timers_->wheel_.clear(all);
+            nextTimerNs_ = TimerQueue::NO_TIMER;
+            dropped = takeTimers(all);
+        }
+        while (dropped) {
+            dropped = std::move(dropped->firedNext_);
+        }
+    }
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // 尝试放入环形队列，先计数再放入，保证taskSize_不会小于队列中的实际任务数
+    bool pushRing(Job& job, uint64_t enqueueTime, bool internal = false) {
+        QueuedJob item{std::move(job), enqueueTime, internal};
+        taskSize_++;
+        if (ringQue_->push(item)) {
+            return true;
+        }
+        taskSize_--;
+        job = std::move(item.job_);
+        return false;
+    }
+
+    // 丢弃队列中最早的任务后放入job(Overload_DropOldest)，线程池已关闭时返回false
+    // 被丢弃的任务在锁外析构，析构时可能再提交任务(例如通知等待者)；内部作业不会被丢弃
+    bool pushDropOldest(Job& job, TaskPriority priority, Deadline deadline, bool internal = false) {
+        uint64_t now = nowNs();
+        bool plain = priority == TaskPriority::Priority_Normal && deadline == Deadline::max();
+        if (queueMode_ != QueueMode::Queue_LockFree || !ringQue_ || !plain || internal) {
+            Job dropped;
+            return pushGlobal(job, std::chrono::milliseconds(0), now, priority, deadline, internal, &dropped);
+        }
+
+        // 环形队列的队首即最早的任务，其他提交者可能抢先放入，循环直到放入为止
+        // 这个策略下内部作业不放入环形队列，取出的都可以丢弃
+        QueuedJob dropped;
+        while (!pushRing(job, now)) {
+            if (isStopped_) {
+                return false;
+            }
+            if (ringQue_->pop(dropped)) {
+                taskSize_--;
+                tasksDropped_++;
+                dropped.job_ = nullptr;
+            }
+        }
+        enqueued();
+        notifyWaiting();
+        requestThreads();
+        return true;
+    }
+
+    // 在当前线程执行被拒绝的任务(Overload_CallerRuns)
+    void runInline(Job& job) {
+        QueuedJob task{std::move(job), nowNs()};
+        callerRuns_++;
+        if (currentPool_ == this) {
+            // 工作线程在执行任务的过程中提交，忙碌时间已计入外层任务
+            runTask(slots_[currentSlot_]->counters_, task);
+        } else {
+            uint64_t execNs = runTask(externalCounters_, task);
+            externalCounters_.addBusy(execNs);
+        }
+    }
+
+    // 从环形队列取出任务
+    bool popRing(QueuedJob& task) {
+        if (!ringQue_->pop(task)) {
+            return false;
+        }
+        taskTaken();
+        trace(Tracer::Event::Dequeue);
+        return true;
+    }
+
+    // 在任务队列上限之内为放入本地队列的任务计数，返回计入的数量(最多n个)
+    size_t reserveTasks(size_t n) {
+        unsigned size = taskSize_;
+        for (;;) {
+            if (size >= taskQueThreshold_) {
+                return 0;
+            }
+            size_t k = std::min(n, taskQueThreshold_ - size);
+            if (taskSize_.compare_exchange_weak(size, unsigned(size + k))) {
+                return k;
+            }
+        }
+    }
+
+    // 从本地队列或环形队列取走任务后计数，有提交者因任务队列已满而等待时唤醒它们
+    // 提交者先登记waitSubmitSize_再检查taskSize_，两边至少有一方能看到对方
+    void taskTaken() {
+        taskSize_--;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waitSubmitSize_ > 0) {
+            std::unique_lock<std::mutex> lock(taskQueMutex_);
+            notFull_.notify_all();
+        }
+    }
+
+    // 从各本地队列的队首取出最早的非内部任务用于丢弃(Overload_DropOldest)，调用者需持有taskQueMutex_
+    // 途中取出的内部作业移入全局队列
+    bool dropLocal(QueuedJob& task) {
+        size_t n = usedSlots_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            while (slots_[i]->taskQue_.steal(task)) {
+                if (!task.internal_) {
+                    return true;
+                }
+                taskQue_.push(std::move(task), size_t(TaskPriority::Priority_Normal));
+                globalTaskSize_++;
+            }
+        }
+        return false;
+    }
+
+    // 按绑定策略为每个槽位分配CPU，并按拓扑距离排列窃取顺序
+    // Cached模式下预留的槽位也分配好，之后创建的线程沿用槽位的CPU
+    void placeSlots() {
+        if (affinity_ == AffinityPolicy::Affinity_None) {
+            return ;
+        }
+        CpuTopology topo = CpuTopology::detect();
+        std::vector<int> cpus = topo.place(affinity_, slots_.size(), affinityCpus_);
+        std::vector<int> nodes(slots_.size(), -1);
+        for (size_t i = 0; i < cpus.size(); i++) {
+            CpuInfo info = topo.find(cpus[i]);
+            slots_[i]->cpu_ = cpus[i];
+            slots_[i]->domain_ = info.llc_;
+            nodes[i] = info.node_;
+        }
+
+        // 距离：0为共享末级缓存，1为同一NUMA节点，2为其他；距离相同时按槽位顺序轮转
+        size_t n = slots_.size();
+        for (size_t i = 0; i < n; i++) {
+            auto distance = [&](size_t j) {
+                if (slots_[i]->domain_ >= 0 && slots_[j]->domain_ == slots_[i]->domain_) {
+                    return 0;
+                }
+                return nodes[i] >= 0 && nodes[j] == nodes[i] ? 1 : 2;
+            };
+            std::vector<size_t>& order = slots_[i]->stealOrder_;
+            for (size_t k = 1; k < n; k++) {
+                order.push_back((i + k) % n);
+            }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return distance(a) < distance(b);
+            });
+        }
+    }
+
+    // 线程退出前的登记，调用者需持有taskQueMutex_  线程对象留到reapThreads中join后再释放
+    void exitThread(int thread_id, size_t slot) {
+        auto it = threads_.find(thread_id);
+        exited_.push_back(std::move(it->second));
+        threads_.erase(it);
+        slots_[slot]->active_ = false;
+        trace(Tracer::Event::Retire, thread_id);
+        exitCond_.notify_all();
+    }
+
+    // 响应resize(或阻塞区间结束)的退出请求，本地队列中剩余的任务转入全局队列；没有请求(已被其他线程响应或撤销)时返回false
+    bool retire(int thread_id, size_t slot) {
+        size_t moved = 0;
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            if (retireRequests_ == 0) {
+                return false;
+            }
+            retireRequests_--;
+            QueuedJob task;
+            while (slots_[slot]->taskQue_.pop(task)) {
+                taskQue_.push(std::move(task), size_t(TaskPriority::Priority_Normal));
+                moved++;
+            }
+            globalTaskSize_ += moved;
+            curThreadSize_--;
+            idleThreadSize_--;
+            THREADPOOL_LOG("---Thread resized away, id: " << std::this_thread::get_id() << "---");
+            exitThread(thread_id, slot);
+        }
+        notifyWaiting(moved);
+        return true;
+    }
+
+    // 启动线程  新线程可能在start返回之前就已经执行并退出，与reapThreads互斥，start写完线程对象后才能join和释放
+    void startThread(Thread* t) {
+        std::lock_guard<std::mutex> lock(startMutex_);
+        t->start();
+    }
+
+    // join已经退出的线程
+    void reapThreads() {
+        std::vector<std::unique_ptr<Thread>> exited;
+        {
+            std::lock_guard<std::mutex> startLock(startMutex_);
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            exited.swap(exited_);
+        }
+        for (auto& t : exited) {
+            t->join();
+        }
+    }
+
+    // 唤醒所有休眠的线程
+    void wakeAll() {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        for (size_t slot : parked_) {
+            slots_[slot]->wakeup_.release();
+        }
+        parked_.clear();
+        parkedSize_ = 0;
+    }
+
+    // 不再执行队列中的任务，把它们移入discarded
+    // 内部作业放回全局队列由工作线程照常执行，否则等待它们的任务组、strand等永远不会完成
+    void discardTasks(std::vector<Job>& discarded) {
+        isDiscarding_ = true;
+        std::vector<QueuedJob> internal;
+        collectTasks(discarded, internal);
+        if (internal.empty()) {
+            return ;
+        }
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            for (QueuedJob& task : internal) {
+                taskQue_.push(std::move(task), size_t(TaskPriority::Priority_Normal));
+            }
+            taskSize_ += internal.size();
+            globalTaskSize_ += internal.size();
+            updateHints();
+        }
+        notifyWaiting(internal.size());
+    }
+
+    // 取出所有队列中的任务，内部作业放入internal
+    void collectTasks(std::vector<Job>& discarded, std::vector<QueuedJob>& internal) {
+        QueuedJob task;
+        auto take = [&]() {
+            if (task.internal_) {
+                internal.push_back(std::move(task));
+            } else {
+                discarded.push_back(std::move(task.job_));
+            }
+            taskSize_--;
+        };
+        {
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            while (taskQue_.pop(task)) {
+                take();
+                globalTaskSize_--;
+            }
+            updateHints();
+        }
+        if (ringQue_) {
+            while (ringQue_->pop(task)) {
+                take();
+            }
+        }
+        for (auto& slot : slots_) {
+            while (slot->taskQue_.pop(task)) {
+                take();
+            }
+        }
+    }
+
+    // 查找空闲的工作槽位，没有时返回slots_.size()
+    size_t freeSlot() const {
+        for (size_t i = 0; i < slots_.size(); i++) {
+            if (!slots_[i]->active_) {
+                return i;
+            }
+        }
+        return slots_.size();
+    }
+
+    // 从全局队列取出任务，调用者需持有taskQueMutex_
+    // 全局队列中只有普通任务且任务较多时顺带取走一批放入本地队列(按线程数均分，最多TASK_POP_BATCH个)，
+    // 减少加锁次数，取走的任务仍可被其他空闲线程窃取
+    bool popGlobal(size_t slot, QueuedJob& task) {
+        if (!taskQue_.pop(task)) {
+            return false;
+        }
+
+        THREADPOOL_LOG("Thread id: " << std::this_thread::get_id() << " acquire task successfully...");
+
+        taskSize_--;
+        globalTaskSize_--;
+        trace(Tracer::Event::Dequeue);
+
+        const size_t normal = size_t(TaskPriority::Priority_Normal);
+        size_t extra = std::min(TASK_POP_BATCH - 1, taskQue_.size() / std::max(curThreadSize_.load(), 1));
+        if (extra > 0 && slot < slots_.size() && queueMode_ != QueueMode::Queue_LockFree
+            && taskQue_.size() == taskQue_.size(normal) && taskQue_.deadlineSize(normal) == 0) {
+            // 逆序压入，本线程从队尾取出时仍按提交顺序执行
+            QueuedJob batch[TASK_POP_BATCH - 1];
+            for (size_t i = 0; i < extra; i++) {
+                taskQue_.popFifo(normal, batch[i]);
+            }
+            for (size_t i = extra; i > 0; i--) {
+                slots_[slot]->taskQue_.push(std::move(batch[i - 1]));
+            }
+            globalTaskSize_ -= extra;
+        }
+
+        updateHints();
+        notFull_.notify_all();
+        return true;
+    }
+
+    // 更新全局队列的调度提示，工作线程据此决定是否先于本地队列检查全局队列，调用者需持有taskQueMutex_
+    void updateHints() {
+        const size_t high = size_t(TaskPriority::Priority_High);
+        const size_t normal = size_t(TaskPriority::Priority_Normal);
+        const size_t low = size_t(TaskPriority::Priority_Low);
+        urgentTaskSize_.store(taskQue_.size(high) + taskQue_.deadlineSize(normal), std::memory_order_relaxed);
+        uint64_t oldest = taskQue_.oldest(low);
+        uint64_t aging = std::chrono::duration_cast<std::chrono::nanoseconds>(agingTime_).count();
+        lowAgedAt_.store(oldest == NO_DEADLINE ? NO_DEADLINE : oldest + aging, std::memory_order_relaxed);
+    }
+
+    // 从其他线程的本地队列窃取任务
+    // slot为slots_.size()时表示线程池外部的线程，从所有槽位窃取
+    bool stealTask(size_t slot, QueuedJob& task) {
+        size_t n = usedSlots_.load(std::memory_order_acquire);
+        if (slot < slots_.size() && !slots_[slot]->stealOrder_.empty()) {
+            for (size_t victim : slots_[slot]->stealOrder_) {
+                if (victim < n && slots_[victim]->taskQue_.steal(task)) {
+                    taskTaken();
+                    trace(Tracer::Event::Steal, victim);
+                    return true;
+                }
+            }
+            return false;
+        }
+        for (size_t i = 1; i <= n; i++) {
+            size_t victim = (slot + i) % n;
+            if (victim != slot && slots_[victim]->taskQue_.steal(task)) {
+                taskTaken();
+                trace(Tracer::Event::Steal, victim);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 不阻塞地获取任务  Shutdown_Discard之后只返回内部作业，与关闭并发提交、之后才入队的普通任务交还给shutdown的调用者
+    bool tryAcquireTask(size_t slot, QueuedJob& task) {
+        while (acquireTask(slot, task)) {
+            if (!isDiscarding_.load(std::memory_order_relaxed) || task.internal_) {
+                return true;
+            }
+            std::lock_guard<std::mutex> lock(taskQueMutex_);
+            discardedLate_.push_back(std::move(task.job_));
+        }
+        return false;
+    }
+
+    // 依次尝试本地队列(或无锁队列)、全局队列、窃取
+    // 全局队列中有高优先级、带截止时间或等待过久的低优先级任务时先检查全局队列
+    bool acquireTask(size_t slot, QueuedJob& task) {
+        if (isPaused_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        uint64_t agedAt = lowAgedAt_.load(std::memory_order_relaxed);
+        if (globalTaskSize_ > 0 && (urgentTaskSize_.load(std::memory_order_relaxed) > 0
+            || (agedAt != NO_DEADLINE && nowNs() >= agedAt))) {
+            std::unique_lock<std::mutex> lock(taskQueMutex_);
+            if (popGlobal(slot, task)) {
+                return true;
+            }
+        }
+        if (queueMode_ == QueueMode::Queue_LockFree) {
+            if (popRing(task)) {
+                return true;
+            }
+            if (globalTaskSize_ > 0) {
+                std::unique_lock<std::mutex> lock(taskQueMutex_);
+                return popGlobal(slot, task);
+            }
+            return false;
+        }
+        if (slot < slots_.size() && slots_[slot]->taskQue_.pop(task)) {
+            taskTaken();
+            return true;
+        }
+        if (globalTaskSize_ > 0) {
+            std::unique_lock<std::mutex> lock(taskQueMutex_);
+            if (popGlobal(slot, task)) {
+                return true;
+            }
+        }
+        return stealTask(slot, task);
+    }
+
+    // 定义线程函数  线程池的所有线程从任务队列中获取任务并执行
+    void threadFuc(int thread_id, size_t slot) {
+        currentPool_ = this;
+        currentSlot_ = slot;
+        if (slots_[slot]->cpu_ >= 0) {
+            CpuTopology::pinCurrentThread(slots_[slot]->cpu_);
+        }
+        if (tracer_) {
+            tracer_->nameThread("worker " + std::to_string(slot));
+        }
+        auto lastTime = std::chrono::steady_clock::now();
+        WorkerCounters& counters = slots_[slot]->counters_;
+        uint64_t idleSince = nowNs();
+
+        for (;;) {
+            // resize减少线程数量时，在两个任务之间退出  退出后槽位随时可能交给新线程，先记下空闲时间
+            if (retireRequests_.load(std::memory_order_relaxed) > 0) {
+                uint64_t now = nowNs();
+                counters.addIdle(now - idleSince);
+                idleSince = now;
+                if (retire(thread_id, slot)) {
+                    return ;
+                }
+            }
+
+            QueuedJob task;
+            if (!tryAcquireTask(slot, task) && !spinForTask(slot, task)) {
+                THREADPOOL_LOG("Thread id: " << std::this_thread::get_id() << " try to acquire task...");
+
+                // 线程池关闭时，执行完剩余任务再退出(放弃剩余任务时队列中只剩内部作业)
+                if (!isRunning_ && taskSize_ == 0) {
+                    std::lock_guard<std::mutex> lock(taskQueMutex_);
+                    THREADPOOL_LOG("Thread id: " << std::this_thread::get_id() << " exit...");
+                    exitThread(thread_id, slot);
+                    return ;
+                }
+
+                // 暂停期间不取任务，等待resume
+                if (isPaused_) {
+                    std::unique_lock<std::mutex> lock(pauseMutex_);
+                    pauseCond_.wait(lock, [&]()->bool {
+                        return !isPaused_ || !isRunning_ || retireRequests_ > 0;
+                    });
+                    continue;
+                }
+
+                // 有到期的定时任务时放入任务队列后重新获取
+                uint64_t timerNs = nextTimerNs_.load(std::memory_order_relaxed);
+                if (timerNs != TimerQueue::NO_TIMER && timerNs <= nowNs()) {
+                    serviceTimers();
+                    continue;
+                }
+
+                // Cached模式下线程数量超过下限时只休眠到空闲回收时间，到期仍没有任务则退出；不做周期性唤醒
+                auto deadline = std::chrono::steady_clock::time_point::max();
+                if (poolMode_ == PoolMode::Mode_Cached && size_t(curThreadSize_) > threadSizeMin_) {
+                    deadline = lastTime + keepAliveTime_;
+                }
+                if (!park(slot, deadline) && taskSize_ == 0) {
+                    std::lock_guard<std::mutex> lock(taskQueMutex_);
+                    if (taskSize_ == 0 && isRunning_ && size_t(curThreadSize_) > threadSizeMin_) {
+                        THREADPOOL_LOG("---Thread exit, id: " << std::this_thread::get_id() << "---");
+                        curThreadSize_--;
+                        idleThreadSize_--;
+                        threadsRetired_++;
+                        counters.addIdle(nowNs() - idleSince);
+                        exitThread(thread_id, slot);
+                        return ;
+                    }
+                }
+                continue;
+            }
+
+            // 有到期的定时任务时放入任务队列  刚取出一个任务，队列中至少有一个空位
+            uint64_t timerNs = nextTimerNs_.load(std::memory_order_relaxed);
+            if (timerNs != TimerQueue::NO_TIMER && timerNs <= nowNs()) {
+                serviceTimers();
+            }
+
+            idleThreadSize_--;
+
+            // 当前线程执行该任务
+            if (task.job_) {
+                uint64_t start = nowNs();
+                counters.addIdle(start - idleSince);
+                uint64_t execNs = runTask(counters, task, start);
+                counters.addBusy(execNs);
+                idleSince = start + execNs;
+            }
+
+            idleThreadSize_++;
+            lastTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    // 执行任务并记录等待时间和执行时间，返回执行时间(纳秒)
+    uint64_t runTask(WorkerCounters& counters, QueuedJob& task, uint64_t start = 0) {
+        if (start == 0) {
+            start = nowNs();
+        }
+        trace(Tracer::Event::Start);
+        task.job_();
+        trace(Tracer::Event::Finish);
+        uint64_t execNs = nowNs() - start;
+        counters.recordTask(start > task.enqueueTime_ ? start - task.enqueueTime_ : 0, execNs);
+        return execNs;
+    }
+
+    // 任务放入队列后记录调度事件并更新任务数量的历史最大值
+    void enqueued() {
+        unsigned size = taskSize_;
+        trace(Tracer::Event::Enqueue, size);
+        unsigned high = queueHighWater_.load(std::memory_order_relaxed);
+        while (size > high && !queueHighWater_.compare_exchange_weak(high, size, std::memory_order_relaxed)) {
+        }
+    }
+
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 记录调度事件，没有开启记录时只有一次判断
+    void trace(Tracer::Event event, uint64_t arg = 0) {
+        if (tracer_) {
+            tracer_->record(event, arg);
+        }
+    }
+
+    // 查询线程池运行状态
+    bool checkState() const {
+        return isRunning_;
+    }
+};
+
+#endif
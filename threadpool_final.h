@@ -1,5 +1,5 @@
-#ifndef THREADPOOL_H
-#define THREADPOOL_H
+#ifndef THREADPOOL_FINAL_H
+#define THREADPOOL_FINAL_H
 
 #include <iostream>
 #include <vector>
@@ -12,245 +12,268 @@
 #include <functional>
 #include <unordered_map>
 #include <future>
+#include <tuple>
+#include <iterator>
+#include <coroutine>
+#include <optional>
+#include <exception>
+#include <stdexcept>
 
-const size_t TASK_QUE_THRESHOLD = 2;
-const size_t THREAD_SIZE_THRESHOLD = 100;
-const int THREAD_MAX_IDEL_TIME = 10;
-
+#include "threadpool_base.h"
+#include "pool_allocator.h"
+#include "cancellation.h"
 
-// 线程类型
-class Thread {
-public:
-    using ThreadFunc = std::function<void(int)>;
-
-    Thread(ThreadFunc func) 
-        : func_(func),
-          threadId_(genId_++) {
-        }
+// 与threadpool.h中的ThreadPool同名，放在内联命名空间中使两者的符号不冲突，
+// 分别使用两套接口的源文件可以链接到同一个程序中；只包含本头文件时仍直接使用ThreadPool
+inline namespace future_api {
 
-    ~Thread() = default;
-
-    // 启动线程
-    void start() {
-        std::thread t(func_, threadId_);
-        t.detach();
-    }
-
-    // 查询线程id
-    int getId() const {
-        return threadId_;
-    }
-
-private:
-    ThreadFunc func_;
-    static int genId_;
-    int threadId_;
-};
+const size_t TASK_QUE_THRESHOLD = 2;
 
-int Thread::genId_ = 0;
 
-// 线程池工作模式
-enum class PoolMode {
-    Mode_Fixed,
-    Mode_Cached,
+// 任务没有执行：提交时被过载策略拒绝、线程池已关闭，或在队列中被丢弃(Overload_DropOldest、shutdown)
+// 对应future的get()抛出该异常
+class TaskRejected : public std::runtime_error {
+public:
+    TaskRejected() : std::runtime_error("task rejected by thread pool") {}
 };
 
 
 // 线程池类型
-class ThreadPool {
+class ThreadPool : public ThreadPoolBase {
 public:
-    ThreadPool()   
-    : initThreadSize_(0), 
-      idleThreadSize_(0),
-      curThreadSize_(0),
-      threadSizeThreshold_(THREAD_SIZE_THRESHOLD),
-      taskSize_(0), 
-      taskQueThreshold_(TASK_QUE_THRESHOLD), 
-      poolMode_(PoolMode::Mode_Fixed),
-      isRunning_(false) {
-    }
-
-    ~ThreadPool() {
-        isRunning_ = false;
-        std::unique_lock<std::mutex> lock(taskQueMutex_);
-        notEmpty_.notify_all();
-        exitCond_.wait(lock, [&]()->bool { return threads_.size() == 0; });
+    ThreadPool()
+        : ThreadPoolBase(TASK_QUE_THRESHOLD) {
     }
 
-    // 开启线程池
-    void start(size_t initThreadSize = std::thread::hardware_concurrency()) {
-        // 设置线程池运行状态
-        isRunning_ = true;
-
-        // 初始化线程数量
-        initThreadSize_ = initThreadSize;
-        curThreadSize_ = initThreadSize;
+    ~ThreadPool() = default;
 
-        // 创建线程对象
-        for (int i = 0; i < initThreadSize_; i++) {
-            auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFuc, this, std::placeholders::_1));
-            int thread_id = ptr->getId();
-            threads_.emplace(thread_id, std::move(ptr));
-        }
-        // 启动所有线程
-        for (int i = 0; i < initThreadSize_; i++) {
-            threads_[i]->start();
-            idleThreadSize_++;
-        }
+    // 提交任务至线程池  任务队列已满时按过载策略处理，任务被拒绝时future的get()抛出TaskRejected
+    // 可调用对象和参数直接保存在TaskFunc的内部缓冲区中，future的共享状态从线程本地的内存池分配，
+    // 常见大小的任务提交时不需要分配堆内存
+    template <typename Func, typename... Args>
+    auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+        return submitWith(TaskPriority::Priority_Normal, Deadline::max(),
+                          std::forward<Func>(func), std::forward<Args>(args)...);
     }
 
-    // 设置线程池的工作模式
-    void setMode(PoolMode mode) {
-        if (checkState()) {
-            return ;
-        } 
-        poolMode_ = mode; 
+    // 按优先级提交任务
+    template <typename Func, typename... Args>
+    auto submitTask(TaskPriority priority, Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+        return submitWith(priority, Deadline::max(), std::forward<Func>(func), std::forward<Args>(args)...);
     }
 
-    // 设置线程数量上限(Cached模式下)
-    void setThreadSizeThreshold(size_t thread_Threshold) {
-        if (checkState()) {
-            return ;
-        }
-        if (poolMode_ == PoolMode::Mode_Cached) {
-            threadSizeThreshold_ = thread_Threshold;
-        }
+    // 按优先级和截止时间提交任务，同一优先级内截止时间早的先执行
+    template <typename Func, typename... Args>
+    auto submitTask(TaskPriority priority, Deadline deadline, Func&& func, Args&&... args)
+        -> std::future<decltype(func(args...))> {
+        return submitWith(priority, deadline, std::forward<Func>(func), std::forward<Args>(args)...);
     }
 
-    // 设置线程池的任务队列容量上限
-    void setTaskQueThreshold(size_t task_Threshold) {
-        taskQueThreshold_ = task_Threshold;
+    // 提交可以取消的任务  token在任务开始前取消时不执行，future的get()抛出TaskCancelled；
+    // 执行中的任务自行检查token，调用token.throwIfCancelled()同样得到TaskCancelled
+    template <typename Func, typename... Args>
+    auto submitTask(const CancellationToken& token, Func&& func, Args&&... args)
+        -> std::future<decltype(func(args...))> {
+        using RType = decltype(func(args...));
+        std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+        std::future<RType> result = promise.get_future();
+        Job job = makeCancellableTask(std::move(promise), token, std::forward<Func>(func), std::forward<Args>(args)...);
+        pushTask(job);
+        return result;
     }
 
-    // 提交任务至线程池
+    // 不等待地提交任务  任务队列已满或线程池已关闭时不按过载策略处理，直接返回空值(func随之销毁)
     template <typename Func, typename... Args>
-    auto submitTask(Func&& func, Args&&... args) -> std::future<decltype(func(args...))> {
+    auto trySubmit(Func&& func, Args&&... args) -> std::optional<std::future<decltype(func(args...))>> {
         using RType = decltype(func(args...));
-        auto task = std::make_shared<std::packaged_task<RType()>>(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
-        std::future<RType> result = task->get_future();
-
-        // 获取锁
-        std::unique_lock<std::mutex> lock(taskQueMutex_);
-
-        // 线程通信 等待任务队列空余
-        if (!notFull_.wait_for(lock, std::chrono::seconds(1), [&]()->bool { return taskQue_.size() < taskQueThreshold_; })) {
-            std::cerr << "Task queue is full, submit task fail." << std::endl;
-            auto task = std::make_shared<std::packaged_task<RType()>>(
-                []()->RType { return RType(); });
-            (*task)();
-            return task->get_future();
+        std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+        std::future<RType> result = promise.get_future();
+        Job job = makeTask(std::move(promise), std::forward<Func>(func), std::forward<Args>(args)...);
+        if (!pushTask(job, std::chrono::milliseconds(0))) {
+            return std::nullopt;
         }
+        return result;
+    }
 
-        // 任务队列空余，将任务加入队列
-        // taskQue_.emplace(sp);
-        taskQue_.emplace([task]() { (*task)(); });
-        taskSize_++;
-
-        notEmpty_.notify_all(); 
-
-        // Cached模式下，根据任务数量和空闲线程数量判断是否需要创建新线程
-        if (poolMode_ == PoolMode::Mode_Cached && taskSize_ > idleThreadSize_ && curThreadSize_ < threadSizeThreshold_) {
-            auto ptr = std::make_unique<Thread>(std::bind(&ThreadPool::threadFuc, this, std::placeholders::_1));
-            std::cout << "---Create new thread---" << std::endl;
-            int thread_id = ptr->getId();
-            threads_.emplace(thread_id, std::move(ptr));
-            threads_[thread_id]->start();
-            curThreadSize_++;
-            idleThreadSize_++;
+    // 批量提交任务至线程池  [first, last)中的每个元素是一个无参可调用对象
+    // 整批任务只加一次锁、只唤醒需要的线程数量；返回与每个任务一一对应的future
+    // 被过载策略拒绝的任务对应的future在get()时抛出TaskRejected
+    template <typename Iter>
+    auto submitBatch(Iter first, Iter last) -> std::vector<std::future<decltype((*first)())>> {
+        using RType = decltype((*first)());
+        std::vector<std::future<RType>> results;
+        std::vector<TaskFunc> jobs;
+        results.reserve(std::distance(first, last));
+        jobs.reserve(results.capacity());
+
+        for (; first != last; ++first) {
+            std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+            results.emplace_back(promise.get_future());
+            jobs.emplace_back(makeTask(std::move(promise), *first));
         }
 
-        return result;
+        pushBatch(jobs);
+        return results;
+    }
+
+    // 协程中co_await pool.async(func, args...)  在线程池中执行func，完成后由该工作线程直接恢复协程
+    // 结果为func的返回值，func抛出的异常在co_await处重新抛出；不经过future，等待期间不占用线程
+    // std::future没有完成通知，只能阻塞等待，协程中应使用async代替submitTask
+    template <typename Func, typename... Args>
+    auto async(Func&& func, Args&&... args) {
+        auto call = [func = std::forward<Func>(func),
+                     args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            return std::apply(func, args);
+        };
+        return AsyncAwaiter<decltype(call)>(*this, std::move(call));
     }
 
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
 
 private:
-    PoolMode poolMode_;  // 线程池工作模式 
-    std::atomic_bool isRunning_;  // 线程池是否已经启动
-
-    std::unordered_map<int, std::unique_ptr<Thread>> threads_;  // 线程列表
-    size_t initThreadSize_;  // 初始线程数量
-    size_t threadSizeThreshold_;  // 线程数量上限(Cached模式下)
-    std::atomic_int idleThreadSize_;  // 空闲线程数量
-    std::atomic_int curThreadSize_;  // 当前线程数量
-
-    using Task = std::function<void()>;
-    std::queue<Task> taskQue_;  // 任务队列
-    std::atomic_uint taskSize_;  // 任务数量
-    size_t taskQueThreshold_;  // 任务队列容量上限
-
-    std::mutex taskQueMutex_;  // 保证任务队列的线程安全
-    std::condition_variable notFull_;
-    std::condition_variable notEmpty_;
-    std::condition_variable exitCond_;  // 等带线程资源全部回收 
-
-    void threadFuc(int thread_id) {
-        auto lastTime = std::chrono::high_resolution_clock().now();
-
-        for (;;) {
-            Task task;
-            // 建立作用域限制线程获取锁的时间
-            {
-                // 获取锁
-                std::unique_lock<std::mutex> lock(taskQueMutex_);
-
-                std::cout << "Thread id: " << std::this_thread::get_id() << " try to acquire task..." << std::endl;
-
-                // Cached模式下，回收超过空闲时间的多余线程
-                while (taskQue_.size() == 0) {
-                    if (!isRunning_) {
-                        threads_.erase(thread_id);
-                        std::cout << "Thread id: " << std::this_thread::get_id() << " exit..." << std::endl;
-                        exitCond_.notify_all();
-                        return ;
-                    }
-
-                    if (poolMode_ == PoolMode::Mode_Cached) {
-                        if (std::cv_status::timeout == notEmpty_.wait_for(lock, std::chrono::seconds(1))) {
-                            auto nowTime = std::chrono::high_resolution_clock().now();
-                            auto durTime = std::chrono::duration_cast<std::chrono::seconds>(nowTime - lastTime);
-                            if (durTime.count() >= THREAD_MAX_IDEL_TIME && curThreadSize_ > initThreadSize_) {
-                                threads_.erase(thread_id);
-                                std::cout << "---Thread exit, id: " << std::this_thread::get_id() << "---" << std::endl; 
-                                curThreadSize_--;
-                                idleThreadSize_--;
-                                return ;
-                            }
-                        }
-                    } else {
-                        // 等待notEmpty条件
-                        notEmpty_.wait(lock);
-                    }
-                }
+    // async返回的等待对象  保存在协程帧中，任务只捕获它的地址和协程句柄
+    template <typename Call>
+    class AsyncAwaiter {
+    public:
+        using RType = std::invoke_result_t<Call&>;
+
+        AsyncAwaiter(ThreadPool& pool, Call&& call)
+            : pool_(pool),
+              call_(std::move(call)) {
+        }
 
-                std::cout << "Thread id: " << std::this_thread::get_id() << " acquire task successfully..." << std::endl;
-                idleThreadSize_--;
+        bool await_ready() const noexcept {
+            return false;
+        }
 
-                // 从任务队列中获取任务
-                task = taskQue_.front();
-                taskQue_.pop();
-                taskSize_--;
+        // 任务被拒绝时在当前线程执行，不挂起
+        // Overload_CallerRuns策略下任务在pushTask中执行并恢复协程，之后不再访问成员
+        bool await_suspend(std::coroutine_handle<> h) {
+            Job job = [this, h]() { run(); h.resume(); };
+            if (pool_.pushTask(job, TaskPriority::Priority_Normal, Deadline::max(), true)) {
+                return true;
+            }
+            run();
+            return false;
+        }
 
-                if (taskSize_ > 0) {
-                    notEmpty_.notify_all();
+        RType await_resume() {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            if constexpr (!std::is_void_v<RType>) {
+                return std::move(*value_);
+            }
+        }
+
+    private:
+        ThreadPool& pool_;
+        Call call_;
+        std::optional<std::conditional_t<std::is_void_v<RType>, bool, RType>> value_;
+        std::exception_ptr error_;
+
+        void run() {
+            try {
+                if constexpr (std::is_void_v<RType>) {
+                    call_();
+                } else {
+                    value_.emplace(call_());
                 }
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+        }
+    };
 
-                notFull_.notify_all();
+    template <typename Func, typename... Args>
+    auto submitWith(TaskPriority priority, Deadline deadline, Func&& func, Args&&... args)
+        -> std::future<decltype(func(args...))> {
+        using RType = decltype(func(args...));
+        std::promise<RType> promise(std::allocator_arg, PoolAllocator<char>());
+        std::future<RType> result = promise.get_future();
+
+        // 任务被拒绝时job随之析构，result中已经是TaskRejected
+        Job job = makeTask(std::move(promise), std::forward<Func>(func), std::forward<Args>(args)...);
+        pushTask(job, priority, deadline);
+        return result;
+    }
+
+    // 任务中的promise  任务没有执行就被析构时设置TaskRejected，而不是std::future_error(broken_promise)
+    template <typename RType>
+    class TaskPromise {
+    public:
+        explicit TaskPromise(std::promise<RType>&& promise)
+            : promise_(std::move(promise)),
+              done_(false) {
+        }
+
+        TaskPromise(TaskPromise&& other) noexcept
+            : promise_(std::move(other.promise_)),
+              done_(std::exchange(other.done_, true)) {
+        }
+
+        ~TaskPromise() {
+            if (!done_) {
+                promise_.set_exception(std::make_exception_ptr(TaskRejected()));
             }
+        }
+
+        TaskPromise& operator=(TaskPromise&&) = delete;
 
-            // 当前线程执行该任务
-            if (task != nullptr) {
-                task();
+        // 取得promise设置结果
+        std::promise<RType>& get() {
+            done_ = true;
+            return promise_;
+        }
+
+    private:
+        std::promise<RType> promise_;
+        bool done_;
+    };
+
+    // 将可调用对象、参数和promise打包成一个只能移动的任务
+    template <typename RType, typename Func, typename... Args>
+    static TaskFunc makeTask(std::promise<RType>&& promise, Func&& func, Args&&... args) {
+        return [promise = TaskPromise<RType>(std::move(promise)),
+                func = std::forward<Func>(func),
+                args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            invoke(promise.get(), func, args);
+        };
+    }
+
+    // 同makeTask，执行前先检查token  令牌只在任务取出时检查一次，取消不需要在队列中查找任务
+    template <typename RType, typename Func, typename... Args>
+    static TaskFunc makeCancellableTask(std::promise<RType>&& promise, const CancellationToken& token,
+                                        Func&& func, Args&&... args) {
+        return [promise = TaskPromise<RType>(std::move(promise)),
+                token,
+                func = std::forward<Func>(func),
+                args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            if (token.isCancelled()) {
+                promise.get().set_exception(std::make_exception_ptr(TaskCancelled()));
+                return ;
             }
+            invoke(promise.get(), func, args);
+        };
+    }
 
-            idleThreadSize_++;
-            lastTime = std::chrono::high_resolution_clock().now();
+    // 执行任务并把返回值或异常存入promise
+    template <typename RType, typename Func, typename Tuple>
+    static void invoke(std::promise<RType>& p, Func& func, Tuple& args) {
+        try {
+            if constexpr (std::is_void_v<RType>) {
+                std::apply(func, args);
+                p.set_value();
+            } else {
+                p.set_value(std::apply(func, args));
+            }
+        } catch (...) {
+            p.set_exception(std::current_exception());
         }
-    }  // 线程执行函数
-    bool checkState() const{
-        return isRunning_;
-    }  // 查询线程池运行状态
+    }
 };
 
-#endif
\ No newline at end of file
+}  // namespace future_api
+
+#endif
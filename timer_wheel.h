@@ -0,0 +1,271 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "task_func.h"
+
+// 分层时间轮  4层，每层64个槽位，第0层每个槽位为1个刻度，上一层的槽位覆盖下一层的一整圈，共覆盖2^24个刻度
+// 超出范围的节点放在最高层最远的槽位，转到时重新计算位置；插入和删除都是O(1)，
+// 推进时只在有节点的刻度处理，空闲期间一次跳过，不逐个刻度遍历
+// 节点侵入式地链接在槽位的双向链表中，时间轮不负责节点的内存，也不是线程安全的
+class TimerWheel {
+public:
+    static constexpr unsigned LEVELS = 4;
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr uint64_t NO_TICK = std::numeric_limits<uint64_t>::max();
+
+    // 节点  due_为到期的刻度
+    struct Link {
+        Link* prev_ = nullptr;
+        Link* next_ = nullptr;
+        uint64_t due_ = 0;
+
+        bool linked() const {
+            return next_ != nullptr;
+        }
+    };
+
+    TimerWheel() : current_(0), size_(0) {
+        for (auto& level : slots_) {
+            for (Link& head : level) {
+                initList(head);
+            }
+        }
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    uint64_t current() const {
+        return current_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // 放入节点  到期刻度不晚于当前刻度时不放入，返回false，由调用者直接触发
+    bool insert(Link* link) {
+        if (link->due_ <= current_) {
+            return false;
+        }
+        place(link);
+        size_++;
+        return true;
+    }
+
+    void remove(Link* link) {
+        unlink(link);
+        size_--;
+    }
+
+    // 推进到tick，到期的节点按到期顺序移入expired(以expired为头的双向循环链表)
+    void advance(uint64_t tick, Link& expired) {
+        while (current_ < tick) {
+            uint64_t next = nextTick();
+            if (next > tick) {
+                current_ = tick;
+                break;
+            }
+            current_ = next;
+
+            // 转到上层槽位的边界时，先把该槽位的节点降到下层(从高到低，降下来的节点可能需要继续下降)
+            for (unsigned level = LEVELS - 1; level >= 1; level--) {
+                unsigned shift = level * SLOT_BITS;
+                if ((current_ & ((uint64_t(1) << shift) - 1)) == 0) {
+                    cascade(slots_[level][(current_ >> shift) & (SLOTS - 1)], expired);
+                }
+            }
+            Link& head = slots_[0][current_ & (SLOTS - 1)];
+            while (head.next_ != &head) {
+                Link* link = head.next_;
+                unlink(link);
+                size_--;
+                append(expired, link);
+            }
+        }
+    }
+
+    // 下一个需要处理的刻度(最早的到期刻度或上层槽位的边界，不晚于最早的到期刻度)，没有节点时返回NO_TICK
+    uint64_t nextTick() const {
+        if (size_ == 0) {
+            return NO_TICK;
+        }
+        uint64_t best = NO_TICK;
+        for (unsigned level = 0; level < LEVELS; level++) {
+            unsigned shift = level * SLOT_BITS;
+            for (uint64_t j = 1; j <= SLOTS; j++) {
+                uint64_t tick = ((current_ >> shift) + j) << shift;
+                const Link& head = slots_[level][(tick >> shift) & (SLOTS - 1)];
+                if (head.next_ != &head) {
+                    best = std::min(best, tick);
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+
+    // 移出所有节点(不论是否到期)
+    void clear(Link& out) {
+        for (auto& level : slots_) {
+            for (Link& head : level) {
+                while (head.next_ != &head) {
+                    Link* link = head.next_;
+                    unlink(link);
+                    append(out, link);
+                }
+            }
+        }
+        size_ = 0;
+    }
+
+    // 初始化为空的链表头
+    static void initList(Link& list) {
+        list.prev_ = &list;
+        list.next_ = &list;
+    }
+
+    static bool empty(const Link& list) {
+        return list.next_ == &list;
+    }
+
+    static void append(Link& list, Link* link) {
+        link->prev_ = list.prev_;
+        link->next_ = &list;
+        list.prev_->next_ = link;
+        list.prev_ = link;
+    }
+
+    static void unlink(Link* link) {
+        link->prev_->next_ = link->next_;
+        link->next_->prev_ = link->prev_;
+        link->prev_ = nullptr;
+        link->next_ = nullptr;
+    }
+
+private:
+    Link slots_[LEVELS][SLOTS];  // 每个槽位的链表头
+    uint64_t current_;  // 已经处理到的刻度
+    size_t size_;
+
+    // 按距离当前刻度的远近选择层：第level层放距离小于64^(level+1)的节点
+    void place(Link* link) {
+        uint64_t delta = link->due_ - current_;
+        for (unsigned level = 0; level < LEVELS; level++) {
+            unsigned shift = level * SLOT_BITS;
+            if (delta < (uint64_t(1) << (shift + SLOT_BITS))) {
+                append(slots_[level][(link->due_ >> shift) & (SLOTS - 1)], link);
+                return ;
+            }
+        }
+        unsigned shift = (LEVELS - 1) * SLOT_BITS;
+        append(slots_[LEVELS - 1][((current_ >> shift) + SLOTS - 1) & (SLOTS - 1)], link);
+    }
+
+    void cascade(Link& head, Link& expired) {
+        while (head.next_ != &head) {
+            Link* link = head.next_;
+            unlink(link);
+            if (link->due_ <= current_) {
+                size_--;
+                append(expired, link);
+            } else {
+                place(link);
+            }
+        }
+    }
+};
+
+
+class TimerHandle;
+
+// 线程池的定时器  时间轮和保护它的锁，由线程池和所有定时器节点共同持有，线程池析构后取消定时器仍然安全
+struct TimerQueue {
+    static constexpr uint64_t NO_TIMER = std::numeric_limits<uint64_t>::max();
+
+    enum State { Pending, Done, Cancelled };
+
+    // 定时器节点  periodNs_不为0时为周期定时器；单次定时器执行时从Pending改为Done，与取消互斥
+    struct Node : TimerWheel::Link {
+        TaskFunc func_;
+        uint64_t dueNs_ = 0;  // 本次到期的时刻
+        uint64_t periodNs_ = 0;
+        std::atomic_int state_{Pending};
+        std::shared_ptr<Node> self_;  // 在时间轮中时持有自己，保证到期之前不被释放
+        std::shared_ptr<Node> firedNext_;  // 到期后取出时串成单链表，在锁外逐个提交
+        std::shared_ptr<TimerQueue> queue_;
+    };
+
+    std::mutex mutex_;
+    TimerWheel wheel_;
+    uint64_t epochNs_ = 0;  // 第0个刻度的时刻
+    uint64_t resolutionNs_ = 1000000;  // 每个刻度的长度，即触发的精度
+
+    // ns之前已经结束的刻度
+    uint64_t elapsedTicks(uint64_t ns) const {
+        return ns <= epochNs_ ? 0 : (ns - epochNs_) / resolutionNs_;
+    }
+
+    // 不早于ns的第一个刻度
+    uint64_t toTick(uint64_t ns) const {
+        return ns <= epochNs_ ? 0 : (ns - epochNs_ + resolutionNs_ - 1) / resolutionNs_;
+    }
+
+    uint64_t toNs(uint64_t tick) const {
+        return tick == TimerWheel::NO_TICK ? NO_TIMER : epochNs_ + tick * resolutionNs_;
+    }
+};
+
+
+// 定时任务的句柄  复制的代价为一次引用计数；句柄释放不会取消定时任务
+class TimerHandle {
+public:
+    TimerHandle() = default;
+
+    // 取消定时任务  还在时间轮中的节点立即移除(O(1))；已经到期、尚未执行的任务不再执行，周期任务不再安排下一次
+    // 取消前尚未开始执行(周期任务为还会再执行)时返回true
+    bool cancel() {
+        if (!node_) {
+            return false;
+        }
+        std::shared_ptr<TimerQueue::Node> ref;
+        bool pending;
+        {
+            std::lock_guard<std::mutex> lock(node_->queue_->mutex_);
+            int expected = TimerQueue::Pending;
+            pending = node_->state_.compare_exchange_strong(expected, TimerQueue::Cancelled);
+            if (node_->linked()) {
+                node_->queue_->wheel_.remove(node_.get());
+                ref = std::move(node_->self_);
+            }
+        }
+        return pending;
+    }
+
+    bool isCancelled() const {
+        return node_ && node_->state_.load() == TimerQueue::Cancelled;
+    }
+
+    // 是否关联了定时任务(默认构造的句柄没有)
+    explicit operator bool() const {
+        return node_ != nullptr;
+    }
+
+private:
+    std::shared_ptr<TimerQueue::Node> node_;
+
+    explicit TimerHandle(std::shared_ptr<TimerQueue::Node> node) : node_(std::move(node)) {}
+
+    friend class ThreadPoolBase;
+};
+
+#endif
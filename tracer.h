@@ -0,0 +1,229 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 调度事件记录器  每个线程一个环形缓冲区，只有本线程写入，记录时不加锁
+// 缓冲区写满后覆盖最早的事件；dump()输出Chrome trace-event格式的JSON，
+// 可以用chrome://tracing或Perfetto打开，查看任务执行和线程空闲的时间线
+class Tracer {
+public:
+    enum class Event : uint8_t {
+        Enqueue,  // 任务放入队列，arg为放入后的任务数量
+        Dequeue,  // 从全局队列取出任务
+        Start,  // 开始执行任务
+        Finish,  // 任务执行完毕
+        Steal,  // 从其他线程窃取任务，arg为被窃取的槽位
+        Park,  // 没有任务，线程开始等待
+        Unpark,  // 线程被唤醒
+        Spawn,  // 创建新线程，arg为线程id
+        Retire,  // 线程退出，arg为线程id
+    };
+
+    explicit Tracer(size_t eventsPerThread)
+        : id_(nextId().fetch_add(1) + 1),
+          capacity_(eventsPerThread > 0 ? eventsPerThread : 1),
+          epoch_(std::chrono::steady_clock::now()) {
+    }
+
+    ~Tracer() = default;
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // 记录当前线程的一个事件  条目按序号写入，dump()读到序号不一致的条目(正在被覆盖)时丢弃
+    void record(Event event, uint64_t arg = 0) {
+        Buffer* buf = local();
+        uint64_t head = buf->head_.load(std::memory_order_relaxed);
+        Entry& entry = buf->entries_[head % capacity_];
+        entry.seq_.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.ts_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch_).count(), std::memory_order_relaxed);
+        entry.arg_.store(arg, std::memory_order_relaxed);
+        entry.event_.store(static_cast<uint8_t>(event), std::memory_order_relaxed);
+        entry.seq_.store(head + 1, std::memory_order_release);
+        buf->head_.store(head + 1, std::memory_order_release);
+    }
+
+    // 设置当前线程在时间线上显示的名称
+    void nameThread(const std::string& name) {
+        Buffer* buf = local();
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf->name_ = name;
+    }
+
+    // 输出Chrome trace-event JSON  运行过程中调用时，正在被覆盖的事件会被丢弃
+    void dump(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        os << "{\"traceEvents\":[\n";
+        bool first = true;
+        auto sep = [&]() -> std::ostream& {
+            if (!first) {
+                os << ",\n";
+            }
+            first = false;
+            return os;
+        };
+
+        for (auto& buf : buffers_) {
+            sep() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buf->tid_
+                  << ",\"args\":{\"name\":\"" << jsonEscape(buf->name_) << "\"}}";
+
+            uint64_t end = buf->head_.load(std::memory_order_acquire);
+            uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+            for (uint64_t i = begin; i < end; i++) {
+                Entry& entry = buf->entries_[i % capacity_];
+                if (entry.seq_.load(std::memory_order_acquire) != i + 1) {
+                    continue;
+                }
+                uint64_t ts = entry.ts_.load(std::memory_order_relaxed);
+                uint64_t arg = entry.arg_.load(std::memory_order_relaxed);
+                Event event = static_cast<Event>(entry.event_.load(std::memory_order_relaxed));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (entry.seq_.load(std::memory_order_relaxed) != i + 1) {
+                    // 读取期间被写入线程覆盖
+                    continue;
+                }
+
+                sep() << "{\"name\":\"" << eventName(event) << "\",\"ph\":\"" << phase(event)
+                      << "\",\"ts\":" << ts / 1000 << '.' << fraction(ts % 1000)
+                      << ",\"pid\":1,\"tid\":" << buf->tid_;
+                if (phase(event)[0] == 'i') {
+                    os << ",\"s\":\"t\"";
+                }
+                os << ",\"args\":{\"arg\":" << arg << "}}";
+            }
+        }
+        os << "\n]}\n";
+    }
+
+private:
+    // 字段都是原子变量，dump()与写入线程并发读取时没有数据竞争
+    struct Entry {
+        std::atomic<uint64_t> seq_{0};  // 条目中事件的序号+1，正在写入时为0
+        std::atomic<uint64_t> ts_{0};  // 相对创建时刻的纳秒数
+        std::atomic<uint64_t> arg_{0};
+        std::atomic<uint8_t> event_{0};
+    };
+
+    struct Buffer {
+        alignas(64) std::atomic<uint64_t> head_{0};
+        std::unique_ptr<Entry[]> entries_;
+        uint32_t tid_;
+        std::string name_;
+    };
+
+    const uint64_t id_;  // 区分不同的Tracer，避免线程本地缓存指向已销毁的Tracer
+    const size_t capacity_;
+    const std::chrono::steady_clock::time_point epoch_;
+    std::mutex mutex_;  // 保护buffers_、threadBuffers_和线程名称
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    std::unordered_map<std::thread::id, Buffer*> threadBuffers_;  // 每个线程的缓冲区
+
+    static std::atomic<uint64_t>& nextId() {
+        static std::atomic<uint64_t> id(0);
+        return id;
+    }
+
+    // 线程本地缓存的(Tracer id, 缓冲区)数量  线程在几个线程池之间切换时不需要每次加锁查找
+    static constexpr size_t LOCAL_CACHE = 4;
+
+    // 当前线程的缓冲区，第一次记录时创建；缓存未命中时按线程id查找，不会重复创建
+    Buffer* local() {
+        struct Cached {
+            uint64_t id_ = 0;
+            Buffer* buf_ = nullptr;
+        };
+        static thread_local Cached cache[LOCAL_CACHE];
+        static thread_local size_t victim = 0;
+        for (const Cached& c : cache) {
+            if (c.id_ == id_) {
+                return c.buf_;
+            }
+        }
+
+        Buffer* buf;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Buffer*& found = threadBuffers_[std::this_thread::get_id()];
+            if (found == nullptr) {
+                auto created = std::make_unique<Buffer>();
+                created->entries_.reset(new Entry[capacity_]);
+                created->tid_ = static_cast<uint32_t>(buffers_.size() + 1);
+                created->name_ = "thread " + std::to_string(created->tid_);
+                found = created.get();
+                buffers_.push_back(std::move(created));
+            }
+            buf = found;
+        }
+        // 轮流替换缓存项  id不会重复使用，已销毁的Tracer留下的缓存项不会被命中
+        cache[victim] = Cached{ id_, buf };
+        victim = (victim + 1) % LOCAL_CACHE;
+        return buf;
+    }
+
+    static const char* eventName(Event event) {
+        switch (event) {
+        case Event::Enqueue: return "enqueue";
+        case Event::Dequeue: return "dequeue";
+        case Event::Start:
+        case Event::Finish: return "task";
+        case Event::Steal: return "steal";
+        case Event::Park:
+        case Event::Unpark: return "parked";
+        case Event::Spawn: return "spawn";
+        case Event::Retire: return "retire";
+        }
+        return "unknown";
+    }
+
+    // 开始/结束成对的事件输出为时间段，其余为瞬时事件
+    static const char* phase(Event event) {
+        switch (event) {
+        case Event::Start:
+        case Event::Park: return "B";
+        case Event::Finish:
+        case Event::Unpark: return "E";
+        default: return "i";
+        }
+    }
+
+    // 转义JSON字符串中的引号、反斜杠和控制字符
+    static std::string jsonEscape(const std::string& str) {
+        std::string out;
+        out.reserve(str.size());
+        for (char c : str) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (u < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out += "\\u00";
+                out += hex[u >> 4];
+                out += hex[u & 0xf];
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    static std::string fraction(uint64_t ns) {
+        std::string s = std::to_string(ns);
+        return std::string(3 - s.size(), '0') + s;
+    }
+};
+
+#endif
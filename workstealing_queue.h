@@ -0,0 +1,68 @@
+#ifndef WORKSTEALING_QUEUE_H
+#define WORKSTEALING_QUEUE_H
+
+#include <mutex>
+#include <atomic>
+
+#include "ring_deque.h"
+
+// 工作窃取队列  每个线程一个，本线程从队尾存取(LIFO)，其他线程从队首窃取(FIFO)
+// 只有本线程和偶尔出现的窃取者竞争同一把锁，不会像全局队列那样所有线程争抢
+template <typename T>
+class WorkStealingQueue {
+public:
+    WorkStealingQueue() : size_(0) {}
+    ~WorkStealingQueue() = default;
+
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+    // 本线程压入任务
+    void push(T item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deque_.push_back(std::move(item));
+        size_.store(deque_.size(), std::memory_order_release);
+    }
+
+    // 本线程取出最近压入的任务
+    bool pop(T& item) {
+        if (empty()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (deque_.empty()) {
+            return false;
+        }
+        item = std::move(deque_.back());
+        deque_.pop_back();
+        size_.store(deque_.size(), std::memory_order_release);
+        return true;
+    }
+
+    // 其他线程窃取最早压入的任务
+    bool steal(T& item) {
+        if (empty()) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || deque_.empty()) {
+            return false;
+        }
+        item = std::move(deque_.front());
+        deque_.pop_front();
+        size_.store(deque_.size(), std::memory_order_release);
+        return true;
+    }
+
+    // 无锁查询，窃取者先用它跳过空队列
+    bool empty() const {
+        return size_.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    std::mutex mutex_;
+    RingDeque<T> deque_;
+    std::atomic<size_t> size_;
+};
+
+#endif